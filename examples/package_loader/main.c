@@ -33,25 +33,176 @@ For more information, please refer to <http://unlicense.org>
 
 #include "../shared.h"
 
+#include <time.h>
+
+static double GetSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void GetFileDescription(PLPackage *package, unsigned int index, char *desc, size_t length) {
+    const char *fileName = plGetPackageFileName(package, index);
+    if(fileName[0] != '\0') {
+        snprintf(desc, length, "%s", fileName);
+    } else {
+        snprintf(desc, length, "%u", index);
+    }
+}
+
+/* anything whose path would be too long for the library is skipped, rather than truncated */
+static bool GetExtractPath(const char *desc, char *out, size_t length) {
+    int outLength = snprintf(out, length, "./extract/%s", desc);
+    return (outLength >= 0 && (size_t) outLength < length);
+}
+
+/* parallel extraction, members are read in the order they're stored
+ * and then written out in the background, with up to numJobs writes
+ * in flight at any one time. Members sharing a name are written out
+ * one after the other, so the last one still wins */
+
+typedef struct ExtractJob {
+    PLFileRequest *request;
+    PLFile *file;
+    char desc[PL_SYSTEM_MAX_PATH];
+} ExtractJob;
+
+typedef struct ExtractState {
+    PLPackage *package;
+    ExtractJob *jobs;
+    unsigned int numJobs;
+    unsigned int nextJob;
+    unsigned int numFiles;
+    unsigned int numFailed;
+    size_t numBytes;
+} ExtractState;
+
+static void FinishExtractJob(ExtractState *state, ExtractJob *job) {
+    if(job->request == NULL) {
+        return;
+    }
+
+    if(plWaitFileRequest(job->request) == PL_FILE_REQUEST_COMPLETE) {
+        state->numFiles++;
+        state->numBytes += plGetFileSize(job->file);
+    } else {
+        PRINT("Failed to write \"%s\"!\n", job->desc);
+        state->numFailed++;
+    }
+
+    plDestroyFileRequest(job->request);
+    plCloseFile(job->file);
+    job->request = NULL;
+    job->file = NULL;
+}
+
+static void ExtractFileCallback(PLFile *file, unsigned int index, void *userData) {
+    ExtractState *state = userData;
+
+    /* wait on the oldest write, if we've run out of slots */
+    ExtractJob *job = &state->jobs[state->nextJob];
+    state->nextJob = (state->nextJob + 1) % state->numJobs;
+    FinishExtractJob(state, job);
+
+    GetFileDescription(state->package, index, job->desc, sizeof(job->desc));
+    if(file == NULL) {
+        PRINT("Failed to load \"%s\" from package!\nERR: %s\n", job->desc, plGetError());
+        state->numFailed++;
+        return;
+    }
+
+    char out[PL_SYSTEM_MAX_PATH];
+    if(!GetExtractPath(job->desc, out, sizeof(out))) {
+        PRINT("Path for \"%s\" is too long, skipping!\n", job->desc);
+        plCloseFile(file);
+        state->numFailed++;
+        return;
+    }
+
+    /* don't let two writes to the same path race each other */
+    for(unsigned int i = 0; i < state->numJobs; ++i) {
+        if(&state->jobs[i] != job && state->jobs[i].request != NULL && strcmp(state->jobs[i].desc, job->desc) == 0) {
+            FinishExtractJob(state, &state->jobs[i]);
+        }
+    }
+
+    job->file = file;
+    job->request = plWriteFileAsync(out, plGetFileData(file), plGetFileSize(file), NULL, NULL);
+    if(job->request == NULL) {
+        PRINT("Failed to write \"%s\"!\nERR: %s\n", job->desc, plGetError());
+        plCloseFile(job->file);
+        job->file = NULL;
+        state->numFailed++;
+    }
+}
+
+static void ExtractPackageParallel(PLPackage *package, unsigned int numJobs) {
+    ExtractState state = {
+        .package = package,
+        .jobs = calloc(numJobs, sizeof(ExtractJob)),
+        .numJobs = numJobs,
+    };
+
+    unsigned int numIndices = plGetPackageTableSize(package);
+    unsigned int *indices = malloc(sizeof(unsigned int) * (numIndices + 1));
+    if(state.jobs == NULL || indices == NULL) {
+        PRINT("Failed to allocate %u extraction jobs!\n", numJobs);
+        free(indices);
+        free(state.jobs);
+        return;
+    }
+    for(unsigned int i = 0; i < numIndices; ++i) {
+        indices[i] = i;
+    }
+
+    double startTime = GetSeconds();
+
+    plLoadPackageFiles(package, indices, numIndices, ExtractFileCallback, &state);
+    for(unsigned int i = 0; i < numJobs; ++i) {
+        FinishExtractJob(&state, &state.jobs[i]);
+    }
+
+    double duration = GetSeconds() - startTime;
+    if(duration <= 0.0) {
+        duration = 1e-9;
+    }
+
+    PRINT("Extracted %u files (%u failed), %.2f MB in %.3f seconds with %u jobs\n",
+          state.numFiles, state.numFailed, (double) state.numBytes / (1024.0 * 1024.0), duration, numJobs);
+    PRINT("%.2f MB/s, %.2f files/s\n",
+          (double) state.numBytes / (1024.0 * 1024.0) / duration, (double) state.numFiles / duration);
+
+    free(indices);
+    free(state.jobs);
+}
+
 int main(int argc, char **argv) {
     plInitialize(argc, argv);
+    plInitializeSubSystems(PL_SUBSYSTEM_IO);
     plSetupLogOutput("./package.log");
 
     plRegisterStandardPackageLoaders();
-    plRegisterStandardModelLoaders();
+    plRegisterStandardModelLoaders(PL_MODEL_FILEFORMAT_ALL);
 
     if(argc < 2) {
         PRINT(" package_loader <path> -<optional mode>\n");
         PRINT("  -extract : extract all files from the package\n");
+        PRINT("  -jobs <n> : extract with up to n writes in parallel, and report throughput\n");
         return EXIT_SUCCESS;
     }
 
     enum {
         MODE_VIEW,
         MODE_EXTRACT,
+        MODE_EXTRACT_PARALLEL,
     };
     unsigned int mode = MODE_VIEW;
-    if(plHasCommandLineArgument("-extract")) {
+    unsigned int numJobs = 0;
+    const char *jobsArgument = plGetCommandLineArgumentValue("-jobs");
+    if(jobsArgument != NULL && (numJobs = (unsigned int) strtoul(jobsArgument, NULL, 10)) > 0) {
+        PRINT("Parallel Extraction Mode\n");
+        mode = MODE_EXTRACT_PARALLEL;
+    } else if(plHasCommandLineArgument("-extract")) {
         PRINT("Extraction Mode\n");
         mode = MODE_EXTRACT;
     } else {
@@ -69,13 +220,25 @@ int main(int argc, char **argv) {
         PRINT_ERROR("Failed to load package \"%s\" (%s)!\n", package_path, plGetError());
     }
 
+    if(mode != MODE_VIEW) {
+        plCreateDirectory("./extract/");
+    }
+
+    if(mode == MODE_EXTRACT_PARALLEL) {
+        ExtractPackageParallel(package, numJobs);
+
+        plDestroyPackage(package);
+        plShutdown();
+
+        return EXIT_SUCCESS;
+    }
+
+    double startTime = GetSeconds();
+    size_t numBytes = 0;
+    unsigned int numFiles = 0;
     for(unsigned int i = 0; i < package->table_size; ++i) {
         char desc[PL_SYSTEM_MAX_PATH];
-        if(package->table[i].fileName[0] != '\0') {
-            strcpy(desc, package->table[i].fileName);
-        } else {
-            sprintf(desc, "%d", i);
-        }
+        GetFileDescription(package, i, desc, sizeof(desc));
 
         PRINT(
                 "id:   %d\n"
@@ -84,35 +247,42 @@ int main(int argc, char **argv) {
                 "offset: %lu\n"
                 "----------------\n",
                 i,
-                package->table[i].fileName,
+                plGetPackageFileName(package, i),
                 (unsigned long) package->table[i].fileSize,
                 (unsigned long) package->table[i].offset
                 );
 
         if(mode == MODE_EXTRACT) {
-            PLFile* filePtr = plLoadPackageFile( package, package->table[ i ].fileName );
-            if( filePtr == NULL ) {
-                PRINT( "Failed to load \"%s\" from package, skipping!\nERR: %s\n", desc, plGetError() );
+            char out[PL_SYSTEM_MAX_PATH];
+            if(!GetExtractPath(desc, out, sizeof(out))) {
+                PRINT("Path for \"%s\" is too long, skipping!\n", desc);
                 continue;
             }
 
-            char out[PL_SYSTEM_MAX_PATH];
-            snprintf(out, sizeof(out), "./extract/%s", desc);
-            plCreateDirectory("./extract/");
-
-            const uint8_t *data = plGetFileData( filePtr );
-            size_t length = plGetFileSize( filePtr );
-            if( !plWriteFile( out, data, length ) ) {
+            if( !plExtractPackageFile( package, i, out ) ) {
                 PRINT( "Failed to write \"%s\"!\nERR: %s\n", desc, plGetError() );
                 continue;
             }
 
             PRINT( "Wrote \"%s\"\n", out );
+
+            numBytes += package->table[i].fileSize;
+            numFiles++;
+        }
+    }
+
+    if(mode == MODE_EXTRACT) {
+        double duration = GetSeconds() - startTime;
+        if(duration <= 0.0) {
+            duration = 1e-9;
         }
+
+        PRINT("Extracted %u files, %.2f MB in %.3f seconds\n", numFiles, (double) numBytes / (1024.0 * 1024.0), duration);
+        PRINT("%.2f MB/s, %.2f files/s\n", (double) numBytes / (1024.0 * 1024.0) / duration, (double) numFiles / duration);
     }
 
     plDestroyPackage(package);
     plShutdown();
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
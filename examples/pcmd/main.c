@@ -28,6 +28,7 @@ For more information, please refer to <http://unlicense.org>
 #include <PL/platform.h>
 #include <PL/platform_console.h>
 #include <PL/platform_image.h>
+#include <PL/platform_package.h>
 
 /**
  * Command line utility to interface with the platform lib.
@@ -99,11 +100,52 @@ static void Cmd_IMGBulkConvert( unsigned int argc, char **argv ) {
 		snprintf( outDir, sizeof( outDir ), "out/" );
 	}
 
-	plScanDirectory( argv[ 1 ], argv[ 2 ], ConvertImageCallback, false, outDir );
+	/* packages can be converted from directly, without extracting them first */
+	PLFileSystemMount *mount = NULL;
+	if ( !plLocalPathExists( argv[ 1 ] ) ) {
+		if ( ( mount = plMountLocalLocation( argv[ 1 ] ) ) == NULL ) {
+			Error( "Error: %s\n", plGetError() );
+			return;
+		}
+	}
+
+	if ( mount != NULL ) {
+		plScanDirectory( "", argv[ 2 ], ConvertImageCallback, true, outDir );
+		plClearMountedLocation( mount );
+	} else {
+		plScanDirectory( argv[ 1 ], argv[ 2 ], ConvertImageCallback, false, outDir );
+	}
 
 	printf( "Done!\n" );
 }
 
+static void Cmd_PKGBake( unsigned int argc, char **argv ) {
+	if ( argc < 3 ) {
+		return;
+	}
+
+	PLCompressionType compressionType = PL_COMPRESSION_NONE;
+	if ( argc >= 4 && pl_strcasecmp( argv[ 3 ], "zlib" ) == 0 ) {
+		compressionType = PL_COMPRESSION_ZLIB;
+	}
+
+	PLPackage *package = plLoadPackage( argv[ 1 ] );
+	if ( package == NULL ) {
+		Error( "Error: %s\n", plGetError() );
+		return;
+	}
+
+	if ( !plWritePackage( package, argv[ 2 ], compressionType ) ) {
+		Error( "Error: %s\n", plGetError() );
+		plDestroyPackage( package );
+		return;
+	}
+
+	printf( "Wrote %u files to \"%s\"\n", plGetPackageTableSize( package ), argv[ 2 ] );
+
+	plDestroyPackage( package );
+}
+
 static bool isRunning = true;
 
 static void Cmd_Exit( unsigned int argc, char **argv ) {
@@ -124,6 +166,7 @@ int main( int argc, char **argv ) {
 	plInitializeSubSystems( PL_SUBSYSTEM_IO );
 
 	plRegisterStandardImageLoaders( PL_IMAGE_FILEFORMAT_ALL );
+	plRegisterStandardPackageLoaders();
 
 	plRegisterPlugins( "./" );
 
@@ -134,8 +177,11 @@ int main( int argc, char **argv ) {
 	                          "Convert the given image.\n"
 	                          "Usage: img_convert ./image.bmp [./out.png]" );
 	plRegisterConsoleCommand( "img_bulkconvert", Cmd_IMGBulkConvert,
-	                          "Bulk convert images in the given directory.\n"
+	                          "Bulk convert images in the given directory or package.\n"
 	                          "Usage: img_bulkconvert ./path bmp [./outpath]" );
+	plRegisterConsoleCommand( "pkg_bake", Cmd_PKGBake,
+	                          "Convert the given package into a baked pack, which is faster to load.\n"
+	                          "Usage: pkg_bake ./package.wad ./out.pack [zlib]" );
 
 	plInitializePlugins();
 
@@ -43,6 +43,12 @@ For more information, please refer to <http://unlicense.org>
 
 #define _pl_fclose(a)  fclose((a)); (a) = NULL
 
+/* prefix used to skip the mounted locations, and go straight to disk */
+#define FS_LOCAL_HINT   "local://"
+
+/* default size of the read buffer used by uncached files */
+#define FS_DEFAULT_BUFFER_SIZE  65536
+
 typedef struct PLFile {
 	char		path[ PL_SYSTEM_MAX_PATH ];
 	uint8_t		*data;
@@ -50,4 +56,52 @@ typedef struct PLFile {
 	size_t		size;
 	time_t		timeStamp;
 	void		*fptr;
+	/* uncached files are read through their own buffer, and
+	 * track their own position rather than asking stdio */
+	struct {
+		uint8_t	*data;
+		size_t	maxLength;
+		size_t	length;		/* number of valid bytes in the buffer */
+		size_t	offset;		/* position in the file the buffer starts at */
+	} buffer;
+	size_t		offset;
+	bool		isMapped;	/* data is a view of the file, released via _plUnmapFileData */
+	bool		isView;		/* data is owned by something else, e.g. a package, and isn't freed */
+	struct FSCacheEntry *cacheEntry;	/* data is shared via the content cache */
 } PLFile;
+
+/* async requests, see platform_filesystem_async.c */
+void _plInitFileRequests( void );
+void _plShutdownFileRequests( void );
+
+/* helpers shared with the rest of the filesystem, see platform_filesystem.c */
+const char* _plNormalizeIndexPath( const char* path, char* out, size_t length );
+bool _plWriteFileRange( PLFile* ptr, size_t offset, size_t length, const char* dest );
+bool _plGetLocalFileModTime( const char* path, int64_t* modTime );
+bool _plIsSameLocalFile( const char* pathA, const char* pathB );
+void _plInvalidateFileSystemIndexPath( const char* path );
+
+PLFileSystemMount* _plGetNextMountedLocation( PLFileSystemMount* location );
+const char* _plGetMountedLocationPath( const PLFileSystemMount* location );
+
+#if !defined( _MSC_VER )
+#	include <dirent.h>
+
+typedef enum FSEntryType {
+	FS_ENTRY_OTHER,
+	FS_ENTRY_FILE,
+	FS_ENTRY_DIRECTORY
+} FSEntryType;
+
+FSEntryType _plGetDirectoryEntryType( DIR* directory, const struct dirent* entry, const char* path );
+#endif
+
+/* file watches, see platform_filesystem_watch.c */
+void _plShutdownFileWatches( void );
+
+/* content cache, see platform_filesystem_cache.c */
+bool _plIsFileCacheEnabled( void );
+PLFile* _plOpenCachedFile( const void* owner, const char* path, int64_t modTime );
+void _plInsertCachedFile( const void* owner, const char* path, int64_t modTime, PLFile* file );
+void _plReleaseCachedFile( PLFile* file );
+void _plPurgeFileCache( const void* owner, const char* path );
@@ -490,9 +490,10 @@ static void GLUploadTexture( PLTexture *texture, const PLImage *upload ) {
 	unsigned int colour_format = TranslateImageColourFormat( upload->colour_format );
 	unsigned int storage_format = TranslateStorageFormat( texture->storage );
 
+	/* each level has its own data and dimensions, which never drop below 1 */
 	for ( unsigned int i = 0; i < levels; ++i ) {
-		GLsizei w = texture->w / ( unsigned int ) pow( 2, i );
-		GLsizei h = texture->h / ( unsigned int ) pow( 2, i );
+		GLsizei w = ( texture->w >> i ) > 0 ? ( GLsizei ) ( texture->w >> i ) : 1;
+		GLsizei h = ( texture->h >> i ) > 0 ? ( GLsizei ) ( texture->h >> i ) : 1;
 		if ( plIsCompressedImageFormat( upload->format ) ) {
 			glCompressedTexImage2D(
 			        GL_TEXTURE_2D,
@@ -500,8 +501,8 @@ static void GLUploadTexture( PLTexture *texture, const PLImage *upload ) {
 			        image_format,
 			        w, h,
 			        0,
-			        ( GLsizei ) upload->size,
-			        upload->data[ 0 ] );
+			        ( GLsizei ) plGetImageSize( upload->format, ( unsigned int ) w, ( unsigned int ) h ),
+			        upload->data[ i ] );
 		} else {
 			glTexImage2D(
 			        GL_TEXTURE_2D,
@@ -511,10 +512,15 @@ static void GLUploadTexture( PLTexture *texture, const PLImage *upload ) {
 			        0,
 			        colour_format,
 			        storage_format,
-			        upload->data[ 0 ] );
+			        upload->data[ i ] );
 		}
 	}
 
+	/* otherwise an incomplete chain leaves the texture unusable */
+	if ( levels > 1 ) {
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ( GLint ) ( levels - 1 ) );
+	}
+
 	if ( levels == 1 && !( texture->flags & PL_TEXTURE_FLAG_NOMIPS ) ) {
 		glGenerateMipmap( GL_TEXTURE_2D );
 	}
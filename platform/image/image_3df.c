@@ -45,49 +45,49 @@ static PLImageFormat FD3_GetImageFormat( const char *formatStr ) {
 	return PL_IMAGEFORMAT_UNKNOWN;
 }
 
-static PLImage *FD3_ReadFile( PLFile *file ) {
+static bool FD3_ReadHeader( PLFile *file, PLImageFormat *format, unsigned int *width, unsigned int *height ) {
 	/* read in the header */
 	char buf[ 64 ];
 
 	/* identifier */
 	if ( plReadString( file, buf, sizeof( buf ) ) == NULL ) {
-		return NULL;
+		return false;
 	}
 	if ( strncmp( buf, "3df ", 4 ) != 0 ) {
 		ReportError( PL_RESULT_FILETYPE, "invalid identifier, expected \"3df \"" );
-		return NULL;
+		return false;
 	}
 
 	/* image format */
 	plReadString( file, buf, sizeof( buf ) );
-	PLImageFormat dataFormat = FD3_GetImageFormat( buf );
-	if ( dataFormat == PL_IMAGEFORMAT_UNKNOWN ) {
+	*format = FD3_GetImageFormat( buf );
+	if ( *format == PL_IMAGEFORMAT_UNKNOWN ) {
 		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format, \"%s\"", buf );
-		return NULL;
+		return false;
 	}
 
 	/* lod */
 	if ( plReadString( file, buf, sizeof( buf ) ) == NULL ) {
-		return NULL;
+		return false;
 	}
 	int w, h;
 	if ( sscanf( buf, "lod range: %d %d\n", &w, &h ) != 2 ) {
 		ReportError( PL_RESULT_FILEREAD, "failed to read lod range" );
-		return NULL;
+		return false;
 	}
 	if ( w <= 0 || h <= 0 || w > 256 || h > 256 ) {
 		ReportBasicError( PL_RESULT_IMAGERESOLUTION );
-		return NULL;
+		return false;
 	}
 
 	/* aspect */
 	if ( plReadString( file, buf, sizeof( buf ) ) == NULL ) {
-		return NULL;
+		return false;
 	}
 	int x, y;
 	if ( sscanf( buf, "aspect ratio: %d %d\n", &x, &y ) != 2 ) {
 		ReportError( PL_RESULT_FILEREAD, "failed to read aspect ratio" );
-		return NULL;
+		return false;
 	}
 
 	switch ( ( x << 4 ) | ( y ) ) {
@@ -114,7 +114,20 @@ static PLImage *FD3_ReadFile( PLFile *file ) {
 			break;
 		default:
 			ReportError( PL_RESULT_FAIL, "unexpected aspect-ratio: %dx%d", x, y );
-			return NULL;
+			return false;
+	}
+
+	*width = ( unsigned int ) w;
+	*height = ( unsigned int ) h;
+
+	return true;
+}
+
+static PLImage *FD3_ReadFile( PLFile *file ) {
+	PLImageFormat dataFormat;
+	unsigned int w, h;
+	if ( !FD3_ReadHeader( file, &dataFormat, &w, &h ) ) {
+		return NULL;
 	}
 
 	/* now we can load the actual data in */
@@ -171,3 +184,22 @@ PLImage *plLoad3dfImage( const char *path ) {
 
 	return image;
 }
+
+bool plProbe3dfImage( const char *path, PLImageInfo *info ) {
+	PLFile *file = plOpenFile( path, false );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	PLImageFormat dataFormat;
+	bool result = FD3_ReadHeader( file, &dataFormat, &info->width, &info->height );
+
+	plCloseFile( file );
+
+	/* the loader always hands back RGBA8 */
+	info->levels = 1;
+	info->format = PL_IMAGEFORMAT_RGBA8;
+	info->colour_format = PL_COLOURFORMAT_RGBA;
+
+	return result;
+}
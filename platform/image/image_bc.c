@@ -0,0 +1,684 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "image_private.h"
+
+/* Block compression for the S3TC formats, i.e. BC1 (DXT1), BC2 (DXT3)
+ * and BC3 (DXT5). Both directions work on rows of 4x4 blocks, which
+ * are split between threads for anything larger than a few hundred
+ * blocks. */
+
+#define BC_MIN_BLOCKS_PER_WORKER    256
+
+static bool IsBlockFormat( PLImageFormat format ) {
+	return ( format == PL_IMAGEFORMAT_RGB_DXT1 || format == PL_IMAGEFORMAT_RGBA_DXT1 ||
+	         format == PL_IMAGEFORMAT_RGBA_DXT3 || format == PL_IMAGEFORMAT_RGBA_DXT5 );
+}
+
+static unsigned int GetBlockSize( PLImageFormat format ) {
+	return ( format == PL_IMAGEFORMAT_RGB_DXT1 || format == PL_IMAGEFORMAT_RGBA_DXT1 ) ? 8 : 16;
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Block Rows                          */
+
+typedef struct BlockTask {
+	void ( *ProcessRows )( const struct BlockTask *task, unsigned int firstRow, unsigned int lastRow );
+	const uint8_t *src;
+	uint8_t *dst;
+	unsigned int width, height;
+	PLImageFormat format;
+	PLImageCompressionQuality quality;
+} BlockTask;
+
+static void ProcessBlockRows( void *userData, unsigned int worker, unsigned int firstRow, unsigned int lastRow ) {
+	( void ) worker;
+
+	const BlockTask *task = userData;
+	task->ProcessRows( task, firstRow, lastRow );
+}
+
+static void RunBlockTask( const BlockTask *task ) {
+	unsigned int numRows = ( task->height + 3 ) / 4;
+	unsigned int numBlocks = numRows * ( ( task->width + 3 ) / 4 );
+	_plRunImageRows( ProcessBlockRows, ( void * ) task, numRows, numBlocks / BC_MIN_BLOCKS_PER_WORKER );
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Decoding                            */
+
+static void Expand565( unsigned int colour, uint8_t *dst ) {
+	unsigned int r = ( colour >> 11 ) & 31;
+	unsigned int g = ( colour >> 5 ) & 63;
+	unsigned int b = colour & 31;
+	dst[ PL_RED ] = ( uint8_t ) ( ( r << 3 ) | ( r >> 2 ) );
+	dst[ PL_GREEN ] = ( uint8_t ) ( ( g << 2 ) | ( g >> 4 ) );
+	dst[ PL_BLUE ] = ( uint8_t ) ( ( b << 3 ) | ( b >> 2 ) );
+	dst[ PL_ALPHA ] = 255;
+}
+
+/**
+ * Fills in the four colours a colour block can pick from. Three colour
+ * blocks, which are only possible in BC1, have transparent black last.
+ */
+static void GetColourPalette( unsigned int c0, unsigned int c1, bool allowThreeColour, uint8_t palette[ 4 ][ 4 ] ) {
+	Expand565( c0, palette[ 0 ] );
+	Expand565( c1, palette[ 1 ] );
+	if ( c0 > c1 || !allowThreeColour ) {
+		for ( unsigned int i = 0; i < 3; ++i ) {
+			palette[ 2 ][ i ] = ( uint8_t ) ( ( 2 * palette[ 0 ][ i ] + palette[ 1 ][ i ] + 1 ) / 3 );
+			palette[ 3 ][ i ] = ( uint8_t ) ( ( palette[ 0 ][ i ] + 2 * palette[ 1 ][ i ] + 1 ) / 3 );
+		}
+		palette[ 2 ][ PL_ALPHA ] = palette[ 3 ][ PL_ALPHA ] = 255;
+	} else {
+		for ( unsigned int i = 0; i < 3; ++i ) {
+			palette[ 2 ][ i ] = ( uint8_t ) ( ( palette[ 0 ][ i ] + palette[ 1 ][ i ] + 1 ) / 2 );
+		}
+		palette[ 2 ][ PL_ALPHA ] = 255;
+		memset( palette[ 3 ], 0, 4 );
+	}
+}
+
+/**
+ * Fills in the eight alpha values a BC3 alpha block can pick from.
+ */
+static void GetAlphaPalette( unsigned int a0, unsigned int a1, uint8_t palette[ 8 ] ) {
+	palette[ 0 ] = ( uint8_t ) a0;
+	palette[ 1 ] = ( uint8_t ) a1;
+	if ( a0 > a1 ) {
+		for ( unsigned int i = 2; i < 8; ++i ) {
+			palette[ i ] = ( uint8_t ) ( ( ( 8 - i ) * a0 + ( i - 1 ) * a1 + 3 ) / 7 );
+		}
+	} else {
+		for ( unsigned int i = 2; i < 6; ++i ) {
+			palette[ i ] = ( uint8_t ) ( ( ( 6 - i ) * a0 + ( i - 1 ) * a1 + 2 ) / 5 );
+		}
+		palette[ 6 ] = 0;
+		palette[ 7 ] = 255;
+	}
+}
+
+static void DecodeBlock( const uint8_t *block, PLImageFormat format, uint8_t pixels[ 16 ][ 4 ] ) {
+	const uint8_t *colourBlock = block;
+	if ( format == PL_IMAGEFORMAT_RGBA_DXT3 || format == PL_IMAGEFORMAT_RGBA_DXT5 ) {
+		colourBlock += 8;
+	}
+
+	uint8_t palette[ 4 ][ 4 ];
+	unsigned int c0 = colourBlock[ 0 ] | ( colourBlock[ 1 ] << 8 );
+	unsigned int c1 = colourBlock[ 2 ] | ( colourBlock[ 3 ] << 8 );
+	bool isDXT1 = ( format == PL_IMAGEFORMAT_RGB_DXT1 || format == PL_IMAGEFORMAT_RGBA_DXT1 );
+	GetColourPalette( c0, c1, isDXT1, palette );
+	if ( format == PL_IMAGEFORMAT_RGB_DXT1 ) {
+		/* without alpha, the fourth colour is just black */
+		palette[ 3 ][ PL_ALPHA ] = 255;
+	}
+
+	uint32_t indices = colourBlock[ 4 ] | ( colourBlock[ 5 ] << 8 ) | ( colourBlock[ 6 ] << 16 ) | ( ( uint32_t ) colourBlock[ 7 ] << 24 );
+	for ( unsigned int i = 0; i < 16; ++i, indices >>= 2 ) {
+		memcpy( pixels[ i ], palette[ indices & 3 ], 4 );
+	}
+
+	if ( format == PL_IMAGEFORMAT_RGBA_DXT3 ) {
+		for ( unsigned int i = 0; i < 16; ++i ) {
+			pixels[ i ][ PL_ALPHA ] = ( uint8_t ) ( ( ( block[ i / 2 ] >> ( ( i & 1 ) * 4 ) ) & 15 ) * 17 );
+		}
+	} else if ( format == PL_IMAGEFORMAT_RGBA_DXT5 ) {
+		uint8_t alphas[ 8 ];
+		GetAlphaPalette( block[ 0 ], block[ 1 ], alphas );
+
+		uint64_t alphaIndices = 0;
+		for ( unsigned int i = 0; i < 6; ++i ) {
+			alphaIndices |= ( uint64_t ) block[ 2 + i ] << ( i * 8 );
+		}
+		for ( unsigned int i = 0; i < 16; ++i, alphaIndices >>= 3 ) {
+			pixels[ i ][ PL_ALPHA ] = alphas[ alphaIndices & 7 ];
+		}
+	}
+}
+
+static void DecodeBlockRows( const BlockTask *task, unsigned int firstRow, unsigned int lastRow ) {
+	unsigned int blockSize = GetBlockSize( task->format );
+	unsigned int numColumns = ( task->width + 3 ) / 4;
+	size_t pitch = ( size_t ) task->width * 4;
+
+	for ( unsigned int y = firstRow; y < lastRow; ++y ) {
+		const uint8_t *block = &task->src[ ( size_t ) y * numColumns * blockSize ];
+		for ( unsigned int x = 0; x < numColumns; ++x, block += blockSize ) {
+			uint8_t pixels[ 16 ][ 4 ];
+			DecodeBlock( block, task->format, pixels );
+
+			/* blocks on the right and bottom edges may hang off the image */
+			unsigned int w = ( task->width - x * 4 < 4 ) ? task->width - x * 4 : 4;
+			unsigned int h = ( task->height - y * 4 < 4 ) ? task->height - y * 4 : 4;
+			uint8_t *dst = &task->dst[ ( size_t ) y * 4 * pitch + ( size_t ) x * 16 ];
+			for ( unsigned int i = 0; i < h; ++i, dst += pitch ) {
+				memcpy( dst, pixels[ i * 4 ], w * 4 );
+			}
+		}
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Encoding                            */
+
+static unsigned int ColourDistance( const uint8_t *a, const uint8_t *b ) {
+	int r = a[ 0 ] - b[ 0 ], g = a[ 1 ] - b[ 1 ], bl = a[ 2 ] - b[ 2 ];
+	return ( unsigned int ) ( r * r + g * g + bl * bl );
+}
+
+/**
+ * Picks the closest palette entry for each pixel, skipping any pixel
+ * that's masked off. Returns the total squared error.
+ */
+static unsigned int FindColourIndices( const uint8_t pixels[ 16 ][ 4 ], uint16_t mask, const uint8_t palette[ 4 ][ 4 ], unsigned int numColours, uint8_t *indices ) {
+	unsigned int error = 0;
+#if defined( PL_SIMD_SSE2 )
+	/* four pixels at a time, widened to 16-bit with alpha zeroed so a
+	 * single multiply-add gives the sum of squares for each one */
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgbMask = _mm_set1_epi32( 0x00FFFFFF );
+	__m128i colours[ 4 ];
+	for ( unsigned int i = 0; i < numColours; ++i ) {
+		uint32_t colour;
+		memcpy( &colour, palette[ i ], 4 );
+		colours[ i ] = _mm_unpacklo_epi8( _mm_and_si128( _mm_set1_epi32( ( int ) colour ), rgbMask ), zero );
+	}
+
+	for ( unsigned int i = 0; i < 16; i += 4 ) {
+		__m128i v = _mm_and_si128( _mm_loadu_si128( ( const __m128i * ) pixels[ i ] ), rgbMask );
+		__m128i lo = _mm_unpacklo_epi8( v, zero );
+		__m128i hi = _mm_unpackhi_epi8( v, zero );
+
+		__m128i best = _mm_set1_epi32( 0x7FFFFFFF );
+		__m128i bestIndex = zero;
+		for ( unsigned int j = 0; j < numColours; ++j ) {
+			__m128i dlo = _mm_sub_epi16( lo, colours[ j ] );
+			__m128i dhi = _mm_sub_epi16( hi, colours[ j ] );
+			dlo = _mm_madd_epi16( dlo, dlo );
+			dhi = _mm_madd_epi16( dhi, dhi );
+			/* each pixel is now a pair of partial sums, add them up */
+			__m128i d = _mm_add_epi32( _mm_castps_si128( _mm_shuffle_ps( _mm_castsi128_ps( dlo ), _mm_castsi128_ps( dhi ), _MM_SHUFFLE( 2, 0, 2, 0 ) ) ),
+			                           _mm_castps_si128( _mm_shuffle_ps( _mm_castsi128_ps( dlo ), _mm_castsi128_ps( dhi ), _MM_SHUFFLE( 3, 1, 3, 1 ) ) ) );
+			__m128i isCloser = _mm_cmplt_epi32( d, best );
+			best = _mm_or_si128( _mm_and_si128( isCloser, d ), _mm_andnot_si128( isCloser, best ) );
+			bestIndex = _mm_or_si128( _mm_and_si128( isCloser, _mm_set1_epi32( ( int ) j ) ), _mm_andnot_si128( isCloser, bestIndex ) );
+		}
+
+		uint32_t distances[ 4 ], closest[ 4 ];
+		_mm_storeu_si128( ( __m128i * ) distances, best );
+		_mm_storeu_si128( ( __m128i * ) closest, bestIndex );
+		for ( unsigned int j = 0; j < 4; ++j ) {
+			if ( mask & ( 1 << ( i + j ) ) ) {
+				indices[ i + j ] = ( uint8_t ) closest[ j ];
+				error += distances[ j ];
+			}
+		}
+	}
+#else
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		if ( !( mask & ( 1 << i ) ) ) {
+			continue;
+		}
+
+		unsigned int best = ColourDistance( pixels[ i ], palette[ 0 ] );
+		indices[ i ] = 0;
+		for ( unsigned int j = 1; j < numColours; ++j ) {
+			unsigned int d = ColourDistance( pixels[ i ], palette[ j ] );
+			if ( d < best ) {
+				best = d;
+				indices[ i ] = ( uint8_t ) j;
+			}
+		}
+		error += best;
+	}
+#endif
+	return error;
+}
+
+static unsigned int Quantise565( const float *colour ) {
+	int r = ( int ) ( ( plClamp( 0.0f, colour[ 0 ], 255.0f ) ) * 31.0f / 255.0f + 0.5f );
+	int g = ( int ) ( ( plClamp( 0.0f, colour[ 1 ], 255.0f ) ) * 63.0f / 255.0f + 0.5f );
+	int b = ( int ) ( ( plClamp( 0.0f, colour[ 2 ], 255.0f ) ) * 31.0f / 255.0f + 0.5f );
+	return ( unsigned int ) ( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+/**
+ * Picks a pair of endpoints that the masked pixels lie between.
+ */
+static void GetColourEndpoints( const uint8_t pixels[ 16 ][ 4 ], uint16_t mask, PLImageCompressionQuality quality, float *start, float *end ) {
+	float mean[ 3 ] = { 0.0f, 0.0f, 0.0f };
+	float min[ 3 ] = { 255.0f, 255.0f, 255.0f };
+	float max[ 3 ] = { 0.0f, 0.0f, 0.0f };
+	unsigned int numPixels = 0;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		if ( !( mask & ( 1 << i ) ) ) {
+			continue;
+		}
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			mean[ j ] += pixels[ i ][ j ];
+			if ( pixels[ i ][ j ] < min[ j ] ) { min[ j ] = pixels[ i ][ j ]; }
+			if ( pixels[ i ][ j ] > max[ j ] ) { max[ j ] = pixels[ i ][ j ]; }
+		}
+		numPixels++;
+	}
+	for ( unsigned int j = 0; j < 3; ++j ) {
+		mean[ j ] /= ( float ) numPixels;
+	}
+
+	float covariance[ 6 ] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		if ( !( mask & ( 1 << i ) ) ) {
+			continue;
+		}
+		float r = pixels[ i ][ 0 ] - mean[ 0 ], g = pixels[ i ][ 1 ] - mean[ 1 ], b = pixels[ i ][ 2 ] - mean[ 2 ];
+		covariance[ 0 ] += r * r;
+		covariance[ 1 ] += r * g;
+		covariance[ 2 ] += r * b;
+		covariance[ 3 ] += g * g;
+		covariance[ 4 ] += g * b;
+		covariance[ 5 ] += b * b;
+	}
+
+	if ( quality == PL_IMAGECOMPRESSION_FAST ) {
+		/* corners of the bounding box, flipped to follow the colours */
+		memcpy( start, max, sizeof( max ) );
+		memcpy( end, min, sizeof( min ) );
+		if ( covariance[ 1 ] < 0.0f ) {
+			start[ 0 ] = min[ 0 ];
+			end[ 0 ] = max[ 0 ];
+		}
+		if ( covariance[ 4 ] < 0.0f ) {
+			start[ 2 ] = min[ 2 ];
+			end[ 2 ] = max[ 2 ];
+		}
+		return;
+	}
+
+	/* principal axis by power iteration, starting from the box diagonal */
+	float axis[ 3 ] = { max[ 0 ] - min[ 0 ], max[ 1 ] - min[ 1 ], max[ 2 ] - min[ 2 ] };
+	for ( unsigned int i = 0; i < 8; ++i ) {
+		float x = axis[ 0 ] * covariance[ 0 ] + axis[ 1 ] * covariance[ 1 ] + axis[ 2 ] * covariance[ 2 ];
+		float y = axis[ 0 ] * covariance[ 1 ] + axis[ 1 ] * covariance[ 3 ] + axis[ 2 ] * covariance[ 4 ];
+		float z = axis[ 0 ] * covariance[ 2 ] + axis[ 1 ] * covariance[ 4 ] + axis[ 2 ] * covariance[ 5 ];
+		float length = fmaxf( fabsf( x ), fmaxf( fabsf( y ), fabsf( z ) ) );
+		if ( length < 1e-6f ) {
+			break;
+		}
+		axis[ 0 ] = x / length;
+		axis[ 1 ] = y / length;
+		axis[ 2 ] = z / length;
+	}
+
+	float minDot = 1e30f, maxDot = -1e30f;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		if ( !( mask & ( 1 << i ) ) ) {
+			continue;
+		}
+		float d = ( pixels[ i ][ 0 ] - mean[ 0 ] ) * axis[ 0 ] + ( pixels[ i ][ 1 ] - mean[ 1 ] ) * axis[ 1 ] + ( pixels[ i ][ 2 ] - mean[ 2 ] ) * axis[ 2 ];
+		if ( d < minDot ) {
+			minDot = d;
+			for ( unsigned int j = 0; j < 3; ++j ) { end[ j ] = pixels[ i ][ j ]; }
+		}
+		if ( d > maxDot ) {
+			maxDot = d;
+			for ( unsigned int j = 0; j < 3; ++j ) { start[ j ] = pixels[ i ][ j ]; }
+		}
+	}
+}
+
+/**
+ * Least squares fit of the endpoints to the pixels, given the indices
+ * they were assigned. Returns false if the fit is degenerate.
+ */
+static bool RefineColourEndpoints( const uint8_t pixels[ 16 ][ 4 ], uint16_t mask, const uint8_t *indices, bool isThreeColour, float *start, float *end ) {
+	static const float fourColourWeights[ 4 ] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	static const float threeColourWeights[ 4 ] = { 1.0f, 0.0f, 0.5f, 0.0f };
+	const float *weights = isThreeColour ? threeColourWeights : fourColourWeights;
+
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[ 3 ] = { 0.0f, 0.0f, 0.0f }, bx[ 3 ] = { 0.0f, 0.0f, 0.0f };
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		if ( !( mask & ( 1 << i ) ) ) {
+			continue;
+		}
+		float a = weights[ indices[ i ] ];
+		float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			ax[ j ] += a * pixels[ i ][ j ];
+			bx[ j ] += b * pixels[ i ][ j ];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if ( fabsf( det ) < 1e-6f ) {
+		return false;
+	}
+
+	for ( unsigned int j = 0; j < 3; ++j ) {
+		start[ j ] = ( bb * ax[ j ] - ab * bx[ j ] ) / det;
+		end[ j ] = ( aa * bx[ j ] - ab * ax[ j ] ) / det;
+	}
+
+	return true;
+}
+
+static uint32_t PackColourIndices( const uint8_t *indices ) {
+	uint32_t packed = 0;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		packed |= ( uint32_t ) indices[ i ] << ( i * 2 );
+	}
+	return packed;
+}
+
+/**
+ * Quantises the endpoints and picks indices for them, sorting the
+ * endpoints into the order that selects the wanted mode. Returns the
+ * squared error.
+ */
+static unsigned int FitColourBlock( const uint8_t pixels[ 16 ][ 4 ], uint16_t mask, bool isThreeColour, const float *start, const float *end,
+                                    unsigned int *c0, unsigned int *c1, uint8_t *indices ) {
+	unsigned int a = Quantise565( start );
+	unsigned int b = Quantise565( end );
+	if ( isThreeColour ? ( a > b ) : ( a < b ) ) {
+		unsigned int swap = a;
+		a = b;
+		b = swap;
+	}
+
+	if ( a == b && !isThreeColour ) {
+		/* equal endpoints would read back as a three colour block,
+		 * but the first colour alone is all that's needed anyway */
+		uint8_t palette[ 4 ][ 4 ];
+		Expand565( a, palette[ 0 ] );
+		memset( indices, 0, 16 );
+		*c0 = a;
+		*c1 = b;
+		return FindColourIndices( pixels, mask, palette, 1, indices );
+	}
+
+	uint8_t palette[ 4 ][ 4 ];
+	GetColourPalette( a, b, true, palette );
+	*c0 = a;
+	*c1 = b;
+	return FindColourIndices( pixels, mask, palette, isThreeColour ? 3 : 4, indices );
+}
+
+static void EncodeColourBlock( const uint8_t pixels[ 16 ][ 4 ], bool allowTransparency, PLImageCompressionQuality quality, uint8_t *block ) {
+	/* transparent pixels, in BC1, are written as the fourth colour of a
+	 * three colour block and take no part in the fit */
+	uint16_t mask = 0xFFFF;
+	if ( allowTransparency ) {
+		for ( unsigned int i = 0; i < 16; ++i ) {
+			if ( pixels[ i ][ PL_ALPHA ] < 128 ) {
+				mask &= ( uint16_t ) ~( 1 << i );
+			}
+		}
+	}
+
+	bool isThreeColour = ( mask != 0xFFFF );
+	uint8_t indices[ 16 ];
+	memset( indices, 3, sizeof( indices ) );
+
+	unsigned int c0 = 0, c1 = 0;
+	if ( mask != 0 ) {
+		float start[ 3 ], end[ 3 ];
+		GetColourEndpoints( pixels, mask, quality, start, end );
+		unsigned int error = FitColourBlock( pixels, mask, isThreeColour, start, end, &c0, &c1, indices );
+
+		unsigned int numPasses = ( quality == PL_IMAGECOMPRESSION_HIGH ) ? 8 : ( quality == PL_IMAGECOMPRESSION_NORMAL ) ? 1 : 0;
+		for ( unsigned int i = 0; i < numPasses && error > 0; ++i ) {
+			if ( !RefineColourEndpoints( pixels, mask, indices, isThreeColour, start, end ) ) {
+				break;
+			}
+
+			unsigned int n0, n1;
+			uint8_t newIndices[ 16 ];
+			memcpy( newIndices, indices, sizeof( newIndices ) );
+			unsigned int newError = FitColourBlock( pixels, mask, isThreeColour, start, end, &n0, &n1, newIndices );
+			if ( newError >= error ) {
+				break;
+			}
+
+			error = newError;
+			c0 = n0;
+			c1 = n1;
+			memcpy( indices, newIndices, sizeof( indices ) );
+		}
+	}
+
+	block[ 0 ] = ( uint8_t ) c0;
+	block[ 1 ] = ( uint8_t ) ( c0 >> 8 );
+	block[ 2 ] = ( uint8_t ) c1;
+	block[ 3 ] = ( uint8_t ) ( c1 >> 8 );
+	uint32_t packed = PackColourIndices( indices );
+	block[ 4 ] = ( uint8_t ) packed;
+	block[ 5 ] = ( uint8_t ) ( packed >> 8 );
+	block[ 6 ] = ( uint8_t ) ( packed >> 16 );
+	block[ 7 ] = ( uint8_t ) ( packed >> 24 );
+}
+
+static unsigned int FitAlphaBlock( const uint8_t pixels[ 16 ][ 4 ], unsigned int a0, unsigned int a1, uint64_t *packed ) {
+	uint8_t palette[ 8 ];
+	GetAlphaPalette( a0, a1, palette );
+
+	unsigned int error = 0;
+	*packed = 0;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		unsigned int best = 0xFFFFFFFF, bestIndex = 0;
+		for ( unsigned int j = 0; j < 8; ++j ) {
+			int d = pixels[ i ][ PL_ALPHA ] - palette[ j ];
+			if ( ( unsigned int ) ( d * d ) < best ) {
+				best = ( unsigned int ) ( d * d );
+				bestIndex = j;
+			}
+		}
+		error += best;
+		*packed |= ( uint64_t ) bestIndex << ( i * 3 );
+	}
+
+	return error;
+}
+
+static void EncodeAlphaBlock( const uint8_t pixels[ 16 ][ 4 ], PLImageCompressionQuality quality, uint8_t *block ) {
+	unsigned int min = 255, max = 0;
+	unsigned int innerMin = 255, innerMax = 0;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		unsigned int a = pixels[ i ][ PL_ALPHA ];
+		if ( a < min ) { min = a; }
+		if ( a > max ) { max = a; }
+		if ( a != 0 && a != 255 ) {
+			if ( a < innerMin ) { innerMin = a; }
+			if ( a > innerMax ) { innerMax = a; }
+		}
+	}
+
+	/* eight interpolated values between the extremes... */
+	uint64_t packed;
+	unsigned int a0 = max, a1 = min;
+	unsigned int error = FitAlphaBlock( pixels, a0, a1, &packed );
+
+	/* ...or six between everything else, with 0 and 255 kept exact */
+	if ( quality == PL_IMAGECOMPRESSION_HIGH && error > 0 && innerMin <= innerMax ) {
+		uint64_t innerPacked;
+		unsigned int innerError = FitAlphaBlock( pixels, innerMin, innerMax, &innerPacked );
+		if ( innerError < error ) {
+			a0 = innerMin;
+			a1 = innerMax;
+			packed = innerPacked;
+		}
+	}
+
+	block[ 0 ] = ( uint8_t ) a0;
+	block[ 1 ] = ( uint8_t ) a1;
+	for ( unsigned int i = 0; i < 6; ++i ) {
+		block[ 2 + i ] = ( uint8_t ) ( packed >> ( i * 8 ) );
+	}
+}
+
+static void EncodeBlock( const uint8_t pixels[ 16 ][ 4 ], PLImageFormat format, PLImageCompressionQuality quality, uint8_t *block ) {
+	switch ( format ) {
+		case PL_IMAGEFORMAT_RGB_DXT1:
+			EncodeColourBlock( pixels, false, quality, block );
+			break;
+		case PL_IMAGEFORMAT_RGBA_DXT1:
+			EncodeColourBlock( pixels, true, quality, block );
+			break;
+		case PL_IMAGEFORMAT_RGBA_DXT3:
+			for ( unsigned int i = 0; i < 8; ++i ) {
+				unsigned int lo = ( pixels[ i * 2 ][ PL_ALPHA ] * 15 + 127 ) / 255;
+				unsigned int hi = ( pixels[ i * 2 + 1 ][ PL_ALPHA ] * 15 + 127 ) / 255;
+				block[ i ] = ( uint8_t ) ( lo | ( hi << 4 ) );
+			}
+			EncodeColourBlock( pixels, false, quality, block + 8 );
+			break;
+		case PL_IMAGEFORMAT_RGBA_DXT5:
+			EncodeAlphaBlock( pixels, quality, block );
+			EncodeColourBlock( pixels, false, quality, block + 8 );
+			break;
+		default:
+			break;
+	}
+}
+
+static void EncodeBlockRows( const BlockTask *task, unsigned int firstRow, unsigned int lastRow ) {
+	unsigned int blockSize = GetBlockSize( task->format );
+	unsigned int numColumns = ( task->width + 3 ) / 4;
+	size_t pitch = ( size_t ) task->width * 4;
+
+	for ( unsigned int y = firstRow; y < lastRow; ++y ) {
+		uint8_t *block = &task->dst[ ( size_t ) y * numColumns * blockSize ];
+		for ( unsigned int x = 0; x < numColumns; ++x, block += blockSize ) {
+			/* edge blocks repeat the last row and column to fill out */
+			uint8_t pixels[ 16 ][ 4 ];
+			for ( unsigned int i = 0; i < 4; ++i ) {
+				unsigned int py = ( y * 4 + i < task->height ) ? y * 4 + i : task->height - 1;
+				for ( unsigned int j = 0; j < 4; ++j ) {
+					unsigned int px = ( x * 4 + j < task->width ) ? x * 4 + j : task->width - 1;
+					memcpy( pixels[ i * 4 + j ], &task->src[ py * pitch + px * 4 ], 4 );
+				}
+			}
+
+			EncodeBlock( pixels, task->format, task->quality, block );
+		}
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Runs the task over every level of the image, swapping in the new
+ * levels only once they've all been converted.
+ */
+static bool ConvertBlockLevels( PLImage *image, BlockTask *task, PLImageFormat newFormat ) {
+	uint8_t **levels = pl_calloc( image->levels, sizeof( uint8_t * ) );
+	if ( levels == NULL ) {
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < image->levels; ++i ) {
+		task->width = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+		task->height = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+		levels[ i ] = pl_malloc( plGetImageSize( newFormat, task->width, task->height ) );
+		if ( levels[ i ] == NULL ) {
+			for ( unsigned int j = 0; j < i; ++j ) {
+				pl_free( levels[ j ] );
+			}
+			pl_free( levels );
+
+			ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image data" );
+			return false;
+		}
+
+		task->src = image->data[ i ];
+		task->dst = levels[ i ];
+		RunBlockTask( task );
+	}
+
+	plFreeImage( image );
+	image->data = levels;
+	image->format = newFormat;
+	image->size = plGetImageSize( newFormat, image->width, image->height );
+
+	return true;
+}
+
+/**
+ * Decompresses every level of a block compressed image into RGBA8.
+ */
+bool plDecompressImage( PLImage *image ) {
+	if ( !IsBlockFormat( image->format ) ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported compressed image format" );
+		return false;
+	}
+
+	BlockTask task = {
+	        .ProcessRows = DecodeBlockRows,
+	        .format = image->format,
+	};
+	if ( !ConvertBlockLevels( image, &task, PL_IMAGEFORMAT_RGBA8 ) ) {
+		return false;
+	}
+
+	image->colour_format = PL_COLOURFORMAT_RGBA;
+	return true;
+}
+
+/**
+ * Compresses every level of the image into one of the DXT formats.
+ * Higher quality spends more time fitting each block.
+ */
+bool plCompressImage( PLImage *image, PLImageFormat format, PLImageCompressionQuality quality ) {
+	if ( !IsBlockFormat( format ) ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported compressed image format" );
+		return false;
+	} else if ( image->format == format ) {
+		return true;
+	}
+
+	/* everything is compressed from RGBA8 */
+	if ( plIsCompressedImageFormat( image->format ) && !plDecompressImage( image ) ) {
+		return false;
+	} else if ( !plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) || !plConvertColourFormat( image, PL_COLOURFORMAT_RGBA ) ) {
+		return false;
+	}
+
+	BlockTask task = {
+	        .ProcessRows = EncodeBlockRows,
+	        .format = format,
+	        .quality = quality,
+	};
+	if ( !ConvertBlockLevels( image, &task, format ) ) {
+		return false;
+	}
+
+	image->colour_format = ( format == PL_IMAGEFORMAT_RGB_DXT1 ) ? PL_COLOURFORMAT_RGB : PL_COLOURFORMAT_RGBA;
+	return true;
+}
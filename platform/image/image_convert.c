@@ -0,0 +1,599 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "image_private.h"
+
+/* Conversion between the uncompressed pixel formats. Pairs of 8-bit
+ * formats are shuffled directly, anything else is decoded to RGBA8
+ * and then encoded into the new format.
+ *
+ * Packed 16-bit formats are stored as big-endian words, with the first
+ * channel named by the colour format in the most significant bits,
+ * i.e. RGB5A1 is RRRRRGGG GGBBBBBA. */
+
+#if defined( PL_SIMD_SSE2 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#	define PL_IMAGE_AVX2
+#	include <immintrin.h>
+#endif
+
+enum {
+	PIXEL_UNORM8,
+	PIXEL_PACKED16,
+	PIXEL_HALF,
+};
+
+typedef struct PixelFormatInfo {
+	unsigned int type;
+	unsigned int numChannels;
+	unsigned int bytesPerPixel;
+	uint8_t bits[ 4 ]; /* packed formats only */
+	uint8_t shifts[ 4 ];
+} PixelFormatInfo;
+
+static const PixelFormatInfo *GetPixelFormatInfo( PLImageFormat format ) {
+	static const PixelFormatInfo rgb565 = { PIXEL_PACKED16, 3, 2, { 5, 6, 5, 0 }, { 11, 5, 0, 0 } };
+	static const PixelFormatInfo rgb5a1 = { PIXEL_PACKED16, 4, 2, { 5, 5, 5, 1 }, { 11, 6, 1, 0 } };
+	static const PixelFormatInfo rgba4 = { PIXEL_PACKED16, 4, 2, { 4, 4, 4, 4 }, { 12, 8, 4, 0 } };
+	static const PixelFormatInfo rgb8 = { PIXEL_UNORM8, 3, 3 };
+	static const PixelFormatInfo rgba8 = { PIXEL_UNORM8, 4, 4 };
+	static const PixelFormatInfo rgba16f = { PIXEL_HALF, 4, 8 };
+
+	switch ( format ) {
+		case PL_IMAGEFORMAT_RGB565:
+			return &rgb565;
+		case PL_IMAGEFORMAT_RGB5A1:
+			return &rgb5a1;
+		case PL_IMAGEFORMAT_RGBA4:
+			return &rgba4;
+		case PL_IMAGEFORMAT_RGB8:
+			return &rgb8;
+		case PL_IMAGEFORMAT_RGBA8:
+			return &rgba8;
+		case PL_IMAGEFORMAT_RGBA16F:
+			return &rgba16f;
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * Fills in which colour (PL_RED, PL_GREEN...) is held in each channel
+ * of a pixel. Colour formats with the wrong number of channels for the
+ * pixel format either gain or lose their alpha.
+ */
+static void GetChannelOrder( PLColourFormat colourFormat, unsigned int numChannels, uint8_t *order ) {
+	bool isBGR = ( colourFormat == PL_COLOURFORMAT_BGR || colourFormat == PL_COLOURFORMAT_BGRA || colourFormat == PL_COLOURFORMAT_ABGR );
+	bool isAlphaFirst = ( numChannels == 4 ) && ( colourFormat == PL_COLOURFORMAT_ARGB || colourFormat == PL_COLOURFORMAT_ABGR );
+
+	unsigned int i = 0;
+	if ( isAlphaFirst ) {
+		order[ i++ ] = PL_ALPHA;
+	}
+	order[ i++ ] = isBGR ? PL_BLUE : PL_RED;
+	order[ i++ ] = PL_GREEN;
+	order[ i++ ] = isBGR ? PL_RED : PL_BLUE;
+	if ( numChannels == 4 && !isAlphaFirst ) {
+		order[ i ] = PL_ALPHA;
+	}
+}
+
+static const uint8_t rgbaOrder[ 4 ] = { PL_RED, PL_GREEN, PL_BLUE, PL_ALPHA };
+
+/* * * * * * * * * * * * * * * * * * * */
+/* 8-bit Shuffles                      */
+
+/**
+ * Fills in the source channel for each destination channel,
+ * or -1 where there's no alpha to copy and it should be opaque.
+ */
+static void GetShuffleMap( const uint8_t *srcOrder, unsigned int srcChannels, const uint8_t *dstOrder, unsigned int dstChannels, int *map ) {
+	for ( unsigned int i = 0; i < dstChannels; ++i ) {
+		map[ i ] = -1;
+		for ( unsigned int j = 0; j < srcChannels; ++j ) {
+			if ( srcOrder[ j ] == dstOrder[ i ] ) {
+				map[ i ] = ( int ) j;
+				break;
+			}
+		}
+	}
+}
+
+#if defined( PL_IMAGE_AVX2 )
+
+static bool HasAVX2( void ) {
+	return __builtin_cpu_supports( "avx2" );
+}
+
+/**
+ * Shuffles eight pixels at a time, four in each 128-bit lane. Returns
+ * the number of pixels that were converted, leaving the rest for the
+ * scalar loop.
+ */
+__attribute__( ( target( "avx2" ) ) ) static size_t ShufflePixelsAVX2( const uint8_t *src, unsigned int srcStride, uint8_t *dst, unsigned int dstStride, const int *map, size_t numPixels ) {
+	uint8_t shuffle[ 16 ], fill[ 16 ];
+	memset( shuffle, 0x80, sizeof( shuffle ) );
+	memset( fill, 0, sizeof( fill ) );
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		for ( unsigned int j = 0; j < dstStride; ++j ) {
+			unsigned int k = i * dstStride + j;
+			if ( map[ j ] < 0 ) {
+				fill[ k ] = 0xFF;
+			} else {
+				shuffle[ k ] = ( uint8_t ) ( i * srcStride + ( unsigned int ) map[ j ] );
+			}
+		}
+	}
+
+	__m256i shuffleMask = _mm256_broadcastsi128_si256( _mm_loadu_si128( ( const __m128i * ) shuffle ) );
+	__m256i fillMask = _mm256_broadcastsi128_si256( _mm_loadu_si128( ( const __m128i * ) fill ) );
+
+	/* 24-bit pixels are loaded as two overlapping 16 byte reads, so
+	 * stop early enough that the second never runs off the end */
+	size_t margin = ( srcStride == 4 ) ? 8 : 10;
+	size_t i = 0;
+	for ( ; i + margin <= numPixels; i += 8 ) {
+		__m256i v;
+		if ( srcStride == 4 ) {
+			v = _mm256_loadu_si256( ( const __m256i * ) &src[ i * 4 ] );
+		} else {
+			const uint8_t *s = &src[ i * 3 ];
+			v = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( ( const __m128i * ) s ) ),
+			                             _mm_loadu_si128( ( const __m128i * ) ( s + 12 ) ), 1 );
+		}
+
+		v = _mm256_or_si256( _mm256_shuffle_epi8( v, shuffleMask ), fillMask );
+
+		if ( dstStride == 4 ) {
+			_mm256_storeu_si256( ( __m256i * ) &dst[ i * 4 ], v );
+		} else {
+			/* the upper lane is stored in pieces to avoid writing past
+			 * the pixels, which matters when converting in place */
+			uint8_t *d = &dst[ i * 3 ];
+			__m128i hi = _mm256_extracti128_si256( v, 1 );
+			_mm_storeu_si128( ( __m128i * ) d, _mm256_castsi256_si128( v ) );
+			_mm_storel_epi64( ( __m128i * ) ( d + 12 ), hi );
+			uint32_t tail = ( uint32_t ) _mm_cvtsi128_si32( _mm_srli_si128( hi, 8 ) );
+			memcpy( d + 20, &tail, sizeof( tail ) );
+		}
+	}
+
+	return i;
+}
+
+#endif
+
+/**
+ * Reorders, adds or drops channels between the 8-bit formats. The
+ * destination may be the source, so long as it's no larger.
+ */
+static void ShufflePixels( const uint8_t *src, unsigned int srcStride, uint8_t *dst, unsigned int dstStride, const int *map, size_t numPixels ) {
+	size_t i = 0;
+	if ( srcStride == 4 && dstStride == 4 && map[ 0 ] == 2 && map[ 1 ] == 1 && map[ 2 ] == 0 && map[ 3 ] == 3 ) {
+#if defined( PL_SIMD_SSE2 )
+		/* red and blue swap, which is by far the most common */
+		const __m128i ga = _mm_set1_epi32( ( int ) 0xFF00FF00 );
+		for ( ; i + 4 <= numPixels; i += 4 ) {
+			__m128i v = _mm_loadu_si128( ( const __m128i * ) &src[ i * 4 ] );
+			__m128i rb = _mm_andnot_si128( ga, v );
+			rb = _mm_shufflehi_epi16( _mm_shufflelo_epi16( rb, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+			_mm_storeu_si128( ( __m128i * ) &dst[ i * 4 ], _mm_or_si128( _mm_and_si128( v, ga ), rb ) );
+		}
+#endif
+	}
+#if defined( PL_IMAGE_AVX2 )
+	else if ( HasAVX2() ) {
+		i = ShufflePixelsAVX2( src, srcStride, dst, dstStride, map, numPixels );
+	}
+#endif
+
+	for ( ; i < numPixels; ++i ) {
+		const uint8_t *s = &src[ i * srcStride ];
+		uint8_t pixel[ 4 ] = { s[ 0 ], s[ 1 ], s[ 2 ], ( srcStride == 4 ) ? s[ 3 ] : 255 };
+
+		uint8_t *d = &dst[ i * dstStride ];
+		for ( unsigned int j = 0; j < dstStride; ++j ) {
+			d[ j ] = ( map[ j ] < 0 ) ? 255 : pixel[ map[ j ] ];
+		}
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Packed 16-bit                       */
+
+static const uint8_t expand4to8[ 16 ] = {
+	0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255,
+};
+
+static const uint8_t expand5to8[ 32 ] = {
+	0, 8, 16, 24, 33, 41, 49, 57, 66, 74, 82, 90, 99, 107, 115, 123,
+	132, 140, 148, 156, 165, 173, 181, 189, 198, 206, 214, 222, 231, 239, 247, 255,
+};
+
+static const uint8_t expand6to8[ 64 ] = {
+	0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60,
+	65, 69, 73, 77, 81, 85, 89, 93, 97, 101, 105, 109, 113, 117, 121, 125,
+	130, 134, 138, 142, 146, 150, 154, 158, 162, 166, 170, 174, 178, 182, 186, 190,
+	195, 199, 203, 207, 211, 215, 219, 223, 227, 231, 235, 239, 243, 247, 251, 255,
+};
+
+static uint8_t ExpandBits( unsigned int value, unsigned int numBits ) {
+	switch ( numBits ) {
+		case 1:
+			return value ? 255 : 0;
+		case 4:
+			return expand4to8[ value ];
+		case 5:
+			return expand5to8[ value ];
+		default:
+			return expand6to8[ value ];
+	}
+}
+
+static unsigned int ReduceBits( uint8_t value, unsigned int numBits ) {
+	unsigned int mask = ( 1U << numBits ) - 1;
+	return ( value * mask + 127 ) / 255;
+}
+
+#if defined( PL_SIMD_SSE2 )
+
+/**
+ * Same as the lookup tables, by replicating the top bits into the bottom.
+ */
+static __m128i ExpandBitsSSE2( __m128i value, unsigned int numBits ) {
+	if ( numBits == 1 ) {
+		return _mm_and_si128( _mm_sub_epi16( _mm_setzero_si128(), value ), _mm_set1_epi16( 0xFF ) );
+	}
+
+	return _mm_or_si128( _mm_sll_epi16( value, _mm_cvtsi32_si128( ( int ) ( 8 - numBits ) ) ),
+	                     _mm_srl_epi16( value, _mm_cvtsi32_si128( ( int ) ( 2 * numBits - 8 ) ) ) );
+}
+
+#endif
+
+static void DecodePacked16( const PixelFormatInfo *info, const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	size_t i = 0;
+#if defined( PL_SIMD_SSE2 )
+	for ( ; i + 8 <= numPixels; i += 8 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i * ) &src[ i * 2 ] );
+		v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+
+		__m128i colours[ 4 ];
+		colours[ PL_ALPHA ] = _mm_set1_epi16( 0xFF );
+		for ( unsigned int j = 0; j < info->numChannels; ++j ) {
+			__m128i c = _mm_and_si128( _mm_srl_epi16( v, _mm_cvtsi32_si128( info->shifts[ j ] ) ), _mm_set1_epi16( ( short ) ( ( 1 << info->bits[ j ] ) - 1 ) ) );
+			colours[ order[ j ] ] = ExpandBitsSSE2( c, info->bits[ j ] );
+		}
+
+		__m128i rg = _mm_or_si128( colours[ PL_RED ], _mm_slli_epi16( colours[ PL_GREEN ], 8 ) );
+		__m128i ba = _mm_or_si128( colours[ PL_BLUE ], _mm_slli_epi16( colours[ PL_ALPHA ], 8 ) );
+		_mm_storeu_si128( ( __m128i * ) &dst[ i * 4 ], _mm_unpacklo_epi16( rg, ba ) );
+		_mm_storeu_si128( ( __m128i * ) &dst[ i * 4 + 16 ], _mm_unpackhi_epi16( rg, ba ) );
+	}
+#endif
+
+	for ( ; i < numPixels; ++i ) {
+		unsigned int word = ( src[ i * 2 ] << 8 ) | src[ i * 2 + 1 ];
+
+		uint8_t *d = &dst[ i * 4 ];
+		d[ PL_ALPHA ] = 255;
+		for ( unsigned int j = 0; j < info->numChannels; ++j ) {
+			d[ order[ j ] ] = ExpandBits( ( word >> info->shifts[ j ] ) & ( ( 1U << info->bits[ j ] ) - 1 ), info->bits[ j ] );
+		}
+	}
+}
+
+static void EncodePacked16( const PixelFormatInfo *info, const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		const uint8_t *s = &src[ i * 4 ];
+
+		unsigned int word = 0;
+		for ( unsigned int j = 0; j < info->numChannels; ++j ) {
+			word |= ReduceBits( s[ order[ j ] ], info->bits[ j ] ) << info->shifts[ j ];
+		}
+
+		dst[ i * 2 ] = ( uint8_t ) ( word >> 8 );
+		dst[ i * 2 + 1 ] = ( uint8_t ) word;
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Half Float                          */
+
+static const uint16_t unorm8ToHalf[ 256 ] = {
+	0x0000, 0x1C04, 0x2004, 0x2206, 0x2404, 0x2505, 0x2606, 0x2707,
+	0x2804, 0x2885, 0x2905, 0x2986, 0x2A06, 0x2A87, 0x2B07, 0x2B88,
+	0x2C04, 0x2C44, 0x2C85, 0x2CC5, 0x2D05, 0x2D45, 0x2D86, 0x2DC6,
+	0x2E06, 0x2E46, 0x2E87, 0x2EC7, 0x2F07, 0x2F47, 0x2F88, 0x2FC8,
+	0x3004, 0x3024, 0x3044, 0x3064, 0x3085, 0x30A5, 0x30C5, 0x30E5,
+	0x3105, 0x3125, 0x3145, 0x3165, 0x3186, 0x31A6, 0x31C6, 0x31E6,
+	0x3206, 0x3226, 0x3246, 0x3266, 0x3287, 0x32A7, 0x32C7, 0x32E7,
+	0x3307, 0x3327, 0x3347, 0x3367, 0x3388, 0x33A8, 0x33C8, 0x33E8,
+	0x3404, 0x3414, 0x3424, 0x3434, 0x3444, 0x3454, 0x3464, 0x3474,
+	0x3485, 0x3495, 0x34A5, 0x34B5, 0x34C5, 0x34D5, 0x34E5, 0x34F5,
+	0x3505, 0x3515, 0x3525, 0x3535, 0x3545, 0x3555, 0x3565, 0x3575,
+	0x3586, 0x3596, 0x35A6, 0x35B6, 0x35C6, 0x35D6, 0x35E6, 0x35F6,
+	0x3606, 0x3616, 0x3626, 0x3636, 0x3646, 0x3656, 0x3666, 0x3676,
+	0x3687, 0x3697, 0x36A7, 0x36B7, 0x36C7, 0x36D7, 0x36E7, 0x36F7,
+	0x3707, 0x3717, 0x3727, 0x3737, 0x3747, 0x3757, 0x3767, 0x3777,
+	0x3788, 0x3798, 0x37A8, 0x37B8, 0x37C8, 0x37D8, 0x37E8, 0x37F8,
+	0x3804, 0x380C, 0x3814, 0x381C, 0x3824, 0x382C, 0x3834, 0x383C,
+	0x3844, 0x384C, 0x3854, 0x385C, 0x3864, 0x386C, 0x3874, 0x387C,
+	0x3885, 0x388D, 0x3895, 0x389D, 0x38A5, 0x38AD, 0x38B5, 0x38BD,
+	0x38C5, 0x38CD, 0x38D5, 0x38DD, 0x38E5, 0x38ED, 0x38F5, 0x38FD,
+	0x3905, 0x390D, 0x3915, 0x391D, 0x3925, 0x392D, 0x3935, 0x393D,
+	0x3945, 0x394D, 0x3955, 0x395D, 0x3965, 0x396D, 0x3975, 0x397D,
+	0x3986, 0x398E, 0x3996, 0x399E, 0x39A6, 0x39AE, 0x39B6, 0x39BE,
+	0x39C6, 0x39CE, 0x39D6, 0x39DE, 0x39E6, 0x39EE, 0x39F6, 0x39FE,
+	0x3A06, 0x3A0E, 0x3A16, 0x3A1E, 0x3A26, 0x3A2E, 0x3A36, 0x3A3E,
+	0x3A46, 0x3A4E, 0x3A56, 0x3A5E, 0x3A66, 0x3A6E, 0x3A76, 0x3A7E,
+	0x3A87, 0x3A8F, 0x3A97, 0x3A9F, 0x3AA7, 0x3AAF, 0x3AB7, 0x3ABF,
+	0x3AC7, 0x3ACF, 0x3AD7, 0x3ADF, 0x3AE7, 0x3AEF, 0x3AF7, 0x3AFF,
+	0x3B07, 0x3B0F, 0x3B17, 0x3B1F, 0x3B27, 0x3B2F, 0x3B37, 0x3B3F,
+	0x3B47, 0x3B4F, 0x3B57, 0x3B5F, 0x3B67, 0x3B6F, 0x3B77, 0x3B7F,
+	0x3B88, 0x3B90, 0x3B98, 0x3BA0, 0x3BA8, 0x3BB0, 0x3BB8, 0x3BC0,
+	0x3BC8, 0x3BD0, 0x3BD8, 0x3BE0, 0x3BE8, 0x3BF0, 0x3BF8, 0x3C00,
+};
+
+/**
+ * Anything outside of 0 to 1 is clamped, and NaN becomes zero.
+ */
+static uint8_t HalfToUnorm8( uint16_t value ) {
+	if ( value & 0x8000 ) {
+		return 0;
+	}
+
+	unsigned int exponent = ( value >> 10 ) & 0x1F;
+	unsigned int mantissa = value & 0x3FF;
+	if ( exponent == 0x1F ) {
+		return mantissa ? 0 : 255;
+	} else if ( exponent >= 15 ) {
+		return 255;
+	}
+
+	float f;
+	if ( exponent == 0 ) {
+		f = ( float ) mantissa * ( 1.0f / ( float ) ( 1 << 24 ) );
+	} else {
+		f = ( float ) ( mantissa | 0x400 ) * ( 1.0f / ( float ) ( 1 << ( 25 - exponent ) ) );
+	}
+
+	return ( uint8_t ) ( f * 255.0f + 0.5f );
+}
+
+static void DecodeHalf( const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		uint16_t pixel[ 4 ];
+		memcpy( pixel, &src[ i * 8 ], sizeof( pixel ) );
+
+		uint8_t *d = &dst[ i * 4 ];
+		for ( unsigned int j = 0; j < 4; ++j ) {
+			d[ order[ j ] ] = HalfToUnorm8( pixel[ j ] );
+		}
+	}
+}
+
+static void EncodeHalf( const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		const uint8_t *s = &src[ i * 4 ];
+
+		uint16_t pixel[ 4 ];
+		for ( unsigned int j = 0; j < 4; ++j ) {
+			pixel[ j ] = unorm8ToHalf[ s[ order[ j ] ] ];
+		}
+
+		memcpy( &dst[ i * 8 ], pixel, sizeof( pixel ) );
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+
+static void DecodePixels( const PixelFormatInfo *info, const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	switch ( info->type ) {
+		case PIXEL_UNORM8: {
+			int map[ 4 ];
+			GetShuffleMap( order, info->numChannels, rgbaOrder, 4, map );
+			ShufflePixels( src, info->bytesPerPixel, dst, 4, map, numPixels );
+			break;
+		}
+		case PIXEL_PACKED16:
+			DecodePacked16( info, order, src, dst, numPixels );
+			break;
+		case PIXEL_HALF:
+			DecodeHalf( order, src, dst, numPixels );
+			break;
+	}
+}
+
+static void EncodePixels( const PixelFormatInfo *info, const uint8_t *order, const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	switch ( info->type ) {
+		case PIXEL_UNORM8: {
+			int map[ 4 ];
+			GetShuffleMap( rgbaOrder, 4, order, info->numChannels, map );
+			ShufflePixels( src, 4, dst, info->bytesPerPixel, map, numPixels );
+			break;
+		}
+		case PIXEL_PACKED16:
+			EncodePacked16( info, order, src, dst, numPixels );
+			break;
+		case PIXEL_HALF:
+			EncodeHalf( order, src, dst, numPixels );
+			break;
+	}
+}
+
+static bool IsRGBA8( const PixelFormatInfo *info, const uint8_t *order ) {
+	return info->type == PIXEL_UNORM8 && info->numChannels == 4 && memcmp( order, rgbaOrder, sizeof( rgbaOrder ) ) == 0;
+}
+
+/**
+ * Converts the given pixels. The destination may be the same as the
+ * source, so long as the new format is no larger than the old one.
+ */
+static void ConvertPixels( const PixelFormatInfo *srcInfo, const uint8_t *srcOrder, const uint8_t *src,
+                           const PixelFormatInfo *dstInfo, const uint8_t *dstOrder, uint8_t *dst, size_t numPixels ) {
+	if ( srcInfo->type == PIXEL_UNORM8 && dstInfo->type == PIXEL_UNORM8 ) {
+		int map[ 4 ];
+		GetShuffleMap( srcOrder, srcInfo->numChannels, dstOrder, dstInfo->numChannels, map );
+		ShufflePixels( src, srcInfo->bytesPerPixel, dst, dstInfo->bytesPerPixel, map, numPixels );
+		return;
+	} else if ( IsRGBA8( srcInfo, srcOrder ) ) {
+		EncodePixels( dstInfo, dstOrder, src, dst, numPixels );
+		return;
+	} else if ( IsRGBA8( dstInfo, dstOrder ) ) {
+		DecodePixels( srcInfo, srcOrder, src, dst, numPixels );
+		return;
+	}
+
+	/* otherwise go through RGBA8 a batch at a time, each batch is read
+	 * in full before it's written so this is still safe in place */
+	uint8_t rgba[ 256 * 4 ];
+	for ( size_t i = 0; i < numPixels; i += 256 ) {
+		size_t n = ( numPixels - i < 256 ) ? ( numPixels - i ) : 256;
+		DecodePixels( srcInfo, srcOrder, &src[ i * srcInfo->bytesPerPixel ], rgba, n );
+		EncodePixels( dstInfo, dstOrder, rgba, &dst[ i * dstInfo->bytesPerPixel ], n );
+	}
+}
+
+static bool ConvertImage( PLImage *image, PLImageFormat newFormat, PLColourFormat newColourFormat ) {
+	const PixelFormatInfo *srcInfo = GetPixelFormatInfo( image->format );
+	const PixelFormatInfo *dstInfo = GetPixelFormatInfo( newFormat );
+	if ( srcInfo == NULL || dstInfo == NULL ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format conversion" );
+		return false;
+	}
+
+	uint8_t srcOrder[ 4 ], dstOrder[ 4 ];
+	GetChannelOrder( image->colour_format, srcInfo->numChannels, srcOrder );
+	GetChannelOrder( newColourFormat, dstInfo->numChannels, dstOrder );
+
+	/* anything that doesn't grow is converted in place, otherwise every
+	 * level is allocated up front so a failure leaves the image as-is */
+	bool inPlace = ( dstInfo->bytesPerPixel <= srcInfo->bytesPerPixel );
+	uint8_t **levels = NULL;
+	if ( !inPlace ) {
+		levels = pl_calloc( image->levels, sizeof( uint8_t * ) );
+		if ( levels == NULL ) {
+			return false;
+		}
+
+		for ( unsigned int i = 0; i < image->levels; ++i ) {
+			unsigned int w = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+			unsigned int h = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+			levels[ i ] = pl_malloc( plGetImageSize( newFormat, w, h ) );
+			if ( levels[ i ] == NULL ) {
+				for ( unsigned int j = 0; j < i; ++j ) {
+					pl_free( levels[ j ] );
+				}
+				pl_free( levels );
+
+				ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image data" );
+				return false;
+			}
+		}
+	}
+
+	for ( unsigned int i = 0; i < image->levels; ++i ) {
+		unsigned int w = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+		unsigned int h = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+		size_t numPixels = ( size_t ) w * h;
+
+		if ( inPlace ) {
+			ConvertPixels( srcInfo, srcOrder, image->data[ i ], dstInfo, dstOrder, image->data[ i ], numPixels );
+			if ( dstInfo->bytesPerPixel < srcInfo->bytesPerPixel ) {
+				/* hand back the slack, keeping the original if that fails */
+				uint8_t *data = pl_realloc( image->data[ i ], plGetImageSize( newFormat, w, h ) );
+				if ( data != NULL ) {
+					image->data[ i ] = data;
+				}
+			}
+			continue;
+		}
+
+		ConvertPixels( srcInfo, srcOrder, image->data[ i ], dstInfo, dstOrder, levels[ i ], numPixels );
+		pl_free( image->data[ i ] );
+		image->data[ i ] = levels[ i ];
+	}
+
+	pl_free( levels );
+
+	image->format = newFormat;
+	image->colour_format = newColourFormat;
+	image->size = plGetImageSize( newFormat, image->width, image->height );
+
+	return true;
+}
+
+/**
+ * Converts every level of the image into the given pixel format. The
+ * channels of the result are always in RGB or RGBA order. Conversions
+ * into the compressed formats use the normal compression quality.
+ */
+bool plConvertPixelFormat( PLImage *image, PLImageFormat new_format ) {
+	/* uncompressed formats always come out in RGB(A) order, so one that's
+	 * already in the right format may still need its channels reordering */
+	const PixelFormatInfo *info = GetPixelFormatInfo( new_format );
+	PLColourFormat colourFormat = ( info != NULL && info->numChannels == 4 ) ? PL_COLOURFORMAT_RGBA : PL_COLOURFORMAT_RGB;
+	if ( image->format == new_format && ( info == NULL || image->colour_format == colourFormat ) ) {
+		return true;
+	}
+
+	/* compressed images are decoded to RGBA8 first, and encoded from it */
+	if ( plIsCompressedImageFormat( new_format ) ) {
+		return plCompressImage( image, new_format, PL_IMAGECOMPRESSION_NORMAL );
+	} else if ( plIsCompressedImageFormat( image->format ) ) {
+		return plDecompressImage( image ) && plConvertPixelFormat( image, new_format );
+	}
+
+	if ( info == NULL ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format conversion" );
+		return false;
+	}
+
+	return ConvertImage( image, new_format, colourFormat );
+}
+
+/**
+ * Reorders the channels of every level of the image, e.g. from BGRA to
+ * RGBA. The new colour format must have as many channels as the pixel
+ * format of the image.
+ */
+bool plConvertColourFormat( PLImage *image, PLColourFormat newFormat ) {
+	if ( image->colour_format == newFormat ) {
+		return true;
+	}
+
+	const PixelFormatInfo *info = GetPixelFormatInfo( image->format );
+	if ( info == NULL ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format conversion" );
+		return false;
+	} else if ( plGetNumberOfColourChannels( newFormat ) != info->numChannels ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "colour format doesn't match the pixel format" );
+		return false;
+	}
+
+	return ConvertImage( image, image->format, newFormat );
+}
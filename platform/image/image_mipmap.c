@@ -0,0 +1,406 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "image_private.h"
+
+/* Generation of the mip chain on the CPU. The plain box filter works
+ * on the 8-bit pixels directly, everything else keeps each level in
+ * floating point so that the next one can be built from it without
+ * picking up rounding along the way. */
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Vectors                             */
+
+#if defined( PL_SIMD_SSE2 )
+
+typedef __m128 MipPixel;
+
+#	define MipPixelZero()            _mm_setzero_ps()
+#	define MipPixelSplat( a )        _mm_set1_ps( a )
+#	define MipPixelAdd( a, b )       _mm_add_ps( a, b )
+#	define MipPixelMul( a, b )       _mm_mul_ps( a, b )
+
+#else
+
+typedef struct MipPixel {
+	float v[ 4 ];
+} MipPixel;
+
+static MipPixel MipPixelZero( void ) {
+	MipPixel p = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+	return p;
+}
+
+static MipPixel MipPixelSplat( float a ) {
+	MipPixel p = { { a, a, a, a } };
+	return p;
+}
+
+static MipPixel MipPixelAdd( MipPixel a, MipPixel b ) {
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		a.v[ i ] += b.v[ i ];
+	}
+	return a;
+}
+
+static MipPixel MipPixelMul( MipPixel a, MipPixel b ) {
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		a.v[ i ] *= b.v[ i ];
+	}
+	return a;
+}
+
+#endif
+
+/* * * * * * * * * * * * * * * * * * * */
+/* sRGB                                */
+
+/* tables rather than pow(), so the results don't depend on the maths
+ * library they were built with */
+
+static const float srgbToLinear[ 256 ] = {
+	0.0f, 0.000303526984f, 0.000607053967f, 0.000910580951f, 0.00121410793f, 0.00151763492f,
+	0.0018211619f, 0.00212468888f, 0.00242821587f, 0.00273174285f, 0.00303526984f, 0.00334653576f,
+	0.00367650732f, 0.00402471702f, 0.00439144204f, 0.00477695348f, 0.0051815167f, 0.00560539162f,
+	0.00604883302f, 0.00651209079f, 0.00699541019f, 0.00749903204f, 0.00802319299f, 0.00856812562f,
+	0.0091340587f, 0.00972121732f, 0.010329823f, 0.010960094f, 0.0116122452f, 0.0122864884f,
+	0.0129830323f, 0.013702083f, 0.0144438436f, 0.0152085144f, 0.0159962934f, 0.0168073758f,
+	0.0176419545f, 0.0185002201f, 0.019382361f, 0.0202885631f, 0.0212190104f, 0.0221738848f,
+	0.0231533662f, 0.0241576324f, 0.0251868596f, 0.0262412219f, 0.0273208916f, 0.0284260395f,
+	0.0295568344f, 0.0307134437f, 0.0318960331f, 0.0331047666f, 0.0343398068f, 0.0356013149f,
+	0.0368894504f, 0.0382043716f, 0.0395462353f, 0.0409151969f, 0.0423114106f, 0.0437350293f,
+	0.0451862044f, 0.0466650863f, 0.0481718242f, 0.049706566f, 0.0512694584f, 0.052860647f,
+	0.0544802764f, 0.05612849f, 0.0578054302f, 0.0595112382f, 0.0612460542f, 0.0630100177f,
+	0.0648032667f, 0.0666259386f, 0.0684781698f, 0.0703600957f, 0.0722718507f, 0.0742135684f,
+	0.0761853815f, 0.0781874218f, 0.0802198203f, 0.0822827071f, 0.0843762115f, 0.086500462f,
+	0.0886555863f, 0.0908417112f, 0.0930589628f, 0.0953074666f, 0.0975873471f, 0.0998987282f,
+	0.102241733f, 0.104616484f, 0.107023103f, 0.109461711f, 0.111932428f, 0.114435374f,
+	0.116970668f, 0.119538428f, 0.122138772f, 0.124771818f, 0.12743768f, 0.130136477f,
+	0.132868322f, 0.13563333f, 0.138431615f, 0.141263291f, 0.144128471f, 0.147027266f,
+	0.14995979f, 0.152926152f, 0.155926464f, 0.158960835f, 0.162029376f, 0.165132195f,
+	0.1682694f, 0.171441101f, 0.174647404f, 0.177888416f, 0.181164244f, 0.184474995f,
+	0.187820772f, 0.191201683f, 0.19461783f, 0.19806932f, 0.201556254f, 0.205078736f,
+	0.20863687f, 0.212230757f, 0.2158605f, 0.2195262f, 0.223227957f, 0.226965874f,
+	0.230740049f, 0.234550582f, 0.238397574f, 0.242281122f, 0.246201327f, 0.250158285f,
+	0.254152094f, 0.258182853f, 0.262250658f, 0.266355605f, 0.270497791f, 0.274677312f,
+	0.278894263f, 0.28314874f, 0.287440838f, 0.29177065f, 0.296138271f, 0.300543794f,
+	0.304987314f, 0.309468923f, 0.313988713f, 0.318546778f, 0.323143209f, 0.327778098f,
+	0.332451536f, 0.337163615f, 0.341914425f, 0.346704056f, 0.3515326f, 0.356400144f,
+	0.36130678f, 0.366252596f, 0.37123768f, 0.376262123f, 0.381326011f, 0.386429434f,
+	0.391572478f, 0.396755231f, 0.40197778f, 0.407240212f, 0.412542613f, 0.417885071f,
+	0.42326767f, 0.428690497f, 0.434153636f, 0.439657174f, 0.445201195f, 0.450785783f,
+	0.456411023f, 0.462077f, 0.467783796f, 0.473531496f, 0.479320183f, 0.48514994f,
+	0.49102085f, 0.496932995f, 0.502886458f, 0.508881321f, 0.514917665f, 0.520995573f,
+	0.527115126f, 0.533276404f, 0.539479489f, 0.545724461f, 0.552011402f, 0.55834039f,
+	0.564711506f, 0.571124829f, 0.57758044f, 0.584078418f, 0.590618841f, 0.597201788f,
+	0.603827339f, 0.610495571f, 0.617206562f, 0.623960392f, 0.630757136f, 0.637596874f,
+	0.644479682f, 0.651405637f, 0.658374817f, 0.665387298f, 0.672443157f, 0.67954247f,
+	0.686685312f, 0.693871761f, 0.701101892f, 0.70837578f, 0.715693501f, 0.723055129f,
+	0.73046074f, 0.737910409f, 0.74540421f, 0.752942217f, 0.760524505f, 0.768151147f,
+	0.775822218f, 0.783537792f, 0.79129794f, 0.799102738f, 0.806952258f, 0.814846572f,
+	0.822785754f, 0.830769877f, 0.838799012f, 0.846873232f, 0.854992608f, 0.863157213f,
+	0.871367119f, 0.879622397f, 0.887923118f, 0.896269353f, 0.904661174f, 0.913098652f,
+	0.921581856f, 0.930110858f, 0.938685728f, 0.947306537f, 0.955973353f, 0.964686248f,
+	0.97344529f, 0.98225055f, 0.991102097f, 1.0f,
+};
+
+/* the linear value halfway between each pair of neighbouring codes */
+static const float srgbThresholds[ 255 ] = {
+	0.000151763492f, 0.000455290475f, 0.000758817459f, 0.00106234444f, 0.00136587143f, 0.00166939841f,
+	0.00197292539f, 0.00227645238f, 0.00257997936f, 0.00288350634f, 0.0031883009f, 0.00350925935f,
+	0.00384831493f, 0.00420574803f, 0.00458183274f, 0.00497683725f, 0.00539102416f, 0.00582465078f,
+	0.00627796943f, 0.00675122763f, 0.00724466842f, 0.0077585305f, 0.00829304845f, 0.00884845295f,
+	0.00942497089f, 0.0100228256f, 0.0106422369f, 0.0112834213f, 0.0119465921f, 0.0126319598f,
+	0.0133397316f, 0.014070112f, 0.0148233028f, 0.0155995031f, 0.0163989095f, 0.0172217161f,
+	0.0180681146f, 0.0189382945f, 0.0198324428f, 0.0207507446f, 0.0216933829f, 0.0226605384f,
+	0.0236523902f, 0.024669115f, 0.0257108881f, 0.0267778826f, 0.0278702702f, 0.0289882206f,
+	0.0301319019f, 0.0313014806f, 0.0324971216f, 0.0337189882f, 0.0349672424f, 0.0362420443f,
+	0.037543553f, 0.0388719259f, 0.0402273192f, 0.0416098877f, 0.0430197848f, 0.0444571628f,
+	0.0459221727f, 0.047414964f, 0.0489356854f, 0.0504844842f, 0.0520615066f, 0.0536668976f,
+	0.0553008013f, 0.0569633604f, 0.0586547169f, 0.0603750115f, 0.0621243839f, 0.0639029729f,
+	0.0657109163f, 0.0675483509f, 0.0694154125f, 0.0713122362f, 0.0732389559f, 0.0751957047f,
+	0.077182615f, 0.0791998181f, 0.0812474446f, 0.0833256241f, 0.0854344855f, 0.087574157f,
+	0.0897447658f, 0.0919464383f, 0.0941793004f, 0.096443477f, 0.0987390924f, 0.10106627f,
+	0.103425133f, 0.105815802f, 0.108238401f, 0.110693048f, 0.113179865f, 0.11569897f,
+	0.118250482f, 0.12083452f, 0.1234512f, 0.12610064f, 0.128782955f, 0.131498261f,
+	0.134246673f, 0.137028306f, 0.139843272f, 0.142691686f, 0.14557366f, 0.148489305f,
+	0.151438734f, 0.154422057f, 0.157439385f, 0.160490827f, 0.163576493f, 0.166696492f,
+	0.169850932f, 0.17303992f, 0.176263564f, 0.179521971f, 0.182815248f, 0.186143498f,
+	0.189506829f, 0.192905345f, 0.196339151f, 0.19980835f, 0.203313045f, 0.20685334f,
+	0.210429338f, 0.21404114f, 0.217688849f, 0.221372565f, 0.225092389f, 0.228848422f,
+	0.232640764f, 0.236469515f, 0.240334772f, 0.244236636f, 0.248175205f, 0.252150577f,
+	0.256162849f, 0.260212118f, 0.264298482f, 0.268422037f, 0.272582879f, 0.276781103f,
+	0.281016805f, 0.285290081f, 0.289601024f, 0.293949728f, 0.298336289f, 0.302760799f,
+	0.307223352f, 0.31172404f, 0.316262956f, 0.320840192f, 0.325455841f, 0.330109993f,
+	0.33480274f, 0.339534173f, 0.344304382f, 0.349113458f, 0.353961491f, 0.35884857f,
+	0.363774785f, 0.368740224f, 0.373744977f, 0.378789131f, 0.383872775f, 0.388995998f,
+	0.394158885f, 0.399361525f, 0.404604005f, 0.409886411f, 0.41520883f, 0.420571347f,
+	0.42597405f, 0.431417022f, 0.43690035f, 0.442424119f, 0.447988412f, 0.453593316f,
+	0.459238914f, 0.46492529f, 0.470652528f, 0.476420711f, 0.482229923f, 0.488080246f,
+	0.493971763f, 0.499904557f, 0.505878709f, 0.511894303f, 0.517951419f, 0.524050139f,
+	0.530190544f, 0.536372716f, 0.542596734f, 0.54886268f, 0.555170635f, 0.561520677f,
+	0.567912887f, 0.574347344f, 0.580824128f, 0.587343319f, 0.593904994f, 0.600509233f,
+	0.607156115f, 0.613845717f, 0.620578117f, 0.627353395f, 0.634171626f, 0.641032889f,
+	0.647937261f, 0.654884819f, 0.66187564f, 0.668909801f, 0.675987377f, 0.683108445f,
+	0.690273081f, 0.697481362f, 0.704733362f, 0.712029156f, 0.719368822f, 0.726752432f,
+	0.734180063f, 0.741651788f, 0.749167683f, 0.756727821f, 0.764332277f, 0.771981125f,
+	0.779674438f, 0.787412289f, 0.795194753f, 0.803021903f, 0.810893811f, 0.81881055f,
+	0.826772194f, 0.834778813f, 0.842830482f, 0.850927271f, 0.859069253f, 0.867256499f,
+	0.875489082f, 0.883767073f, 0.892090542f, 0.900459561f, 0.908874202f, 0.917334534f,
+	0.925840628f, 0.934392556f, 0.942990386f, 0.95163419f, 0.960324036f, 0.969059996f,
+	0.977842139f, 0.986670534f, 0.99554525f,
+};
+
+static uint8_t LinearToSrgb( float value ) {
+	unsigned int lo = 0, hi = 255;
+	while ( lo < hi ) {
+		unsigned int mid = ( lo + hi ) / 2;
+		if ( value > srgbThresholds[ mid ] ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return ( uint8_t ) lo;
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Averages each 2x2 square of 8-bit pixels, for either dimension
+ * the square is clamped to the edge when there's no pair.
+ */
+static void BoxFilterLevel( const uint8_t *src, unsigned int srcWidth, unsigned int srcHeight, uint8_t *dst, unsigned int dstWidth, unsigned int dstHeight, unsigned int numChannels ) {
+	size_t srcPitch = ( size_t ) srcWidth * numChannels;
+	for ( unsigned int y = 0; y < dstHeight; ++y ) {
+		const uint8_t *row0 = &src[ ( size_t ) ( y * 2 ) * srcPitch ];
+		const uint8_t *row1 = ( y * 2 + 1 < srcHeight ) ? row0 + srcPitch : row0;
+		uint8_t *out = &dst[ ( size_t ) y * dstWidth * numChannels ];
+
+		unsigned int x = 0;
+#if defined( PL_SIMD_SSE2 )
+		/* four source pixels into two, summed at 16-bit so the rounding
+		 * matches the scalar loop exactly */
+		if ( numChannels == 4 && srcWidth >= 2 ) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16( 2 );
+			for ( ; x + 2 <= dstWidth && x * 2 + 4 <= srcWidth; x += 2 ) {
+				__m128i a = _mm_loadu_si128( ( const __m128i * ) &row0[ x * 8 ] );
+				__m128i b = _mm_loadu_si128( ( const __m128i * ) &row1[ x * 8 ] );
+				__m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) );
+				__m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) );
+				lo = _mm_add_epi16( lo, _mm_srli_si128( lo, 8 ) );
+				hi = _mm_add_epi16( hi, _mm_srli_si128( hi, 8 ) );
+				__m128i sum = _mm_srli_epi16( _mm_add_epi16( _mm_unpacklo_epi64( lo, hi ), two ), 2 );
+				_mm_storel_epi64( ( __m128i * ) &out[ x * 4 ], _mm_packus_epi16( sum, zero ) );
+			}
+		}
+#endif
+		for ( ; x < dstWidth; ++x ) {
+			unsigned int x0 = x * 2;
+			unsigned int x1 = ( x0 + 1 < srcWidth ) ? x0 + 1 : x0;
+			for ( unsigned int i = 0; i < numChannels; ++i ) {
+				unsigned int sum = row0[ x0 * numChannels + i ] + row0[ x1 * numChannels + i ] +
+				                   row1[ x0 * numChannels + i ] + row1[ x1 * numChannels + i ];
+				out[ x * numChannels + i ] = ( uint8_t ) ( ( sum + 2 ) / 4 );
+			}
+		}
+	}
+}
+
+/* Kaiser windowed sinc (alpha 4, half-width 1.5 destination pixels)
+ * sampled at the six source pixels around each destination pixel */
+static const float kaiserWeights[ 6 ] = {
+	-0.0209924819f, 0.0945023329f, 0.426490149f, 0.426490149f, 0.0945023329f, -0.0209924819f,
+};
+
+/**
+ * Halves a line of pixels, which is either a row or column depending
+ * on the stride. A line of one pixel is left as it is.
+ */
+static void FilterLine( const MipPixel *src, unsigned int srcLength, size_t srcStride, MipPixel *dst, unsigned int dstLength, size_t dstStride, bool useKaiser ) {
+	if ( srcLength == 1 ) {
+		dst[ 0 ] = src[ 0 ];
+		return;
+	}
+
+	for ( unsigned int i = 0; i < dstLength; ++i ) {
+		MipPixel sum = MipPixelZero();
+		if ( useKaiser ) {
+			for ( int j = 0; j < 6; ++j ) {
+				int k = ( int ) i * 2 - 2 + j;
+				k = ( k < 0 ) ? 0 : ( k >= ( int ) srcLength ) ? ( int ) srcLength - 1 : k;
+				sum = MipPixelAdd( sum, MipPixelMul( src[ ( size_t ) k * srcStride ], MipPixelSplat( kaiserWeights[ j ] ) ) );
+			}
+		} else {
+			unsigned int k = ( i * 2 + 1 < srcLength ) ? i * 2 + 1 : i * 2;
+			sum = MipPixelMul( MipPixelAdd( src[ ( size_t ) i * 2 * srcStride ], src[ ( size_t ) k * srcStride ] ), MipPixelSplat( 0.5f ) );
+		}
+		dst[ ( size_t ) i * dstStride ] = sum;
+	}
+}
+
+static void FilterLevel( const MipPixel *src, unsigned int srcWidth, unsigned int srcHeight, MipPixel *dst, unsigned int dstWidth, unsigned int dstHeight, MipPixel *scratch, bool useKaiser ) {
+	/* rows into the scratch space, and then columns out of it */
+	for ( unsigned int y = 0; y < srcHeight; ++y ) {
+		FilterLine( &src[ ( size_t ) y * srcWidth ], srcWidth, 1, &scratch[ ( size_t ) y * dstWidth ], dstWidth, 1, useKaiser );
+	}
+	for ( unsigned int x = 0; x < dstWidth; ++x ) {
+		FilterLine( &scratch[ x ], srcHeight, dstWidth, &dst[ x ], dstHeight, dstWidth, useKaiser );
+	}
+}
+
+static void LoadLevel( const uint8_t *src, size_t numPixels, unsigned int numChannels, int alphaChannel, bool isGammaCorrect, MipPixel *dst ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		float v[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for ( unsigned int j = 0; j < numChannels; ++j ) {
+			uint8_t c = src[ i * numChannels + j ];
+			v[ j ] = ( isGammaCorrect && ( int ) j != alphaChannel ) ? srgbToLinear[ c ] : c / 255.0f;
+		}
+		memcpy( &dst[ i ], v, sizeof( v ) );
+	}
+}
+
+static void StoreLevel( const MipPixel *src, size_t numPixels, unsigned int numChannels, int alphaChannel, bool isGammaCorrect, uint8_t *dst ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		float v[ 4 ];
+		memcpy( v, &src[ i ], sizeof( v ) );
+		for ( unsigned int j = 0; j < numChannels; ++j ) {
+			/* the kaiser filter's negative lobes can overshoot */
+			float c = ( v[ j ] < 0.0f ) ? 0.0f : ( v[ j ] > 1.0f ) ? 1.0f : v[ j ];
+			dst[ i * numChannels + j ] = ( isGammaCorrect && ( int ) j != alphaChannel ) ? LinearToSrgb( c ) : ( uint8_t ) ( c * 255.0f + 0.5f );
+		}
+	}
+}
+
+/**
+ * Replaces any existing levels of the image with a full chain built
+ * from the first, down to 1x1. Only RGB8 and RGBA8 images are supported.
+ */
+bool plGenerateImageMipmaps( PLImage *image, unsigned int filter ) {
+	unsigned int numChannels;
+	if ( image->format == PL_IMAGEFORMAT_RGBA8 ) {
+		numChannels = 4;
+	} else if ( image->format == PL_IMAGEFORMAT_RGB8 ) {
+		numChannels = 3;
+	} else {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format for mipmap generation" );
+		return false;
+	}
+
+	if ( image->width == 0 || image->height == 0 ) {
+		ReportError( PL_RESULT_IMAGERESOLUTION, "invalid image resolution" );
+		return false;
+	}
+
+	int alphaChannel = -1;
+	if ( numChannels == 4 ) {
+		alphaChannel = ( image->colour_format == PL_COLOURFORMAT_ARGB || image->colour_format == PL_COLOURFORMAT_ABGR ) ? 0 : 3;
+	}
+
+	unsigned int numLevels = 1;
+	for ( unsigned int w = image->width, h = image->height; w > 1 || h > 1; ++numLevels ) {
+		w = ( w > 1 ) ? w / 2 : 1;
+		h = ( h > 1 ) ? h / 2 : 1;
+	}
+
+	uint8_t **levels = pl_calloc( numLevels, sizeof( uint8_t * ) );
+	if ( levels == NULL ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image levels" );
+		return false;
+	}
+
+	levels[ 0 ] = image->data[ 0 ];
+	for ( unsigned int i = 1; i < numLevels; ++i ) {
+		unsigned int w = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+		unsigned int h = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+		if ( ( levels[ i ] = pl_malloc( plGetImageSize( image->format, w, h ) ) ) == NULL ) {
+			for ( unsigned int j = 1; j < i; ++j ) {
+				pl_free( levels[ j ] );
+			}
+			pl_free( levels );
+
+			ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image data" );
+			return false;
+		}
+	}
+
+	bool isGammaCorrect = ( filter & PL_MIPMAPFILTER_GAMMA );
+	bool useKaiser = ( ( filter & ~PL_MIPMAPFILTER_GAMMA ) == PL_MIPMAPFILTER_KAISER );
+	if ( !isGammaCorrect && !useKaiser ) {
+		for ( unsigned int i = 1; i < numLevels; ++i ) {
+			unsigned int w = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+			unsigned int h = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+			unsigned int pw = ( image->width >> ( i - 1 ) ) > 0 ? ( image->width >> ( i - 1 ) ) : 1;
+			unsigned int ph = ( image->height >> ( i - 1 ) ) > 0 ? ( image->height >> ( i - 1 ) ) : 1;
+			BoxFilterLevel( levels[ i - 1 ], pw, ph, levels[ i ], w, h, numChannels );
+		}
+	} else {
+		/* the first level is the largest, so the rest always fit into
+		 * the space after it, and the scratch space is half of it */
+		size_t numPixels = ( size_t ) image->width * image->height;
+		MipPixel *pixels = pl_malloc( ( numPixels * 2 + ( numPixels / 2 + image->height ) ) * sizeof( MipPixel ) );
+		if ( pixels == NULL ) {
+			for ( unsigned int j = 1; j < numLevels; ++j ) {
+				pl_free( levels[ j ] );
+			}
+			pl_free( levels );
+
+			ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for filtering" );
+			return false;
+		}
+
+		MipPixel *scratch = pixels + numPixels * 2;
+		MipPixel *src = pixels;
+		MipPixel *dst = pixels + numPixels;
+		LoadLevel( levels[ 0 ], numPixels, numChannels, alphaChannel, isGammaCorrect, src );
+		for ( unsigned int i = 1; i < numLevels; ++i ) {
+			unsigned int w = ( image->width >> i ) > 0 ? ( image->width >> i ) : 1;
+			unsigned int h = ( image->height >> i ) > 0 ? ( image->height >> i ) : 1;
+			unsigned int pw = ( image->width >> ( i - 1 ) ) > 0 ? ( image->width >> ( i - 1 ) ) : 1;
+			unsigned int ph = ( image->height >> ( i - 1 ) ) > 0 ? ( image->height >> ( i - 1 ) ) : 1;
+			FilterLevel( src, pw, ph, dst, w, h, scratch, useKaiser );
+			StoreLevel( dst, ( size_t ) w * h, numChannels, alphaChannel, isGammaCorrect, levels[ i ] );
+
+			MipPixel *swap = src;
+			src = dst;
+			dst = swap;
+		}
+
+		pl_free( pixels );
+	}
+
+	for ( unsigned int i = 1; i < image->levels; ++i ) {
+		pl_free( image->data[ i ] );
+	}
+	pl_free( image->data );
+
+	image->data = levels;
+	image->levels = numLevels;
+
+	return true;
+}
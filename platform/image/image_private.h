@@ -31,6 +31,15 @@ For more information, please refer to <http://unlicense.org>
 
 #include <PL/platform_image.h>
 
+typedef void ( *PLImageRowsFunction )( void *userData, unsigned int worker, unsigned int firstRow, unsigned int lastRow );
+
+unsigned int _plGetNumImageWorkers( unsigned int numRows, unsigned int maxWorkers );
+void _plRunImageRows( PLImageRowsFunction ProcessRows, void *userData, unsigned int numRows, unsigned int maxWorkers );
+
 PLImage *plLoad3dfImage( const char *path );
 PLImage *plLoadFtxImage( const char *path );
 PLImage *plLoadTimImage( const char *path );
+
+bool plProbe3dfImage( const char *path, PLImageInfo *info );
+bool plProbeFtxImage( const char *path, PLImageInfo *info );
+bool plProbeTimImage( const char *path, PLImageInfo *info );
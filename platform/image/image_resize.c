@@ -0,0 +1,442 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include <PL/platform_math.h>
+
+#include "image_private.h"
+
+/* Resampling with separable polyphase filters. The weights for each
+ * axis are worked out once per output pixel, then the rows are
+ * filtered horizontally into a float buffer, which is filtered
+ * vertically into the new image. Both passes are split across
+ * threads in bands of rows. */
+
+#if defined( PL_SIMD_SSE2 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#	define PL_IMAGE_AVX
+#	include <immintrin.h>
+#endif
+
+#define RESIZE_MIN_PIXELS_PER_WORKER    16384
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Filters                             */
+
+static float Sinc( float x ) {
+	if ( x == 0.0f ) {
+		return 1.0f;
+	}
+
+	x *= ( float ) PL_PI;
+	return sinf( x ) / x;
+}
+
+static float BoxFilter( float x ) {
+	return ( x >= -0.5f && x < 0.5f ) ? 1.0f : 0.0f;
+}
+
+static float BilinearFilter( float x ) {
+	x = fabsf( x );
+	return ( x < 1.0f ) ? 1.0f - x : 0.0f;
+}
+
+static float Lanczos3Filter( float x ) {
+	return ( fabsf( x ) < 3.0f ) ? Sinc( x ) * Sinc( x / 3.0f ) : 0.0f;
+}
+
+/* Mitchell-Netravali with B = C = 1/3 */
+static float MitchellFilter( float x ) {
+	x = fabsf( x );
+	if ( x < 1.0f ) {
+		return ( 7.0f * x * x * x - 12.0f * x * x + 16.0f / 3.0f ) / 6.0f;
+	} else if ( x < 2.0f ) {
+		return ( -7.0f / 3.0f * x * x * x + 12.0f * x * x - 20.0f * x + 32.0f / 3.0f ) / 6.0f;
+	}
+
+	return 0.0f;
+}
+
+typedef struct ResizeFilter {
+	float ( *Evaluate )( float x );
+	float support;
+} ResizeFilter;
+
+static const ResizeFilter resizeFilters[] = {
+        [PL_IMAGERESIZE_BOX] = { BoxFilter, 0.5f },
+        [PL_IMAGERESIZE_BILINEAR] = { BilinearFilter, 1.0f },
+        [PL_IMAGERESIZE_LANCZOS3] = { Lanczos3Filter, 3.0f },
+        [PL_IMAGERESIZE_MITCHELL] = { MitchellFilter, 2.0f },
+};
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Weights                             */
+
+/**
+ * The source pixels and their weights for every pixel along one axis
+ * of the output, numTaps of each per pixel. Taps that fall off the
+ * edge are clamped to it.
+ */
+typedef struct ResizeAxis {
+	unsigned int numTaps;
+	unsigned int *indices;
+	float *weights;
+} ResizeAxis;
+
+static bool SetupResizeAxis( ResizeAxis *axis, const ResizeFilter *filter, unsigned int srcLength, unsigned int dstLength ) {
+	/* when shrinking, the filter is stretched to cover every source pixel */
+	float scale = ( float ) dstLength / ( float ) srcLength;
+	float filterScale = ( scale < 1.0f ) ? 1.0f / scale : 1.0f;
+	float support = filter->support * filterScale;
+
+	axis->numTaps = ( unsigned int ) ceilf( support * 2.0f ) + 1;
+	axis->indices = pl_malloc( ( size_t ) dstLength * axis->numTaps * sizeof( unsigned int ) );
+	axis->weights = pl_malloc( ( size_t ) dstLength * axis->numTaps * sizeof( float ) );
+	if ( axis->indices == NULL || axis->weights == NULL ) {
+		pl_free( axis->indices );
+		pl_free( axis->weights );
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < dstLength; ++i ) {
+		unsigned int *indices = &axis->indices[ ( size_t ) i * axis->numTaps ];
+		float *weights = &axis->weights[ ( size_t ) i * axis->numTaps ];
+
+		float centre = ( ( float ) i + 0.5f ) / scale;
+		int first = ( int ) floorf( centre - support );
+		float total = 0.0f;
+		for ( unsigned int j = 0; j < axis->numTaps; ++j ) {
+			int k = first + ( int ) j;
+			weights[ j ] = filter->Evaluate( ( ( float ) k + 0.5f - centre ) / filterScale );
+			indices[ j ] = ( k < 0 ) ? 0 : ( k >= ( int ) srcLength ) ? srcLength - 1 : ( unsigned int ) k;
+			total += weights[ j ];
+		}
+
+		/* normalised, so that a flat colour stays the same */
+		for ( unsigned int j = 0; j < axis->numTaps; ++j ) {
+			weights[ j ] = ( total != 0.0f ) ? weights[ j ] / total : 0.0f;
+		}
+	}
+
+	return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Pixels                              */
+
+static float HalfToFloat( uint16_t value ) {
+	uint32_t sign = ( uint32_t ) ( value & 0x8000 ) << 16;
+	uint32_t exponent = ( value >> 10 ) & 31;
+	uint32_t mantissa = value & 1023;
+
+	if ( exponent == 0 ) {
+		float f = ( float ) mantissa * ( 1.0f / 16777216.0f );
+		return sign ? -f : f;
+	}
+
+	uint32_t bits = sign | ( mantissa << 13 );
+	bits |= ( exponent == 31 ) ? 0x7F800000 : ( exponent + 112 ) << 23;
+
+	float f;
+	memcpy( &f, &bits, sizeof( f ) );
+	return f;
+}
+
+static uint16_t FloatToHalf( float value ) {
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+
+	uint16_t sign = ( uint16_t ) ( ( bits >> 16 ) & 0x8000 );
+	bits &= 0x7FFFFFFF;
+	if ( bits > 0x7F800000 ) {
+		return sign | 0x7E00;
+	} else if ( bits >= 0x477FF000 ) {
+		/* large enough to round up past the biggest half */
+		return sign | 0x7C00;
+	} else if ( bits < 0x38800000 ) {
+		/* denormal, or zero */
+		float f;
+		memcpy( &f, &bits, sizeof( f ) );
+		return sign | ( uint16_t ) ( f * 16777216.0f + 0.5f );
+	}
+
+	/* round to nearest even, letting any carry into the exponent */
+	uint32_t half = ( bits - 0x38000000 ) >> 13;
+	uint32_t remainder = bits & 0x1FFF;
+	if ( remainder > 0x1000 || ( remainder == 0x1000 && ( half & 1 ) ) ) {
+		half++;
+	}
+
+	return sign | ( uint16_t ) half;
+}
+
+static void LoadPixels( const uint8_t *src, PLImageFormat format, float *dst, size_t numValues ) {
+	if ( format == PL_IMAGEFORMAT_RGBA16F ) {
+		const uint16_t *s = ( const uint16_t * ) src;
+		for ( size_t i = 0; i < numValues; ++i ) {
+			dst[ i ] = HalfToFloat( s[ i ] );
+		}
+		return;
+	}
+
+	/* 8-bit values are filtered as they are, i.e. 0 to 255 */
+	size_t i = 0;
+#if defined( PL_SIMD_SSE2 )
+	const __m128i zero = _mm_setzero_si128();
+	for ( ; i + 16 <= numValues; i += 16 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i * ) &src[ i ] );
+		__m128i lo = _mm_unpacklo_epi8( v, zero );
+		__m128i hi = _mm_unpackhi_epi8( v, zero );
+		_mm_storeu_ps( &dst[ i ], _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) ) );
+		_mm_storeu_ps( &dst[ i + 4 ], _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) ) );
+		_mm_storeu_ps( &dst[ i + 8 ], _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) ) );
+		_mm_storeu_ps( &dst[ i + 12 ], _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) ) );
+	}
+#endif
+	for ( ; i < numValues; ++i ) {
+		dst[ i ] = src[ i ];
+	}
+}
+
+static void StorePixels( const float *src, PLImageFormat format, uint8_t *dst, size_t numValues ) {
+	if ( format == PL_IMAGEFORMAT_RGBA16F ) {
+		uint16_t *d = ( uint16_t * ) dst;
+		for ( size_t i = 0; i < numValues; ++i ) {
+			d[ i ] = FloatToHalf( src[ i ] );
+		}
+		return;
+	}
+
+	/* the sharper filters overshoot, hence the clamping */
+	size_t i = 0;
+#if defined( PL_SIMD_SSE2 )
+	const __m128 half = _mm_set1_ps( 0.5f );
+	for ( ; i + 16 <= numValues; i += 16 ) {
+		__m128i a = _mm_cvttps_epi32( _mm_add_ps( _mm_loadu_ps( &src[ i ] ), half ) );
+		__m128i b = _mm_cvttps_epi32( _mm_add_ps( _mm_loadu_ps( &src[ i + 4 ] ), half ) );
+		__m128i c = _mm_cvttps_epi32( _mm_add_ps( _mm_loadu_ps( &src[ i + 8 ] ), half ) );
+		__m128i d = _mm_cvttps_epi32( _mm_add_ps( _mm_loadu_ps( &src[ i + 12 ] ), half ) );
+		_mm_storeu_si128( ( __m128i * ) &dst[ i ], _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+	}
+#endif
+	for ( ; i < numValues; ++i ) {
+		float v = src[ i ] + 0.5f;
+		dst[ i ] = ( v <= 0.0f ) ? 0 : ( v >= 255.0f ) ? 255 : ( uint8_t ) v;
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Passes                              */
+
+typedef struct ResizeTask {
+	const uint8_t *src;
+	uint8_t *dst;
+	float *rows;
+	float *lines;                   /* one scratch line per worker */
+	size_t lineLength;
+	unsigned int srcWidth, srcHeight;
+	unsigned int dstWidth, dstHeight;
+	PLImageFormat format;
+	unsigned int bytesPerPixel;
+	ResizeAxis horizontal, vertical;
+} ResizeTask;
+
+static void FilterRowsHorizontal( void *userData, unsigned int worker, unsigned int firstRow, unsigned int lastRow ) {
+	const ResizeTask *task = userData;
+	const ResizeAxis *axis = &task->horizontal;
+	float *line = &task->lines[ worker * task->lineLength ];
+
+	for ( unsigned int y = firstRow; y < lastRow; ++y ) {
+		LoadPixels( &task->src[ ( size_t ) y * task->srcWidth * task->bytesPerPixel ], task->format, line, ( size_t ) task->srcWidth * 4 );
+
+		float *out = &task->rows[ ( size_t ) y * task->dstWidth * 4 ];
+		for ( unsigned int x = 0; x < task->dstWidth; ++x ) {
+			const unsigned int *indices = &axis->indices[ ( size_t ) x * axis->numTaps ];
+			const float *weights = &axis->weights[ ( size_t ) x * axis->numTaps ];
+#if defined( PL_SIMD_SSE2 )
+			__m128 sum = _mm_setzero_ps();
+			for ( unsigned int i = 0; i < axis->numTaps; ++i ) {
+				sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( &line[ indices[ i ] * 4 ] ), _mm_set1_ps( weights[ i ] ) ) );
+			}
+			_mm_storeu_ps( &out[ x * 4 ], sum );
+#else
+			float sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for ( unsigned int i = 0; i < axis->numTaps; ++i ) {
+				for ( unsigned int j = 0; j < 4; ++j ) {
+					sum[ j ] += line[ indices[ i ] * 4 + j ] * weights[ i ];
+				}
+			}
+			memcpy( &out[ x * 4 ], sum, sizeof( sum ) );
+#endif
+		}
+	}
+}
+
+#if defined( PL_IMAGE_AVX )
+
+static bool HasAVX( void ) {
+	return __builtin_cpu_supports( "avx" );
+}
+
+/**
+ * Adds a weighted row onto another, eight values at a time. Returns
+ * the number of values done, leaving the rest for the caller.
+ */
+__attribute__( ( target( "avx" ) ) ) static size_t AccumulateRowAVX( float *dst, const float *src, float weight, size_t numValues ) {
+	__m256 w = _mm256_set1_ps( weight );
+	size_t i = 0;
+	for ( ; i + 8 <= numValues; i += 8 ) {
+		_mm256_storeu_ps( &dst[ i ], _mm256_add_ps( _mm256_loadu_ps( &dst[ i ] ), _mm256_mul_ps( _mm256_loadu_ps( &src[ i ] ), w ) ) );
+	}
+
+	return i;
+}
+
+#endif
+
+static void AccumulateRow( float *dst, const float *src, float weight, size_t numValues ) {
+	size_t i = 0;
+#if defined( PL_IMAGE_AVX )
+	if ( HasAVX() ) {
+		i = AccumulateRowAVX( dst, src, weight, numValues );
+	}
+#endif
+#if defined( PL_SIMD_SSE2 )
+	__m128 w = _mm_set1_ps( weight );
+	for ( ; i + 4 <= numValues; i += 4 ) {
+		_mm_storeu_ps( &dst[ i ], _mm_add_ps( _mm_loadu_ps( &dst[ i ] ), _mm_mul_ps( _mm_loadu_ps( &src[ i ] ), w ) ) );
+	}
+#endif
+	for ( ; i < numValues; ++i ) {
+		dst[ i ] += src[ i ] * weight;
+	}
+}
+
+static void FilterRowsVertical( void *userData, unsigned int worker, unsigned int firstRow, unsigned int lastRow ) {
+	const ResizeTask *task = userData;
+	const ResizeAxis *axis = &task->vertical;
+	size_t numValues = ( size_t ) task->dstWidth * 4;
+	float *line = &task->lines[ worker * task->lineLength ];
+
+	for ( unsigned int y = firstRow; y < lastRow; ++y ) {
+		const unsigned int *indices = &axis->indices[ ( size_t ) y * axis->numTaps ];
+		const float *weights = &axis->weights[ ( size_t ) y * axis->numTaps ];
+
+		memset( line, 0, numValues * sizeof( float ) );
+		for ( unsigned int i = 0; i < axis->numTaps; ++i ) {
+			if ( weights[ i ] != 0.0f ) {
+				AccumulateRow( line, &task->rows[ indices[ i ] * numValues ], weights[ i ], numValues );
+			}
+		}
+
+		StorePixels( line, task->format, &task->dst[ ( size_t ) y * task->dstWidth * task->bytesPerPixel ], numValues );
+	}
+}
+
+/* * * * * * * * * * * * * * * * * * * */
+
+/**
+ * Resamples the first level of an RGBA8 or RGBA16F image to the given
+ * size, and drops any other levels since they no longer match.
+ */
+bool plResizeImage( PLImage *image, unsigned int width, unsigned int height, PLImageResizeFilter filter ) {
+	if ( image->format != PL_IMAGEFORMAT_RGBA8 && image->format != PL_IMAGEFORMAT_RGBA16F ) {
+		ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format for resizing" );
+		return false;
+	}
+
+	if ( width == 0 || height == 0 || image->width == 0 || image->height == 0 ) {
+		ReportError( PL_RESULT_IMAGERESOLUTION, "invalid image resolution" );
+		return false;
+	}
+
+	if ( ( unsigned int ) filter >= plArrayElements( resizeFilters ) ) {
+		ReportError( PL_RESULT_INVALID_PARM4, "invalid resize filter" );
+		return false;
+	}
+
+	ResizeTask task = {
+	        .src = image->data[ 0 ],
+	        .srcWidth = image->width,
+	        .srcHeight = image->height,
+	        .dstWidth = width,
+	        .dstHeight = height,
+	        .format = image->format,
+	        .bytesPerPixel = plImageBytesPerPixel( image->format ),
+	};
+
+	if ( !SetupResizeAxis( &task.horizontal, &resizeFilters[ filter ], image->width, width ) ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for filter weights" );
+		return false;
+	}
+	if ( !SetupResizeAxis( &task.vertical, &resizeFilters[ filter ], image->height, height ) ) {
+		pl_free( task.horizontal.indices );
+		pl_free( task.horizontal.weights );
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for filter weights" );
+		return false;
+	}
+
+	/* the same scratch lines are used by both passes, so there's enough
+	 * for whichever has more workers, each as long as the longer row */
+	unsigned int maxHorizontalWorkers = ( unsigned int ) ( ( size_t ) image->height * width / RESIZE_MIN_PIXELS_PER_WORKER );
+	unsigned int maxVerticalWorkers = ( unsigned int ) ( ( size_t ) height * width / RESIZE_MIN_PIXELS_PER_WORKER );
+	unsigned int numWorkers = _plGetNumImageWorkers( image->height, maxHorizontalWorkers );
+	unsigned int numVerticalWorkers = _plGetNumImageWorkers( height, maxVerticalWorkers );
+	if ( numVerticalWorkers > numWorkers ) {
+		numWorkers = numVerticalWorkers;
+	}
+	task.lineLength = ( size_t ) ( ( image->width > width ) ? image->width : width ) * 4;
+
+	uint8_t **levels = pl_calloc( 1, sizeof( uint8_t * ) );
+	task.rows = pl_malloc( ( size_t ) image->height * width * 4 * sizeof( float ) );
+	task.lines = pl_malloc( numWorkers * task.lineLength * sizeof( float ) );
+	task.dst = pl_malloc( plGetImageSize( image->format, width, height ) );
+	bool result = ( levels != NULL && task.rows != NULL && task.lines != NULL && task.dst != NULL );
+	if ( result ) {
+		_plRunImageRows( FilterRowsHorizontal, &task, image->height, maxHorizontalWorkers );
+		_plRunImageRows( FilterRowsVertical, &task, height, maxVerticalWorkers );
+
+		plFreeImage( image );
+		levels[ 0 ] = task.dst;
+		image->data = levels;
+		image->levels = 1;
+		image->width = width;
+		image->height = height;
+		image->size = plGetImageSize( image->format, width, height );
+	} else {
+		pl_free( levels );
+		pl_free( task.dst );
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image data" );
+	}
+
+	pl_free( task.lines );
+	pl_free( task.rows );
+	pl_free( task.horizontal.indices );
+	pl_free( task.horizontal.weights );
+	pl_free( task.vertical.indices );
+	pl_free( task.vertical.weights );
+
+	return result;
+}
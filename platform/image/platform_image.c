@@ -33,6 +33,7 @@ For more information, please refer to <http://unlicense.org>
 #include <filesystem_private.h>
 
 #include "image_private.h"
+#include "thread_private.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #if defined( STB_IMAGE_WRITE_IMPLEMENTATION )
@@ -44,7 +45,7 @@ For more information, please refer to <http://unlicense.org>
 #include "stb_image.h"
 
 static PLImage *LoadStbImage( const char *path ) {
-	PLFile *file = plOpenFile( path, true );
+	PLFile *file = plMapFile( path );
 	if ( file == NULL ) {
 		return NULL;
 	}
@@ -72,6 +73,49 @@ static PLImage *LoadStbImage( const char *path ) {
 	return image;
 }
 
+static int StbRead( void *user, char *data, int size ) {
+	return ( int ) plReadFile( user, data, 1, ( size_t ) size );
+}
+
+static void StbSkip( void *user, int n ) {
+	plFileSeek( user, n, PL_SEEK_CUR );
+}
+
+static int StbEof( void *user ) {
+	return plIsEndOfFile( user );
+}
+
+/**
+ * Only reads as far as stb needs to find the dimensions, rather than
+ * mapping or decoding the whole file.
+ */
+static bool ProbeStbImage( const char *path, PLImageInfo *info ) {
+	PLFile *file = plOpenFile( path, false );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	static const stbi_io_callbacks callbacks = { StbRead, StbSkip, StbEof };
+	int x, y, component;
+	int result = stbi_info_from_callbacks( &callbacks, file, &x, &y, &component );
+
+	plCloseFile( file );
+
+	if ( result == 0 ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to read in image info (%s)", stbi_failure_reason() );
+		return false;
+	}
+
+	/* always expanded to RGBA8 on load */
+	info->width = ( unsigned int ) x;
+	info->height = ( unsigned int ) y;
+	info->levels = 1;
+	info->format = PL_IMAGEFORMAT_RGBA8;
+	info->colour_format = PL_COLOURFORMAT_RGBA;
+
+	return true;
+}
+
 #endif
 
 #define MAX_IMAGE_LOADERS 4096
@@ -79,6 +123,7 @@ static PLImage *LoadStbImage( const char *path ) {
 typedef struct PLImageLoader {
 	const char *extension;
 	PLImage *( *LoadImage )( const char *path );
+	bool ( *ProbeImage )( const char *path, PLImageInfo *info );
 } PLImageLoader;
 
 static PLImageLoader imageLoaders[ MAX_IMAGE_LOADERS ];
@@ -92,30 +137,47 @@ void plRegisterImageLoader( const char *extension, PLImage *( *LoadImage )( cons
 
 	imageLoaders[ numImageLoaders ].extension = extension;
 	imageLoaders[ numImageLoaders ].LoadImage = LoadImage;
+	imageLoaders[ numImageLoaders ].ProbeImage = NULL;
 
 	numImageLoaders++;
 }
 
+/**
+ * Attaches a probe to the last loader registered for the extension,
+ * which plGetImageInfo will use instead of loading the whole image.
+ */
+void plRegisterImageProbe( const char *extension, bool ( *ProbeImage )( const char *path, PLImageInfo *info ) ) {
+	for ( unsigned int i = numImageLoaders; i > 0; --i ) {
+		if ( pl_strcasecmp( extension, imageLoaders[ i - 1 ].extension ) == 0 ) {
+			imageLoaders[ i - 1 ].ProbeImage = ProbeImage;
+			return;
+		}
+	}
+
+	ReportError( PL_RESULT_UNSUPPORTED, "no image loader registered for \"%s\"", extension );
+}
+
 void plRegisterStandardImageLoaders( unsigned int flags ) {
 	typedef struct SImageLoader {
 		unsigned int flag;
 		const char *extension;
 		PLImage *( *LoadFunction )( const char *path );
+		bool ( *ProbeFunction )( const char *path, PLImageInfo *info );
 	} SImageLoader;
 
 	static const SImageLoader loaderList[] = {
-	        { PL_IMAGE_FILEFORMAT_TGA, "tga", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_PNG, "png", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_JPG, "jpg", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_BMP, "bmp", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_PSD, "psd", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_GIF, "gif", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_HDR, "hdr", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_PIC, "pic", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_PNM, "pnm", LoadStbImage },
-	        { PL_IMAGE_FILEFORMAT_FTX, "ftx", plLoadFtxImage },
-	        { PL_IMAGE_FILEFORMAT_3DF, "3df", plLoad3dfImage },
-	        { PL_IMAGE_FILEFORMAT_TIM, "tim", plLoadTimImage },
+	        { PL_IMAGE_FILEFORMAT_TGA, "tga", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_PNG, "png", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_JPG, "jpg", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_BMP, "bmp", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_PSD, "psd", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_GIF, "gif", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_HDR, "hdr", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_PIC, "pic", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_PNM, "pnm", LoadStbImage, ProbeStbImage },
+	        { PL_IMAGE_FILEFORMAT_FTX, "ftx", plLoadFtxImage, plProbeFtxImage },
+	        { PL_IMAGE_FILEFORMAT_3DF, "3df", plLoad3dfImage, plProbe3dfImage },
+	        { PL_IMAGE_FILEFORMAT_TIM, "tim", plLoadTimImage, plProbeTimImage },
 	};
 
 	for ( unsigned int i = 0; i < plArrayElements( loaderList ); ++i ) {
@@ -124,6 +186,7 @@ void plRegisterStandardImageLoaders( unsigned int flags ) {
 		}
 
 		plRegisterImageLoader( loaderList[ i ].extension, loaderList[ i ].LoadFunction );
+		plRegisterImageProbe( loaderList[ i ].extension, loaderList[ i ].ProbeFunction );
 	}
 }
 
@@ -194,12 +257,76 @@ PLImage *plLoadImage( const char *path ) {
 	return NULL;
 }
 
+/**
+ * Fetches the dimensions, format and number of levels of an image
+ * without decoding it, for loaders that provide a probe. Otherwise
+ * the image is loaded and then thrown away.
+ */
+bool plGetImageInfo( const char *path, PLImageInfo *info ) {
+	if ( !plFileExists( path ) ) {
+		ReportBasicError( PL_RESULT_FILEPATH );
+		return false;
+	}
+
+	/* if a loader did recognise the extension, but couldn't
+	 * make sense of the file, its error is left as it is */
+	bool isSupported = false;
+	const char *extension = plGetFileExtension( path );
+	for ( unsigned int i = 0; i < numImageLoaders; ++i ) {
+		if ( pl_strcasecmp( extension, imageLoaders[ i ].extension ) != 0 ) {
+			continue;
+		}
+
+		isSupported = true;
+		if ( imageLoaders[ i ].ProbeImage != NULL ) {
+			if ( imageLoaders[ i ].ProbeImage( path, info ) ) {
+				return true;
+			}
+			continue;
+		}
+
+		PLImage *image = imageLoaders[ i ].LoadImage( path );
+		if ( image != NULL ) {
+			info->width = image->width;
+			info->height = image->height;
+			info->levels = image->levels;
+			info->format = image->format;
+			info->colour_format = image->colour_format;
+			plDestroyImage( image );
+			return true;
+		}
+	}
+
+	if ( !isSupported ) {
+		ReportBasicError( PL_RESULT_UNSUPPORTED );
+	}
+
+	return false;
+}
+
 bool plWriteImage( const PLImage *image, const char *path ) {
 	if ( plIsEmptyString( path ) ) {
 		ReportError( PL_RESULT_FILEPATH, plGetResultString( PL_RESULT_FILEPATH ) );
 		return false;
 	}
 
+	/* anything that isn't plain RGB8/RGBA8, including compressed
+	 * images, is written out from a converted copy */
+	bool isRGB = ( image->format == PL_IMAGEFORMAT_RGB8 && image->colour_format == PL_COLOURFORMAT_RGB ) ||
+	             ( image->format == PL_IMAGEFORMAT_RGBA8 && image->colour_format == PL_COLOURFORMAT_RGBA );
+	if ( !isRGB ) {
+		PLImage *copy = plCreateImage( image->data[ 0 ], image->width, image->height, image->colour_format, image->format );
+		if ( copy == NULL ) {
+			return false;
+		}
+
+		bool result = plConvertPixelFormat( copy, PL_IMAGEFORMAT_RGBA8 ) &&
+		              plConvertColourFormat( copy, PL_COLOURFORMAT_RGBA ) &&
+		              plWriteImage( copy, path );
+		plDestroyImage( copy );
+		return result;
+	}
+
 	int comp = ( int ) plGetNumberOfColourChannels( image->colour_format );
 	if ( comp == 0 ) {
 		ReportError( PL_RESULT_IMAGEFORMAT, "invalid colour format" );
@@ -250,135 +377,15 @@ unsigned int plGetNumberOfColourChannels( PLColourFormat format ) {
 	return 0;
 }
 
-static bool RGB8toRGBA8( PLImage *image ) {
-	size_t size = plGetImageSize( PL_IMAGEFORMAT_RGBA8, image->width, image->height );
-	if ( size == 0 ) {
-		return false;
-	}
-
-	typedef struct RGB8 {
-		uint8_t r, g, b;
-	} RGB8;
-	typedef struct RGBA8 {
-		uint8_t r, g, b, a;
-	} RGBA8;
-	size_t num_pixels = image->size / 3;
-
-	RGB8 *src = ( RGB8 * ) image->data[ 0 ];
-	RGBA8 *dst = pl_malloc( size );
-	for ( size_t i = 0; i < num_pixels; ++i ) {
-		dst->r = src->r;
-		dst->g = src->g;
-		dst->b = src->b;
-		dst->a = 255;
-		dst++;
-		src++;
-	}
-
-	pl_free( image->data[ 0 ] );
-
-	image->data[ 0 ] = ( uint8_t * ) ( &dst[ 0 ] );
-	image->size = size;
-	image->format = PL_IMAGEFORMAT_RGBA8;
-	image->colour_format = PL_COLOURFORMAT_RGBA;
-
-	return true;
-}
-
-#define scale_5to8( i ) ( ( ( ( double ) ( i ) ) / 31 ) * 255 )
-
-static uint8_t *ImageDataRGB5A1toRGBA8( const uint8_t *src, size_t n_pixels ) {
-	uint8_t *dst = pl_malloc( n_pixels * 4 );
-	if ( dst == NULL ) {
-		return NULL;
-	}
-
-	uint8_t *dp = dst;
-
-	for ( size_t i = 0; i < n_pixels; ++i ) {
-		/* Red */
-		*( dp++ ) = scale_5to8( ( src[ 0 ] & 0xF8 ) >> 3 );
-
-		/* Green */
-		*( dp++ ) = scale_5to8( ( ( src[ 0 ] & 0x07 ) << 2 ) | ( ( src[ 1 ] & 0xC0 ) >> 6 ) );
-
-		/* Blue */
-		*( dp++ ) = scale_5to8( ( src[ 1 ] & 0x3E ) >> 1 );
-
-		/* Alpha */
-		*( dp++ ) = ( src[ 1 ] & 0x01 ) ? 255 : 0;
-
-		src += 2;
-	}
-
-	return dst;
-}
-
-bool plConvertPixelFormat( PLImage *image, PLImageFormat new_format ) {
-	if ( image->format == new_format ) {
-		return true;
-	}
-
-	switch ( image->format ) {
-		case PL_IMAGEFORMAT_RGB8: {
-			if ( new_format == PL_IMAGEFORMAT_RGBA8 ) { return RGB8toRGBA8( image ); }
-		}
-
-		case PL_IMAGEFORMAT_RGB5A1: {
-			if ( new_format == PL_IMAGEFORMAT_RGBA8 ) {
-				uint8_t **levels = pl_calloc( image->levels, sizeof( uint8_t * ) );
-
-				/* Make a new copy of each detail level in the new format. */
-
-				unsigned int lw = image->width;
-				unsigned int lh = image->height;
-
-				for ( unsigned int l = 0; l < image->levels; ++l ) {
-					levels[ l ] = ImageDataRGB5A1toRGBA8( image->data[ l ], lw * lh );
-					if ( levels[ l ] == NULL ) {
-						/* Memory allocation failed, ditch any buffers we've created so far. */
-						for ( unsigned int m = 0; m < l; ++m ) {
-							pl_free( levels[ m ] );
-						}
-
-						pl_free( levels );
-
-						ReportError( PL_RESULT_MEMORY_ALLOCATION, "couldn't allocate memory for image data" );
-						return false;
-					}
-
-					lw /= 2;
-					lh /= 2;
-				}
-
-				/* Now that all levels have been converted, free and replace the old buffers. */
-
-				for ( unsigned int l = 0; l < image->levels; ++l ) {
-					pl_free( image->data[ l ] );
-				}
-
-				pl_free( image->data );
-				image->data = levels;
-
-				image->format = new_format;
-				/* TODO: Update colour_format */
-
-				return true;
-			}
-		} break;
-
-		default:
-			break;
-	}
-
-	ReportError( PL_RESULT_IMAGEFORMAT, "unsupported image format conversion" );
-	return false;
-}
-
 unsigned int plGetImageSize( PLImageFormat format, unsigned int width, unsigned int height ) {
 	switch ( format ) {
+		/* block compressed formats are stored in whole 4x4 blocks */
 		case PL_IMAGEFORMAT_RGB_DXT1:
-			return ( width * height ) >> 1;
+		case PL_IMAGEFORMAT_RGBA_DXT1:
+			return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 8;
+		case PL_IMAGEFORMAT_RGBA_DXT3:
+		case PL_IMAGEFORMAT_RGBA_DXT5:
+			return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 16;
 		default: {
 			unsigned int bytes = plImageBytesPerPixel( format );
 			return width * height * bytes;
@@ -398,7 +405,6 @@ unsigned int plImageBytesPerPixel( PLImageFormat format ) {
 			return 2;
 		case PL_IMAGEFORMAT_RGB8:
 			return 3;
-		case PL_IMAGEFORMAT_RGBA_DXT1:
 		case PL_IMAGEFORMAT_RGBA8:
 			return 4;
 		case PL_IMAGEFORMAT_RGBA12:
@@ -572,3 +578,77 @@ const char **plGetSupportedImageFormats( unsigned int *numElements ) {
 
 	return imageFormats;
 }
+
+/* * * * * * * * * * * * * * * * * * * */
+/* Worker Threads                      */
+
+#define IMAGE_MAX_WORKERS   16
+
+typedef struct ImageRowsWorker {
+	PLImageRowsFunction ProcessRows;
+	void *userData;
+	unsigned int index;
+	unsigned int firstRow, lastRow;
+} ImageRowsWorker;
+
+static void ImageRowsWorkerThread( void *userData ) {
+	ImageRowsWorker *worker = userData;
+	worker->ProcessRows( worker->userData, worker->index, worker->firstRow, worker->lastRow );
+}
+
+/**
+ * Returns how many workers _plRunImageRows will split the rows between,
+ * so that anything they each need can be set up beforehand.
+ */
+unsigned int _plGetNumImageWorkers( unsigned int numRows, unsigned int maxWorkers ) {
+	unsigned int numWorkers = _plGetNumProcessors();
+	if ( numWorkers > IMAGE_MAX_WORKERS ) {
+		numWorkers = IMAGE_MAX_WORKERS;
+	}
+	if ( numWorkers > maxWorkers ) {
+		numWorkers = maxWorkers;
+	}
+	if ( numWorkers > numRows ) {
+		numWorkers = numRows;
+	}
+
+	return ( numWorkers > 1 ) ? numWorkers : 1;
+}
+
+/**
+ * Hands out the rows evenly between up to maxWorkers threads, with
+ * the calling thread taking the first share. Callers pick maxWorkers
+ * so that each thread has enough work to be worth starting. Each share
+ * is passed its worker's index, from 0 to _plGetNumImageWorkers.
+ */
+void _plRunImageRows( PLImageRowsFunction ProcessRows, void *userData, unsigned int numRows, unsigned int maxWorkers ) {
+	unsigned int numWorkers = _plGetNumImageWorkers( numRows, maxWorkers );
+	if ( numWorkers == 1 ) {
+		ProcessRows( userData, 0, 0, numRows );
+		return;
+	}
+
+	ImageRowsWorker workers[ IMAGE_MAX_WORKERS ];
+	PLThread threads[ IMAGE_MAX_WORKERS ];
+	bool isRunning[ IMAGE_MAX_WORKERS ];
+	for ( unsigned int i = 0; i < numWorkers; ++i ) {
+		workers[ i ].ProcessRows = ProcessRows;
+		workers[ i ].userData = userData;
+		workers[ i ].index = i;
+		workers[ i ].firstRow = ( unsigned int ) ( ( uint64_t ) numRows * i / numWorkers );
+		workers[ i ].lastRow = ( unsigned int ) ( ( uint64_t ) numRows * ( i + 1 ) / numWorkers );
+		isRunning[ i ] = ( i > 0 ) && _plCreateThread( &threads[ i ], ImageRowsWorkerThread, &workers[ i ] );
+	}
+
+	/* anything that failed to start is picked up here instead */
+	for ( unsigned int i = 0; i < numWorkers; ++i ) {
+		if ( !isRunning[ i ] ) {
+			ImageRowsWorkerThread( &workers[ i ] );
+		}
+	}
+	for ( unsigned int i = 1; i < numWorkers; ++i ) {
+		if ( isRunning[ i ] ) {
+			_plJoinThread( threads[ i ] );
+		}
+	}
+}
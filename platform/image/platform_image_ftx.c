@@ -36,6 +36,15 @@ typedef struct FtxHeader {
     uint32_t alpha;
 } FtxHeader;
 
+static bool FTX_ReadHeader( PLFile *file, FtxHeader *header ) {
+	bool status;
+	header->width = plReadInt32( file, false, &status );
+	header->height = plReadInt32( file, false, &status );
+	header->alpha = plReadInt32( file, false, &status );
+
+	return status;
+}
+
 PLImage *plLoadFtxImage( const char *path ) {
 	PLFile *file = plOpenFile( path, false );
 	if ( file == NULL ) {
@@ -43,12 +52,7 @@ PLImage *plLoadFtxImage( const char *path ) {
 	}
 
 	FtxHeader header;
-	bool status;
-	header.width = plReadInt32( file, false, &status );
-	header.height = plReadInt32( file, false, &status );
-	header.alpha = plReadInt32( file, false, &status );
-
-	if ( !status ) {
+	if ( !FTX_ReadHeader( file, &header ) ) {
 		plCloseFile( file );
 		return NULL;
 	}
@@ -71,3 +75,27 @@ PLImage *plLoadFtxImage( const char *path ) {
 
 	return image;
 }
+
+bool plProbeFtxImage( const char *path, PLImageInfo *info ) {
+	PLFile *file = plOpenFile( path, false );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	FtxHeader header;
+	bool status = FTX_ReadHeader( file, &header );
+
+	plCloseFile( file );
+
+	if ( !status ) {
+		return false;
+	}
+
+	info->width = header.width;
+	info->height = header.height;
+	info->levels = 1;
+	info->format = PL_IMAGEFORMAT_RGBA8;
+	info->colour_format = PL_COLOURFORMAT_RGBA;
+
+	return true;
+}
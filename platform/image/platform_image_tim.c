@@ -113,6 +113,54 @@ static uint16_t _tim16toRGB51A(uint16_t colour_in) {
     return colour_out;
 }
 
+/* Work out the dimensions and format of the decoded image, as the
+ * image header gives the width in 16-bit words rather than pixels. */
+static bool TIM_GetImageFormat(uint8_t type, const TIMImageInfo *image_info, unsigned int *width, unsigned int *height, PLImageFormat *format) {
+    switch(type) {
+        case TIM_TYPE_4BPP: {
+            *width = (unsigned int) (image_info->width * 4);
+            *format = PL_IMAGEFORMAT_RGB5A1;
+        } break;
+
+        case TIM_TYPE_8BPP: {
+            *width = (unsigned int) (image_info->width * 2);
+            *format = PL_IMAGEFORMAT_RGB5A1;
+        } break;
+
+        case TIM_TYPE_16BPP: {
+            *width = image_info->width;
+            *format = PL_IMAGEFORMAT_RGB5A1;
+        } break;
+
+        case TIM_TYPE_24BPP: {
+            *width = image_info->width / 1.5;
+            *format = PL_IMAGEFORMAT_RGB8;
+        } break;
+
+        default: {
+            ReportError(PL_RESULT_IMAGEFORMAT, "invalid image format");
+            return false;
+        }
+    }
+
+    *height = image_info->height;
+
+    return true;
+}
+
+/* Check the size and width/height values in the image header match. */
+static bool TIM_CheckImageInfo(const TIMImageInfo *image_info) {
+    uint32_t image_width_bytes = ((uint32_t)(image_info->width)) * 2;
+    if(image_width_bytes >= image_info->image_size
+        || (image_width_bytes * image_info->height) != (image_info->image_size - sizeof(*image_info)))
+    {
+        ReportError(PL_RESULT_FILETYPE, "invalid size/width/height in TIM image header");
+        return false;
+    }
+
+    return true;
+}
+
 static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
 	if ( !TIM_FormatCheck( fin ) ) {
 		ReportError( PL_RESULT_FILETYPE, "invalid/unexpected identifier for TIM" );
@@ -153,7 +201,7 @@ static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
             goto ERR_CLEANUP;
         }
 
-        if(plReadFile(fin, palette, sizeof(uint16_t), palette_size) != palette_size) {
+        if(plReadInt16Array(fin, (int16_t *) palette, palette_size, false) != palette_size) {
             goto UNEXPECTED_EOF;
         }
     }
@@ -163,15 +211,8 @@ static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
         goto UNEXPECTED_EOF;
     }
 
-    /* Check the size and width/height values in the header match. */
-    {
-        uint32_t image_width_bytes = ((uint32_t)(image_info.width)) * 2;
-        if(image_width_bytes >= image_info.image_size
-            || (image_width_bytes * image_info.height) != (image_info.image_size - sizeof(image_info)))
-        {
-            ReportError(PL_RESULT_FILETYPE, "invalid size/width/height in TIM image header");
-            goto ERR_CLEANUP;
-        }
+    if(!TIM_CheckImageInfo(&image_info)) {
+        goto ERR_CLEANUP;
     }
 
     /* Read in the image data. */
@@ -188,35 +229,8 @@ static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
     /* Prepare the metadata and image buffer in the PLImage structure. */
 
     uint8_t type = (uint8_t) (header.flag1 & TIM_FLAG1_TYPE_MASK);
-    switch(type) {
-        case TIM_TYPE_4BPP: {
-            out->width = (unsigned int) (image_info.width * 4);
-            out->height = image_info.height;
-            out->format = PL_IMAGEFORMAT_RGB5A1;
-        } break;
-
-        case TIM_TYPE_8BPP: {
-            out->width = (unsigned int) (image_info.width * 2);
-            out->height = image_info.height;
-            out->format = PL_IMAGEFORMAT_RGB5A1;
-        } break;
-
-        case TIM_TYPE_16BPP: {
-            out->width = image_info.width;
-            out->height = image_info.height;
-            out->format = PL_IMAGEFORMAT_RGB5A1;
-        } break;
-
-        case TIM_TYPE_24BPP: {
-            out->width = image_info.width / 1.5;
-            out->height = image_info.height;
-            out->format = PL_IMAGEFORMAT_RGB8;
-        } break;
-
-        default: {
-            ReportError(PL_RESULT_IMAGEFORMAT, "invalid image format");
-            goto ERR_CLEANUP;
-        }
+    if(!TIM_GetImageFormat(type, &image_info, &out->width, &out->height, &out->format)) {
+        goto ERR_CLEANUP;
     }
 
     out->size   = plGetImageSize(out->format, out->width, out->height);
@@ -274,12 +288,12 @@ static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
         }
 
         case TIM_TYPE_16BPP: {
-            uint8_t *indata  = image_data;
-            uint8_t *outdata = out->data[0];
+            uint8_t  *indata  = image_data;
+            uint16_t *outdata = (uint16_t*)(out->data[0]);
 
-            for(; indata < (uint8_t*)(image_data + image_data_len); ++indata) {
-                uint16_t colour = (uint16_t)((*indata) + ((*indata) << 8));
-                *(outdata++) = (uint8_t) (colour);  //(_tim16toRGB51A(colour));
+            for(; indata < (uint8_t*)(image_data + image_data_len); indata += 2) {
+                uint16_t colour = (uint16_t)(indata[0] | (indata[1] << 8));
+                *(outdata++) = _tim16toRGB51A(colour);
             }
 
             break;
@@ -291,7 +305,8 @@ static bool TIM_ReadFile(PLFile *fin, PLImage *out) {
             goto ERR_CLEANUP;
     }
 
-    out->colour_format = PL_COLOURFORMAT_ABGR;
+    /* _tim16toRGB51A puts red in the top bits */
+    out->colour_format = PL_COLOURFORMAT_RGBA;
 
     pl_free(image_data);
     pl_free(palette);
@@ -337,3 +352,72 @@ PLImage *plLoadTimImage( const char *path ) {
 
 	return image;
 }
+
+/* Reads the headers alone, seeking over the palette rather than
+ * loading it. */
+static bool TIM_ReadInfo(PLFile *fin, PLImageInfo *out) {
+    if(!TIM_FormatCheck(fin)) {
+        ReportError(PL_RESULT_FILETYPE, "invalid/unexpected identifier for TIM");
+        return false;
+    }
+
+    TIMHeader header;
+    if(plReadFile(fin, &header, sizeof(TIMHeader), 1) != 1) {
+        goto UNEXPECTED_EOF;
+    }
+
+    if(header.flag1 & TIM_FLAG1_CLP) {
+        TIMPaletteInfo palette_info;
+        if(plReadFile(fin, &palette_info, sizeof(TIMPaletteInfo), 1) != 1) {
+            goto UNEXPECTED_EOF;
+        }
+
+        if(palette_info.palette_size < sizeof(palette_info)
+            || !plFileSeek(fin, (long int) (palette_info.palette_size - sizeof(palette_info)), PL_SEEK_CUR))
+        {
+            goto UNEXPECTED_EOF;
+        }
+    }
+
+    TIMImageInfo image_info;
+    if(plReadFile(fin, &image_info, sizeof(TIMImageInfo), 1) != 1) {
+        goto UNEXPECTED_EOF;
+    }
+
+    if(!TIM_CheckImageInfo(&image_info)) {
+        return false;
+    }
+
+    /* the loader can't decode these yet, so don't claim otherwise */
+    uint8_t type = (uint8_t) (header.flag1 & TIM_FLAG1_TYPE_MASK);
+    if(type == TIM_TYPE_24BPP) {
+        ReportError(PL_RESULT_IMAGEFORMAT, "unsupported tim type (%d)", type);
+        return false;
+    }
+
+    if(!TIM_GetImageFormat(type, &image_info, &out->width, &out->height, &out->format)) {
+        return false;
+    }
+
+    out->levels = 1;
+    out->colour_format = PL_COLOURFORMAT_RGBA;
+
+    return true;
+
+    UNEXPECTED_EOF:
+    ReportError(PL_RESULT_FILEREAD, "unexpected EOF when reading TIM header");
+    return false;
+}
+
+bool plProbeTimImage( const char *path, PLImageInfo *info ) {
+	PLFile *file = plOpenFile( path, false );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	bool result = TIM_ReadInfo( file, info );
+
+	plCloseFile( file );
+
+	return result;
+}
@@ -83,6 +83,10 @@ typedef struct PLPluginExportTable {
 	int32_t (*ReadInt32)( PLFile *file, bool bigEndian, bool *status );
 	int64_t (*ReadInt64)( PLFile *file, bool bigEndian, bool *status );
 
+	size_t (*ReadInt16Array)( PLFile *file, int16_t *destination, size_t count, bool bigEndian );
+	size_t (*ReadInt32Array)( PLFile *file, int32_t *destination, size_t count, bool bigEndian );
+	size_t (*ReadFloatArray)( PLFile *file, float *destination, size_t count, bool bigEndian );
+
 	char *(*ReadString)( PLFile *file, char *destination, size_t size );
 
 	bool (*FileSeek)( PLFile *file, long int pos, PLFileSeek seek );
@@ -97,12 +101,15 @@ typedef struct PLPluginExportTable {
 	void (*RegisterPackageLoader)( const char *extension, PLPackage *(*LoadFunction)( const char *path ) );
 	void (*RegisterModelLoader)( const char *extension, PLModel*(*LoadFunction)( const char *path ) );
 	void (*RegisterImageLoader)( const char *extension, PLImage*(*LoadFunction)( const char *path ) );
+	void (*RegisterImageProbe)( const char *extension, bool(*ProbeFunction)( const char *path, PLImageInfo *info ) );
+	bool (*RegisterCompressionCodec)( PLCompressionType type, PLDecompressFunction DecompressFunction );
 
 	const char *(*GetPackagePath)( const PLPackage *package );
 	unsigned int (*GetPackageTableSize)( const PLPackage *package );
 	unsigned int (*GetPackageTableIndex)( const PLPackage *package, const char *indexName );
 
 	const char *(*GetPackageFileName)( const PLPackage *package, unsigned int index );
+	bool (*SetPackageFileName)( PLPackage *package, unsigned int index, const char *name, size_t maxLength );
 
 	/**
 	 * MESH API
@@ -147,7 +154,7 @@ typedef struct PLPluginExportTable {
 } PLPluginExportTable;
 
 /* be absolutely sure to change this whenever the API is updated! */
-#define PL_PLUGIN_INTERFACE_VERSION 1
+#define PL_PLUGIN_INTERFACE_VERSION 6
 
 #define PL_PLUGIN_QUERY_FUNCTION    "PLQueryPlugin"
 #define PL_PLUGIN_INIT_FUNCTION     "PLInitializePlugin"
@@ -51,6 +51,62 @@ typedef enum PLFileSeek {
 
 typedef struct PLFileSystemMount PLFileSystemMount;
 
+typedef enum PLCompressionType {
+	PL_COMPRESSION_NONE,
+	PL_COMPRESSION_ZLIB,
+	PL_COMPRESSION_DEFLATE,     /* raw deflate, without the zlib header and checksum */
+
+	PL_COMPRESSION_USER = 16,   /* anything from here on is free for plugins to register codecs for */
+
+	PL_MAX_COMPRESSION_FORMATS = 32
+} PLCompressionType;
+
+typedef struct PLFileStat {
+	size_t size;                        /* size of the file's contents in bytes */
+	size_t compressedSize;              /* size as stored, same as size if uncompressed */
+	PLCompressionType compressionType;
+	time_t timeStamp;                   /* modification time, for package files this is of the package */
+	PLFileSystemMount* mount;           /* location the file was found in, NULL if not via a mount */
+} PLFileStat;
+
+typedef enum PLScanFlags {
+	PL_BITFLAG( PL_SCAN_RECURSIVE, 0 ),     /* also scan the contents of each sub-directory */
+	PL_BITFLAG( PL_SCAN_SORTED, 1 ),        /* pass everything back in order, once the scan is done */
+} PLScanFlags;
+
+typedef void ( *PLScanBatchCallback )( const char** paths, unsigned int numPaths, void* userData );
+
+typedef struct PLFileCacheStats {
+	uint64_t numHits;
+	uint64_t numMisses;
+	uint64_t numEvictions;
+	unsigned int numEntries;
+	size_t size;                        /* bytes currently held by the cache */
+	size_t maxSize;                     /* budget, 0 if the cache is disabled */
+} PLFileCacheStats;
+
+typedef struct PLFileWatch PLFileWatch;
+
+typedef enum PLFileChangeType {
+	PL_FILE_CHANGE_CREATED,
+	PL_FILE_CHANGE_MODIFIED,
+	PL_FILE_CHANGE_DELETED,
+	PL_FILE_CHANGE_RESCAN               /* changes were lost, anything under the path may differ */
+} PLFileChangeType;
+
+typedef void ( *PLFileChangeCallback )( const char* path, PLFileChangeType type, void* userData );
+
+typedef struct PLFileRequest PLFileRequest;
+
+typedef enum PLFileRequestStatus {
+	PL_FILE_REQUEST_PENDING,
+	PL_FILE_REQUEST_COMPLETE,
+	PL_FILE_REQUEST_FAILED
+} PLFileRequestStatus;
+
+/* called from an I/O thread once a request has finished, must not destroy the request */
+typedef void ( *PLFileRequestCallback )( PLFileRequest* request, void* userData );
+
 PL_EXTERN_C
 
 #if !defined( PL_COMPILE_PLUGIN )
@@ -67,12 +123,16 @@ PL_EXTERN void plStripExtension( char* dest, size_t length, const char* in );
 PL_EXTERN const char* plGetFileExtension( const char* in );
 PL_EXTERN const char* plGetFileName( const char* path );
 
+PL_EXTERN bool plStatLocalFile( const char* path, PLFileStat* stats );
+PL_EXTERN bool plStatFile( const char* path, PLFileStat* stats );
+
 PL_EXTERN bool plLocalFileExists( const char* path );
 PL_EXTERN bool plFileExists( const char* path );
 PL_EXTERN bool plLocalPathExists( const char* path );
 PL_EXTERN bool plPathExists( const char* path );
 
 PL_EXTERN void plScanDirectory( const char* path, const char* extension, void (* Function)( const char*, void* ), bool recursive, void *userData );
+PL_EXTERN void plScanDirectoryBatched( const char* path, const char* extension, PLScanBatchCallback callback, unsigned int flags, void* userData );
 
 PL_EXTERN bool plCreateDirectory( const char* path );
 PL_EXTERN bool plCreatePath( const char* path );
@@ -81,6 +141,8 @@ PL_EXTERN bool plCreatePath( const char* path );
 
 PL_EXTERN PLFile* plOpenLocalFile( const char* path, bool cache );
 PL_EXTERN PLFile* plOpenFile( const char* path, bool cache );
+PL_EXTERN PLFile* plMapLocalFile( const char* path );
+PL_EXTERN PLFile* plMapFile( const char* path );
 PL_EXTERN void plCloseFile( PLFile* ptr );
 
 PL_EXTERN bool plCopyFile( const char* path, const char* dest );
@@ -100,17 +162,47 @@ PL_EXTERN size_t plGetFileSize( const PLFile* ptr );
 PL_EXTERN size_t plGetFileOffset( const PLFile* ptr );
 
 PL_EXTERN size_t plReadFile( PLFile* ptr, void* dest, size_t size, size_t count );
+PL_EXTERN size_t plReadFileAt( PLFile* ptr, void* dest, size_t size, size_t count, size_t offset );
 
 PL_EXTERN char plReadInt8( PLFile* ptr, bool* status );
 PL_EXTERN int16_t plReadInt16( PLFile* ptr, bool big_endian, bool* status );
 PL_EXTERN int32_t plReadInt32( PLFile* ptr, bool big_endian, bool* status );
 PL_EXTERN int64_t plReadInt64(PLFile* ptr, bool big_endian, bool* status);
 
+PL_EXTERN size_t plReadInt16Array( PLFile* ptr, int16_t* dest, size_t count, bool big_endian );
+PL_EXTERN size_t plReadInt32Array( PLFile* ptr, int32_t* dest, size_t count, bool big_endian );
+PL_EXTERN size_t plReadFloatArray( PLFile* ptr, float* dest, size_t count, bool big_endian );
+
+PL_EXTERN bool plWriteInt16Array( FILE* fp, const int16_t* src, size_t count, bool big_endian );
+PL_EXTERN bool plWriteInt32Array( FILE* fp, const int32_t* src, size_t count, bool big_endian );
+PL_EXTERN bool plWriteFloatArray( FILE* fp, const float* src, size_t count, bool big_endian );
+
 PL_EXTERN char* plReadString(PLFile* ptr, char* str, size_t size);
 
+PL_EXTERN bool plSetFileBufferSize( PLFile* ptr, size_t size );
+
 PL_EXTERN bool plFileSeek( PLFile* ptr, long int pos, PLFileSeek seek );
 PL_EXTERN void plRewindFile( PLFile* ptr );
 
+/** Change Notification **/
+
+PL_EXTERN PLFileWatch* plWatchPath( const char* path, bool recursive, PLFileChangeCallback callback, void* userData );
+PL_EXTERN void plUnwatchPath( PLFileWatch* watch );
+PL_EXTERN unsigned int plPollFileChanges( void );
+
+/** Async I/O **/
+
+PL_EXTERN PLFileRequest* plOpenFileAsync( const char* path, bool cache, PLFileRequestCallback callback, void* userData );
+PL_EXTERN PLFileRequest* plReadFileAsync( PLFile* ptr, void* dest, size_t length, size_t offset, PLFileRequestCallback callback, void* userData );
+PL_EXTERN PLFileRequest* plWriteFileAsync( const char* path, const void* src, size_t length, PLFileRequestCallback callback, void* userData );
+
+PL_EXTERN PLFileRequestStatus plPollFileRequest( PLFileRequest* request );
+PL_EXTERN PLFileRequestStatus plWaitFileRequest( PLFileRequest* request );
+PL_EXTERN void plDestroyFileRequest( PLFileRequest* request );
+
+PL_EXTERN PLFile* plGetFileRequestFile( const PLFileRequest* request );
+PL_EXTERN size_t plGetFileRequestLength( const PLFileRequest* request );
+
 /** FS Mounting **/
 
 PL_EXTERN PLFileSystemMount* plMountLocalLocation( const char* path );
@@ -119,6 +211,13 @@ PL_EXTERN PLFileSystemMount* plMountLocation( const char* path );
 PL_EXTERN void plClearMountedLocation( PLFileSystemMount* location );
 PL_EXTERN void plClearMountedLocations( void );
 
+PL_EXTERN void plEnableFileSystemIndex( bool enable );
+PL_EXTERN void plInvalidateFileSystemIndex( void );
+
+PL_EXTERN void plEnableFileCache( size_t maxSize );
+PL_EXTERN void plFlushFileCache( void );
+PL_EXTERN void plGetFileCacheStats( PLFileCacheStats* stats );
+
 /****/
 
 #endif
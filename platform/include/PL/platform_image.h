@@ -61,6 +61,26 @@ typedef enum PLColourFormat {
     PL_COLOURFORMAT_BGRA,
 } PLColourFormat;
 
+typedef enum PLImageCompressionQuality {
+    PL_IMAGECOMPRESSION_FAST,     // bounding box endpoints
+    PL_IMAGECOMPRESSION_NORMAL,   // principal axis endpoints, refined once
+    PL_IMAGECOMPRESSION_HIGH,     // refined until the error stops improving
+} PLImageCompressionQuality;
+
+enum {
+    PL_MIPMAPFILTER_BOX,          // 2x2 average
+    PL_MIPMAPFILTER_KAISER,       // kaiser windowed sinc, sharper
+
+    PL_MIPMAPFILTER_GAMMA = 1U << 8,  // filter in linear light, or'd with either of the above
+};
+
+typedef enum PLImageResizeFilter {
+    PL_IMAGERESIZE_BOX,           // nearest when enlarging, area average when shrinking
+    PL_IMAGERESIZE_BILINEAR,
+    PL_IMAGERESIZE_LANCZOS3,      // sharpest, may ring around hard edges
+    PL_IMAGERESIZE_MITCHELL,      // cubic, a compromise between blur and ringing
+} PLImageResizeFilter;
+
 typedef struct PLImage {
 #if 1
     uint8_t         **data;
@@ -83,6 +103,14 @@ typedef struct PLPalette {
     unsigned int    num_colours;
 } PLPalette;
 
+/* what plGetImageInfo can tell without decoding the image */
+typedef struct PLImageInfo {
+    unsigned int    width, height;
+    unsigned int    levels;         // as the loader would return them, not necessarily all held by the file
+    PLImageFormat   format;         // as the loader would return it
+    PLColourFormat  colour_format;
+} PLImageInfo;
+
 enum {
 	PL_IMAGE_FILEFORMAT_ALL = 0,
 
@@ -105,6 +133,7 @@ PL_EXTERN_C
 #if !defined( PL_COMPILE_PLUGIN )
 
 PL_EXTERN void plRegisterImageLoader( const char *extension, PLImage *(*LoadImage)( const char *path ) );
+PL_EXTERN void plRegisterImageProbe( const char *extension, bool (*ProbeImage)( const char *path, PLImageInfo *info ) );
 PL_EXTERN void plRegisterStandardImageLoaders( unsigned int flags );
 PL_EXTERN void plClearImageLoaders( void );
 
@@ -112,10 +141,17 @@ PL_EXTERN PLImage *plCreateImage(uint8_t *buf, unsigned int w, unsigned int h, P
 PL_EXTERN void plDestroyImage(PLImage *image);
 
 PL_EXTERN PLImage *plLoadImage( const char *path );
+PL_EXTERN bool plGetImageInfo( const char *path, PLImageInfo *info );
 PL_EXTERN bool plWriteImage(const PLImage *image, const char *path);
 
 PL_EXTERN bool plConvertPixelFormat(PLImage *image, PLImageFormat new_format);
-//PL_EXTERN bool plConvertColourFormat( PLImage *image, PLColourFormat newFormat );
+PL_EXTERN bool plConvertColourFormat( PLImage *image, PLColourFormat newFormat );
+
+PL_EXTERN bool plCompressImage( PLImage *image, PLImageFormat format, PLImageCompressionQuality quality );
+PL_EXTERN bool plDecompressImage( PLImage *image );
+
+PL_EXTERN bool plGenerateImageMipmaps( PLImage *image, unsigned int filter );
+PL_EXTERN bool plResizeImage( PLImage *image, unsigned int width, unsigned int height, PLImageResizeFilter filter );
 
 PL_EXTERN void plInvertImageColour(PLImage *image);
 PL_EXTERN void plReplaceImageColour(PLImage *image, PLColour target, PLColour dest);
@@ -30,30 +30,56 @@ For more information, please refer to <http://unlicense.org>
 #include <PL/platform.h>
 #include <PL/platform_filesystem.h>
 
-typedef enum PLCompressionType {
-	PL_COMPRESSION_NONE,
-	PL_COMPRESSION_ZLIB,
-
-	PL_MAX_COMPRESSION_FORMATS
-} PLCompressionType;
-
+/* names are kept in a single pool owned by the package, so fetch them
+ * via plGetPackageFileName and set them with plSetPackageFileName */
 typedef struct PLPackageIndex {
 	size_t offset;
-	char fileName[ PL_SYSTEM_MAX_PATH ];
 	size_t fileSize;
 	size_t compressedSize;
 	PLCompressionType compressionType;
+	uint32_t nameOffset;    /* offset into the name pool */
+	uint32_t nameLength;
+	uint32_t nameHash;      /* case-folded hash of the name */
+	uint64_t contentHash;   /* hash of the uncompressed contents, 0 if the format doesn't provide one */
 } PLPackageIndex;
 
 typedef struct PLPackage {
 	char path[PL_SYSTEM_MAX_PATH];
 	unsigned int    table_size;
 	PLPackageIndex* table;
+	struct {
+		char* names;
+		size_t length;
+		size_t maxLength;
+	} namePool;
 	struct {
 		uint8_t* (* LoadFile)( PLFile* package, PLPackageIndex* index );
+		PLFile* filePtr;    /* kept open for the lifetime of the package */
+		/* open-addressed name lookup, each slot is table index + 1 (0 is empty) */
+		unsigned int* hashTable;
+		unsigned int hashTableSize;
+		bool caseInsensitive;   /* whether or not names should be matched regardless of case */
+		bool isSorted;          /* table is ordered by name hash, so no lookup table is needed */
 	} internal;
 } PLPackage;
 
+/**
+ * Receives each file loaded by plLoadPackageFiles, taking ownership of it.
+ * The file is NULL if that index failed to load.
+ */
+typedef void ( *PLPackageFileCallback )( PLFile *file, unsigned int index, void *userData );
+
+/**
+ * Pulls in the next chunk of compressed data for a codec, returning
+ * the number of bytes read, or 0 once there's nothing left.
+ */
+typedef size_t ( *PLCompressionReadFunction )( void *source, void *dest, size_t length );
+/**
+ * Decompresses a stream into dest, which is exactly the size of the
+ * decompressed data. Returns false if the stream is invalid.
+ */
+typedef bool ( *PLDecompressFunction )( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength );
+
 PL_EXTERN_C
 
 #if !defined( PL_COMPILE_PLUGIN )
@@ -63,17 +89,26 @@ PL_EXTERN PLPackage *plCreatePackageHandle( const char *path, unsigned int table
 PL_EXTERN PLPackage* plLoadPackage( const char* path );
 PL_EXTERN PLFile* plLoadPackageFile( PLPackage* package, const char* path );
 PL_EXTERN PLFile *plLoadPackageFileByIndex( PLPackage *package, unsigned int index );
+PL_EXTERN bool plLoadPackageFiles( PLPackage *package, const unsigned int *indices, unsigned int numIndices, PLPackageFileCallback callback, void *userData );
+PL_EXTERN PLFile *plLoadPackageFileView( PLPackage *package, const char *path );
+PL_EXTERN bool plExtractPackageFile( PLPackage *package, unsigned int index, const char *destPath );
+PL_EXTERN bool plWritePackage( PLPackage *package, const char *path, PLCompressionType compressionType );
 PL_EXTERN void plDestroyPackage( PLPackage* package );
 
 PL_EXTERN void plRegisterPackageLoader( const char* ext, PLPackage* (* LoadFunction)( const char* path ) );
 PL_EXTERN void plRegisterStandardPackageLoaders( void );
 PL_EXTERN void plClearPackageLoaders( void );
 
+PL_EXTERN bool plRegisterCompressionCodec( PLCompressionType type, PLDecompressFunction DecompressFunction );
+PL_EXTERN bool plEnablePackageIndexCache( const char *path );
+
 PL_EXTERN const char *plGetPackagePath( const PLPackage *package );
 PL_EXTERN unsigned int plGetPackageTableSize( const PLPackage *package );
 PL_EXTERN unsigned int plGetPackageTableIndex( const PLPackage *package, const char *indexName );
+PL_EXTERN const PLPackageIndex *plGetPackageIndex( const PLPackage *package, const char *path );
 
-const char *plGetPackageFileName( const PLPackage *package, unsigned int index );
+PL_EXTERN const char *plGetPackageFileName( const PLPackage *package, unsigned int index );
+PL_EXTERN bool plSetPackageFileName( PLPackage *package, unsigned int index, const char *name, size_t maxLength );
 
 #endif
 
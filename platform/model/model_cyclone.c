@@ -258,14 +258,14 @@ PLModel* LoadStaticRequiemModel(PLFile* fp) {
     }
 
     plFileSeek(fp, 16, PL_SEEK_CUR); // todo, figure these out
-    if (plReadFile(fp, polygons[i].indices, sizeof(uint16_t), polygons[i].num_indices) != polygons[i].num_indices) {
+    if (plReadInt16Array(fp, (int16_t *) polygons[i].indices, polygons[i].num_indices, false) != polygons[i].num_indices) {
       ReportError(PL_RESULT_FILEREAD, "invalid file length, failed to load indices");
       return NULL;
     }
 
     unsigned int num_uv_coords = (unsigned int) (polygons[i].num_indices * 4);
     //ModelLog(" num bytes for UV coords is %lu\n", num_uv_coords * sizeof(int16_t));
-    if (plReadFile(fp, polygons[i].uv, sizeof(int16_t), num_uv_coords) != num_uv_coords) {
+    if (plReadInt16Array(fp, polygons[i].uv, num_uv_coords, false) != num_uv_coords) {
       ReportError(PL_RESULT_FILEREAD, "invalid file length, failed to load UV coords");
       return NULL;
     }
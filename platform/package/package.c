@@ -29,11 +29,27 @@ For more information, please refer to <http://unlicense.org>
 #include "package_private.h"
 #include "filesystem_private.h"
 
+uint8_t *_plLoadGenericPackageFile( PLFile *fh, PLPackageIndex *pi ) {
+	FunctionStart();
+
+	if ( pi->compressionType != PL_COMPRESSION_NONE ) {
+		return _plLoadCompressedPackageFile( fh, pi );
+	}
+
+	uint8_t *dataPtr = pl_malloc( pi->fileSize );
+	if( plReadFileAt( fh, dataPtr, pi->fileSize, 1, pi->offset ) != 1 ) {
+		pl_free( dataPtr );
+		return NULL;
+	}
+
+	return dataPtr;
+}
+
 /**
  * Allocate a new package handle.
  */
 PLPackage *plCreatePackageHandle( const char *path, unsigned int tableSize, uint8_t*(*OpenFile)( PLFile *filePtr, PLPackageIndex *index ) ) {
-	PLPackage *package = pl_malloc( sizeof( PLPackage ) );
+	PLPackage *package = pl_calloc( 1, sizeof( PLPackage ) );
 
 	if ( OpenFile == NULL ) {
 		package->internal.LoadFile = _plLoadGenericPackageFile;
@@ -56,14 +72,204 @@ void plDestroyPackage( PLPackage* package ) {
 		return;
 	}
 
+	plCloseFile( package->internal.filePtr );
+
+	pl_free( package->internal.hashTable );
+	pl_free( package->namePool.names );
 	pl_free( package->table );
 	pl_free( package );
 }
-#if 0 // todo
-void plWritePackage(PLPackage *package) {
 
+/**
+ * Case-folded FNV-1a hash of the given file name, so the same hash can
+ * be used for both case-sensitive and case-insensitive lookups.
+ */
+uint32_t _plHashPackageFileName( const char *name, size_t length ) {
+	uint32_t hash = 2166136261u;
+	for ( size_t i = 0; i < length; ++i ) {
+		hash ^= ( uint8_t ) tolower( name[ i ] );
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static int _plComparePackageFileName( const PLPackage *package, const char *a, const char *b ) {
+	return package->internal.caseInsensitive ? pl_strcasecmp( a, b ) : strcmp( a, b );
+}
+
+/**
+ * (Re)builds the hashed name index for the given package. Loaders fill in the
+ * table after the handle is created, so this is done once loading is complete.
+ * Lookups never build it themselves, so they're safe to make from multiple
+ * threads at once, and just search the table if it's missing.
+ */
+static void _plBuildPackageHashTable( PLPackage *package ) {
+	pl_free( package->internal.hashTable );
+	package->internal.hashTable = NULL;
+
+	/* keep the load factor at or under a half */
+	unsigned int size = 16;
+	while ( size < package->table_size * 2 ) {
+		size <<= 1;
+	}
+
+	unsigned int *hashTable = pl_calloc( size, sizeof( unsigned int ) );
+	if ( hashTable == NULL ) {
+		return;
+	}
+
+	package->internal.hashTableSize = size;
+	package->internal.hashTable = hashTable;
+
+	for ( unsigned int i = 0; i < package->table_size; ++i ) {
+		const PLPackageIndex *index = &package->table[ i ];
+		unsigned int slot = index->nameHash & ( size - 1 );
+		for ( ; package->internal.hashTable[ slot ] != 0; slot = ( slot + 1 ) & ( size - 1 ) ) {
+			/* first entry with a given name wins, same as a linear search */
+			unsigned int j = package->internal.hashTable[ slot ] - 1;
+			if ( package->table[ j ].nameHash == index->nameHash &&
+			     _plComparePackageFileName( package, plGetPackageFileName( package, j ), plGetPackageFileName( package, i ) ) == 0 ) {
+				break;
+			}
+		}
+
+		if ( package->internal.hashTable[ slot ] == 0 ) {
+			package->internal.hashTable[ slot ] = i + 1;
+		}
+	}
+}
+
+/**
+ * Sets the name for the given index, copying it into the package's name pool.
+ * Names are often stored in fixed-size fields that aren't always terminated,
+ * so the name is read up to either a terminator or the given maximum length.
+ */
+bool plSetPackageFileName( PLPackage *package, unsigned int index, const char *name, size_t maxLength ) {
+	if ( index >= package->table_size ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM2 );
+		return false;
+	}
+
+	size_t length = 0;
+	while ( length < maxLength && name[ length ] != '\0' ) {
+		length++;
+	}
+
+	/* the pool always starts with an empty name, for indices that never get one */
+	if ( package->namePool.length == 0 ) {
+		package->namePool.length = 1;
+	}
+
+	size_t newLength = package->namePool.length + length + 1;
+	if ( newLength > UINT32_MAX ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "package name pool is full" );
+		return false;
+	}
+
+	if ( newLength > package->namePool.maxLength ) {
+		size_t maxPoolLength = package->namePool.maxLength > 0 ? package->namePool.maxLength : 256;
+		while ( maxPoolLength < newLength ) {
+			maxPoolLength *= 2;
+		}
+
+		char *names = pl_realloc( package->namePool.names, maxPoolLength );
+		if ( names == NULL ) {
+			return false;
+		}
+
+		names[ 0 ] = '\0';
+		package->namePool.names = names;
+		package->namePool.maxLength = maxPoolLength;
+	}
+
+	PLPackageIndex *packageIndex = &package->table[ index ];
+	packageIndex->nameOffset = ( uint32_t ) package->namePool.length;
+	packageIndex->nameLength = ( uint32_t ) length;
+	packageIndex->nameHash = _plHashPackageFileName( name, length );
+
+	memcpy( &package->namePool.names[ package->namePool.length ], name, length );
+	package->namePool.names[ package->namePool.length + length ] = '\0';
+	package->namePool.length = newLength;
+
+	/* loaders name everything before the lookup table is first built, but
+	 * once it has been, keep it up to date here rather than in the lookup */
+	bool isIndexed = ( package->internal.hashTable != NULL || package->internal.isSorted );
+	package->internal.isSorted = false;
+	if ( isIndexed ) {
+		_plBuildPackageHashTable( package );
+	}
+
+	return true;
+}
+
+/**
+ * Returns the table index for the given file name, or -1 if it's not in the package.
+ */
+static int _plFindPackageIndex( const PLPackage *package, const char *name ) {
+	uint32_t hash = _plHashPackageFileName( name, strlen( name ) );
+
+	/* tables already ordered by hash can be searched as they are */
+	if ( package->internal.isSorted ) {
+		unsigned int lower = 0, upper = package->table_size;
+		while ( lower < upper ) {
+			unsigned int middle = lower + ( upper - lower ) / 2;
+			if ( package->table[ middle ].nameHash < hash ) {
+				lower = middle + 1;
+			} else {
+				upper = middle;
+			}
+		}
+
+		for ( unsigned int i = lower; i < package->table_size && package->table[ i ].nameHash == hash; ++i ) {
+			if ( _plComparePackageFileName( package, plGetPackageFileName( package, i ), name ) == 0 ) {
+				return ( int ) i;
+			}
+		}
+
+		return -1;
+	}
+
+	if ( package->internal.hashTable == NULL ) {
+		for ( unsigned int i = 0; i < package->table_size; ++i ) {
+			if ( package->table[ i ].nameHash == hash &&
+			     _plComparePackageFileName( package, plGetPackageFileName( package, i ), name ) == 0 ) {
+				return ( int ) i;
+			}
+		}
+
+		return -1;
+	}
+
+	unsigned int mask = package->internal.hashTableSize - 1;
+	for ( unsigned int slot = hash & mask; package->internal.hashTable[ slot ] != 0; slot = ( slot + 1 ) & mask ) {
+		unsigned int i = package->internal.hashTable[ slot ] - 1;
+		if ( package->table[ i ].nameHash == hash &&
+		     _plComparePackageFileName( package, plGetPackageFileName( package, i ), name ) == 0 ) {
+			return ( int ) i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Opens the handle we use for reading package contents; this is
+ * kept open for the lifetime of the package. Where possible the
+ * package is mapped, so members can be viewed without a copy.
+ */
+static bool _plOpenPackageHandle( PLPackage *package ) {
+	if ( package->internal.filePtr != NULL ) {
+		return true;
+	}
+
+	package->internal.filePtr = plMapFile( package->path );
+	if ( package->internal.filePtr == NULL ) {
+		package->internal.filePtr = plOpenFile( package->path, false );
+	}
+
+	return ( package->internal.filePtr != NULL );
 }
-#endif
 /////////////////////////////////////////////////////////////////
 
 typedef struct PLPackageLoader {
@@ -114,6 +320,21 @@ void plRegisterStandardPackageLoaders( void ) {
 	plRegisterPackageLoader( "rim", plLoadRIDBPackage );
 	/* mortyr */
 	plRegisterPackageLoader( "hal", plLoadAPUKPackage );
+	/* our own */
+	plRegisterPackageLoader( "pack", plLoadPACKPackage );
+}
+
+/**
+ * Final setup for a package that's just been loaded.
+ */
+static PLPackage *_plFinishLoadingPackage( PLPackage *package, const char *path ) {
+	strncpy( package->path, path, sizeof( package->path ) );
+	_plOpenPackageHandle( package );
+	if ( !package->internal.isSorted ) {
+		_plBuildPackageHashTable( package );
+	}
+
+	return package;
 }
 
 PLPackage* plLoadPackage( const char* path ) {
@@ -124,6 +345,12 @@ PLPackage* plLoadPackage( const char* path ) {
 		return NULL;
 	}
 
+	/* no need to go through the loader if we've already got its table */
+	PLPackage* package = _plLoadCachedPackage( path );
+	if ( package != NULL ) {
+		return _plFinishLoadingPackage( package, path );
+	}
+
 	const char* ext = plGetFileExtension( path );
 	for ( unsigned int i = 0; i < num_package_loaders; ++i ) {
 		if ( package_loaders[ i ].LoadFunction == NULL ) {
@@ -132,59 +359,284 @@ PLPackage* plLoadPackage( const char* path ) {
 
 		if ( !plIsEmptyString( ext ) && !plIsEmptyString( package_loaders[ i ].ext ) ) {
 			if ( pl_strncasecmp( ext, package_loaders[ i ].ext, sizeof( package_loaders[ i ].ext ) ) == 0 ) {
-				PLPackage* package = package_loaders[ i ].LoadFunction( path );
-				if ( package != NULL ) {
-					strncpy( package->path, path, sizeof( package->path ) );
-					return package;
-				}
+				package = package_loaders[ i ].LoadFunction( path );
 			}
 		} else if ( plIsEmptyString( ext ) && plIsEmptyString( package_loaders[ i ].ext ) ) {
-			PLPackage* package = package_loaders[ i ].LoadFunction( path );
-			if ( package != NULL ) {
-				strncpy( package->path, path, sizeof( package->path ) );
-				return package;
-			}
+			package = package_loaders[ i ].LoadFunction( path );
+		}
+
+		if ( package != NULL ) {
+			_plFinishLoadingPackage( package, path );
+			_plCachePackage( package );
+			return package;
 		}
 	}
 
 	return NULL;
 }
 
+/**
+ * Wraps loaded data for the given index in a file handle, which takes
+ * ownership of it.
+ */
+static PLFile *_plCreatePackageFile( const PLPackage *package, unsigned int index, uint8_t *dataPtr ) {
+	PLFile *file = pl_calloc( 1, sizeof( PLFile ) );
+	snprintf( file->path, sizeof( file->path ), "%s", plGetPackageFileName( package, index ) );
+	file->size = package->table[ index ].fileSize;
+	file->data = dataPtr;
+	file->pos = file->data;
+
+	return file;
+}
+
 PLFile* plLoadPackageFile( PLPackage* package, const char* path ) {
 	if ( package->internal.LoadFile == NULL ) {
 		ReportError( PL_RESULT_FILEREAD, "package has not been initialized, no LoadFile function assigned, aborting" );
 		return NULL;
 	}
 
-	for ( unsigned int i = 0; i < package->table_size; ++i ) {
-		if ( strcmp( path, package->table[ i ].fileName ) != 0 ) {
-			continue;
+	int i = _plFindPackageIndex( package, path );
+	if ( i == -1 ) {
+		ReportError( PL_RESULT_INVALID_PARM2, "failed to find file in package" );
+		return NULL;
+	}
+
+	/* handles created outside of plLoadPackage won't have been opened yet */
+	if ( !_plOpenPackageHandle( package ) ) {
+		return NULL;
+	}
+
+	uint8_t* dataPtr = package->internal.LoadFile( package->internal.filePtr, &( package->table[ i ] ) );
+	if ( dataPtr == NULL ) {
+		return NULL;
+	}
+
+	return _plCreatePackageFile( package, ( unsigned int ) i, dataPtr );
+}
+
+/**
+ * Returns a read-only view of the given file that points directly into the
+ * package's mapping, avoiding a copy. The view is only valid for as long as
+ * the package is loaded. If the file can't be viewed directly, i.e. it's
+ * compressed or the package couldn't be mapped, this falls back to loading
+ * a copy as plLoadPackageFile does.
+ */
+PLFile *plLoadPackageFileView( PLPackage *package, const char *path ) {
+	int i = _plFindPackageIndex( package, path );
+	if ( i == -1 ) {
+		ReportError( PL_RESULT_INVALID_PARM2, "failed to find file in package" );
+		return NULL;
+	}
+
+	if ( !_plOpenPackageHandle( package ) ) {
+		return NULL;
+	}
+
+	const PLFile *packageFile = package->internal.filePtr;
+	const PLPackageIndex *index = &package->table[ i ];
+	if ( packageFile->data == NULL ||
+	     package->internal.LoadFile != _plLoadGenericPackageFile ||
+	     index->compressionType != PL_COMPRESSION_NONE ||
+	     index->offset > packageFile->size || index->fileSize > packageFile->size - index->offset ) {
+		return plLoadPackageFile( package, path );
+	}
+
+	PLFile *file = pl_calloc( 1, sizeof( PLFile ) );
+	snprintf( file->path, sizeof( file->path ), "%s", plGetPackageFileName( package, i ) );
+	file->size = index->fileSize;
+	file->data = packageFile->data + index->offset;
+	file->pos = file->data;
+	file->isView = true;
+
+	return file;
+}
+
+/**
+ * Writes the given file in the package straight out to disk. Where the
+ * file is stored uncompressed this is copied directly from the package,
+ * without loading it into memory first.
+ * @param package Package to extract from.
+ * @param index Index of the file in the package's table.
+ * @param destPath Local path to write the file out to.
+ * @return True on success.
+ */
+bool plExtractPackageFile( PLPackage *package, unsigned int index, const char *destPath ) {
+	if ( index >= package->table_size ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM2 );
+		return false;
+	}
+
+	/* writing over the package would truncate it before the member's read */
+	if ( _plIsSameLocalFile( package->path, destPath ) ) {
+		ReportError( PL_RESULT_FILEPATH, "%s is the package being extracted from", destPath );
+		return false;
+	}
+
+	if ( !_plOpenPackageHandle( package ) ) {
+		return false;
+	}
+
+	const PLPackageIndex *pi = &package->table[ index ];
+	if ( package->internal.LoadFile == _plLoadGenericPackageFile && pi->compressionType == PL_COMPRESSION_NONE ) {
+		return _plWriteFileRange( package->internal.filePtr, pi->offset, pi->fileSize, destPath );
+	}
+
+	/* needs to be decoded by the loader first */
+	PLFile *file = plLoadPackageFileByIndex( package, index );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	bool result = plWriteFile( destPath, plGetFileData( file ), plGetFileSize( file ) );
+	plCloseFile( file );
+
+	return result;
+}
+
+/* members closer together than this are read in one go, with the gap thrown away */
+#define PACKAGE_READ_MERGE_GAP  65536
+/* but reads are never grown beyond this */
+#define PACKAGE_READ_MAX_SPAN   ( 16 * 1024 * 1024 )
+
+typedef struct PackageReadRequest {
+	size_t offset;
+	size_t length;
+	unsigned int index;
+} PackageReadRequest;
+
+static int _plComparePackageReadRequests( const void *a, const void *b ) {
+	const PackageReadRequest *ra = a, *rb = b;
+	if ( ra->offset != rb->offset ) {
+		return ( ra->offset < rb->offset ) ? -1 : 1;
+	}
+
+	/* keep the original order for anything sharing an offset */
+	return ( ra->index < rb->index ) ? -1 : ( ra->index > rb->index );
+}
+
+/**
+ * Loads a number of files from the package at once. Requests are
+ * sorted by their offset in the package and neighbouring files are
+ * fetched with a single sequential read, rather than seeking about
+ * the package for each one.
+ * The callback is run for each file in the order it's stored in the
+ * package, and takes ownership of the file; if a file failed to
+ * load, the callback is given NULL instead.
+ * @param package Package to load from.
+ * @param indices List of indices in the package's table to load.
+ * @param numIndices Number of indices in the list.
+ * @param callback Function to receive each loaded file.
+ * @param userData Passed through to the callback.
+ * @return False if any of the files failed to load.
+ */
+bool plLoadPackageFiles( PLPackage *package, const unsigned int *indices, unsigned int numIndices, PLPackageFileCallback callback, void *userData ) {
+	FunctionStart();
+
+	if ( package->internal.LoadFile == NULL ) {
+		ReportError( PL_RESULT_FILEREAD, "package has not been initialized, no LoadFile function assigned, aborting" );
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < numIndices; ++i ) {
+		if ( indices[ i ] >= package->table_size ) {
+			ReportBasicError( PL_RESULT_INVALID_PARM2 );
+			return false;
+		}
+	}
+
+	if ( numIndices == 0 ) {
+		return true;
+	}
+
+	PackageReadRequest *requests = _plOpenPackageHandle( package ) ? pl_malloc( sizeof( PackageReadRequest ) * numIndices ) : NULL;
+	if ( requests == NULL ) {
+		/* every file still gets its callback */
+		for ( unsigned int i = 0; i < numIndices; ++i ) {
+			callback( NULL, indices[ i ], userData );
 		}
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < numIndices; ++i ) {
+		requests[ i ].offset = package->table[ indices[ i ] ].offset;
+		requests[ i ].length = package->table[ indices[ i ] ].fileSize;
+		requests[ i ].index = indices[ i ];
+	}
+
+	qsort( requests, numIndices, sizeof( PackageReadRequest ), _plComparePackageReadRequests );
 
-		/* load in the package */
-		PLFile* packageFile = plOpenFile( package->path, true );
-		if ( packageFile == NULL ) {
-			return NULL;
+	/* only stored files can be sliced out of a larger read, the rest go through the loader */
+	bool canMergeReads = ( package->internal.LoadFile == _plLoadGenericPackageFile );
+
+	bool result = true;
+	uint8_t *span = NULL;
+	size_t maxSpanLength = 0;
+	for ( unsigned int i = 0; i < numIndices; ) {
+		const PLPackageIndex *pi = &package->table[ requests[ i ].index ];
+		if ( !canMergeReads || pi->compressionType != PL_COMPRESSION_NONE ) {
+			uint8_t *dataPtr = package->internal.LoadFile( package->internal.filePtr, &package->table[ requests[ i ].index ] );
+			if ( dataPtr == NULL ) {
+				result = false;
+			}
+
+			callback( ( dataPtr != NULL ) ? _plCreatePackageFile( package, requests[ i ].index, dataPtr ) : NULL, requests[ i ].index, userData );
+			i++;
+			continue;
 		}
 
-		PLFile* file = NULL;
+		/* gather up as many neighbouring files as we can into the one read */
+		size_t spanStart = requests[ i ].offset;
+		size_t spanEnd = spanStart + requests[ i ].length;
+		unsigned int spanCount = 1;
+		for ( unsigned int j = i + 1; j < numIndices; ++j, ++spanCount ) {
+			const PackageReadRequest *next = &requests[ j ];
+			if ( package->table[ next->index ].compressionType != PL_COMPRESSION_NONE ||
+			     next->offset > spanEnd + PACKAGE_READ_MERGE_GAP ||
+			     next->offset + next->length - spanStart > PACKAGE_READ_MAX_SPAN ) {
+				break;
+			}
+
+			/* members may well overlap */
+			if ( next->offset + next->length > spanEnd ) {
+				spanEnd = next->offset + next->length;
+			}
+		}
 
-		uint8_t* dataPtr = package->internal.LoadFile( packageFile, &( package->table[ i ] ) );
-		if ( dataPtr != NULL ) {
-			file = pl_malloc( sizeof( PLFile ) );
-			snprintf( file->path, sizeof( file->path ), "%s", package->table[ i ].fileName );
-			file->size = package->table[ i ].fileSize;
-			file->data = dataPtr;
-			file->pos = file->data;
+		size_t spanLength = spanEnd - spanStart;
+		if ( spanLength > maxSpanLength ) {
+			uint8_t *newSpan = pl_realloc( span, spanLength );
+			if ( newSpan != NULL ) {
+				span = newSpan;
+				maxSpanLength = spanLength;
+			}
 		}
 
-		plCloseFile( packageFile );
+		/* if the span couldn't be grown, each of its files fails, but we carry on with the rest */
+		bool isSpanRead = ( spanLength == 0 ||
+		                    ( spanLength <= maxSpanLength && plReadFileAt( package->internal.filePtr, span, spanLength, 1, spanStart ) == 1 ) );
+		for ( unsigned int j = i; j < i + spanCount; ++j ) {
+			uint8_t *dataPtr = NULL;
+			if ( isSpanRead ) {
+				dataPtr = pl_malloc( requests[ j ].length );
+				if ( dataPtr != NULL ) {
+					memcpy( dataPtr, span + ( requests[ j ].offset - spanStart ), requests[ j ].length );
+				}
+			}
+
+			if ( dataPtr == NULL ) {
+				result = false;
+			}
+
+			callback( ( dataPtr != NULL ) ? _plCreatePackageFile( package, requests[ j ].index, dataPtr ) : NULL, requests[ j ].index, userData );
+		}
 
-		return file;
+		i += spanCount;
 	}
 
-	ReportError( PL_RESULT_INVALID_PARM2, "failed to find file in package" );
-	return NULL;
+	pl_free( span );
+	pl_free( requests );
+
+	return result;
 }
 
 PLFile *plLoadPackageFileByIndex( PLPackage *package, unsigned int index ) {
@@ -193,7 +645,7 @@ PLFile *plLoadPackageFileByIndex( PLPackage *package, unsigned int index ) {
 		return NULL;
 	}
 
-	return plLoadPackageFile( package, package->table[ index ].fileName );
+	return plLoadPackageFile( package, plGetPackageFileName( package, index ) );
 }
 
 const char *plGetPackagePath( const PLPackage *package ) {
@@ -206,22 +658,39 @@ const char *plGetPackageFileName( const PLPackage *package, unsigned int index )
 		return NULL;
 	}
 
-	return package->table[ index ].fileName;
+	/* indices without a name point at the empty name at the start of the pool */
+	if ( package->namePool.names == NULL ) {
+		return "";
+	}
+
+	return &package->namePool.names[ package->table[ index ].nameOffset ];
 }
 
 unsigned int plGetPackageTableSize( const PLPackage *package ) {
 	return package->table_size;
 }
 
+/**
+ * Returns the table entry for the given file, or NULL if it's not in the package.
+ * Unlike plGetPackageTableIndex, no error is reported if it can't be found.
+ */
+const PLPackageIndex *plGetPackageIndex( const PLPackage *package, const char *path ) {
+	/* the index is built on demand, so it's not strictly const here */
+	int i = _plFindPackageIndex( package, path );
+	if ( i == -1 ) {
+		return NULL;
+	}
+
+	return &package->table[ i ];
+}
+
 unsigned int plGetPackageTableIndex( const PLPackage *package, const char *indexName ) {
 	FunctionStart();
 
-	for ( unsigned int i = 0; i < package->table_size; ++i ) {
-		if ( strcmp( indexName, package->table[ i ].fileName ) != 0 ) {
-			continue;
-		}
-
-		return i;
+	/* the index is built on demand, so it's not strictly const here */
+	int i = _plFindPackageIndex( package, indexName );
+	if ( i != -1 ) {
+		return ( unsigned int ) i;
 	}
 
 	ReportBasicError( PL_RESULT_INVALID_PARM2 );
@@ -47,7 +47,9 @@ PLPackage* plLoadLSTPackage( const char* path ) {
 	char ibf_path[PL_SYSTEM_MAX_PATH + 1];
 	strncpy( ibf_path, path, strlen( path ) - 3 );
 	strncat( ibf_path, "ibf", PL_SYSTEM_MAX_PATH );
-	if ( !plFileExists( ibf_path ) ) {
+	/* grab the IBF size so we can do some sanity checking later */
+	PLFileStat ibf_stat;
+	if ( !plStatFile( ibf_path, &ibf_stat ) ) {
 		ReportError( PL_RESULT_FILEPATH, "failed to open ibf package at \"%s\", aborting", ibf_path );
 		goto ABORT;
 	}
@@ -55,8 +57,7 @@ PLPackage* plLoadLSTPackage( const char* path ) {
 	//DebugPrint("LST %s\n", path);
 	//DebugPrint("IBF %s\n", ibf_path);
 
-	/* grab the IBF size so we can do some sanity checking later */
-	size_t ibf_size = plGetLocalFileSize( ibf_path );
+	size_t ibf_size = ibf_stat.size;
 	if ( ibf_size == 0 ) {
 		ReportError( PL_RESULT_FILESIZE, "invalid ibf \"%s\" size of 0, aborting", ibf_path );
 		goto ABORT;
@@ -114,8 +115,7 @@ PLPackage* plLoadLSTPackage( const char* path ) {
 			goto ABORT;
 		}
 
-		strncpy( package->table[ i ].fileName, index.name, sizeof( package->table[ i ].fileName ) );
-		package->table[ i ].fileName[ sizeof( package->table[ i ].fileName ) - 1 ] = '\0';
+		plSetPackageFileName( package, i, index.name, sizeof( index.name ) );
 		package->table[ i ].fileSize = index.data_length;
 		package->table[ i ].offset = index.data_offset;
 	}
@@ -119,7 +119,7 @@ PLPackage *plLoadRIDBPackage( const char *path ) {
 		PLPackageIndex *index = &package->table[ i ];
 		index->offset = indices[ i ].offset;
 		index->fileSize = indices[ i ].size;
-		strncpy( index->fileName, indices[ i ].name, sizeof( index->fileName ) );
+		plSetPackageFileName( package, i, indices[ i ].name, sizeof( indices[ i ].name ) );
 	}
 
 	pl_free( indices );
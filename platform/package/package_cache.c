@@ -0,0 +1,291 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+
+#include "package_private.h"
+#include "filesystem_private.h"
+
+/* Optional on-disk cache of package tables, so that packages which have
+ * been loaded before can skip their loader entirely. Each cached table
+ * is keyed by the package's resolved path, size and modification time,
+ * and those of any companion file it keeps its data in. */
+
+#define PACKAGE_CACHE_VERSION   2
+
+PL_PACKED_STRUCT_START( PackageCacheHeader )
+	uint8_t identity[ 4 ];  /* "PTOC" */
+	uint8_t version[ 2 ];
+	uint16_t flags;         /* same as PLPackageHeader */
+	uint32_t numIndexes;
+	uint32_t namesLength;
+	uint64_t packageSize;   /* the cached table is stale if any of these change */
+	int64_t modTime;
+	uint64_t companionSize;
+	int64_t companionModTime;
+	char path[ PL_SYSTEM_MAX_PATH ];
+PL_PACKED_STRUCT_END( PackageCacheHeader )
+/* followed by the table, and then the name pool */
+
+static char cacheLocation[ PL_SYSTEM_MAX_PATH ];
+
+/**
+ * Enables caching the tables of loaded packages under the given directory,
+ * which is created if it doesn't exist already.
+ * @param path Directory to store cached tables in, NULL to disable the cache.
+ * @return True on success.
+ */
+bool plEnablePackageIndexCache( const char *path ) {
+	if ( path == NULL || *path == '\0' ) {
+		cacheLocation[ 0 ] = '\0';
+		return true;
+	}
+
+	if ( !plCreatePath( path ) ) {
+		return false;
+	}
+
+	snprintf( cacheLocation, sizeof( cacheLocation ), "%s", path );
+	return true;
+}
+
+typedef struct PackageCacheKey {
+	char path[ PL_SYSTEM_MAX_PATH ];    /* resolved, where possible */
+	uint64_t packageSize;
+	int64_t modTime;
+	uint64_t companionSize;             /* both 0 if there's no companion */
+	int64_t companionModTime;
+	char cachePath[ PL_SYSTEM_MAX_PATH ];
+} PackageCacheKey;
+
+/**
+ * Fetches the size and modification time of the given file, along with
+ * the local path it's at, which is left empty if it's inside a package.
+ */
+static bool GetPackageFileStats( const char *path, uint64_t *size, int64_t *modTime, char *localPath, size_t localPathLength ) {
+	PLFileStat stats;
+	if ( !plStatFile( path, &stats ) ) {
+		return false;
+	}
+
+	const char *mountPath = ( stats.mount != NULL ) ? _plGetMountedLocationPath( stats.mount ) : NULL;
+	if ( mountPath != NULL ) {
+		snprintf( localPath, localPathLength, "%s/%s", mountPath, path );
+	} else if ( stats.mount == NULL ) {
+		snprintf( localPath, localPathLength, "%s", path );
+	} else {
+		localPath[ 0 ] = '\0';
+	}
+
+	/* local files get a more precise timestamp, so rewrites within the same second are caught */
+	if ( localPath[ 0 ] == '\0' || !_plGetLocalFileModTime( localPath, modTime ) ) {
+		*modTime = ( int64_t ) stats.timeStamp * 1000000000;
+	}
+
+	*size = stats.size;
+	return true;
+}
+
+/**
+ * Resolves the given local path to an absolute one, following any links.
+ */
+static bool GetCanonicalPath( const char *path, char *out, size_t length ) {
+#if defined( _WIN32 )
+	return ( _fullpath( out, path, length ) != NULL );
+#else
+	char resolvedPath[ PATH_MAX ];
+	if ( realpath( path, resolvedPath ) == NULL ) {
+		return false;
+	}
+
+	snprintf( out, length, "%s", resolvedPath );
+	return true;
+#endif
+}
+
+/**
+ * Fetches the key a package's table is cached under, along with where it's stored.
+ */
+static bool GetPackageCacheKey( const char *path, PackageCacheKey *key ) {
+	char localPath[ PL_SYSTEM_MAX_PATH + 1 ];
+	if ( !GetPackageFileStats( path, &key->packageSize, &key->modTime, localPath, sizeof( localPath ) ) ) {
+		return false;
+	}
+
+	/* keyed by where it actually is, so the same package is found
+	 * whatever the working directory, or however it was reached */
+	if ( localPath[ 0 ] == '\0' || !GetCanonicalPath( localPath, key->path, sizeof( key->path ) ) ) {
+		snprintf( key->path, sizeof( key->path ), "%s", path );
+	}
+
+	/* LST packages only hold the table, the data itself is in the IBF alongside */
+	key->companionSize = 0;
+	key->companionModTime = 0;
+	if ( pl_strcasecmp( plGetFileExtension( path ), "lst" ) == 0 ) {
+		char companionPath[ PL_SYSTEM_MAX_PATH + 1 ];
+		snprintf( companionPath, sizeof( companionPath ), "%.*sibf", ( int ) ( strlen( path ) - 3 ), path );
+		if ( !GetPackageFileStats( companionPath, &key->companionSize, &key->companionModTime, localPath, sizeof( localPath ) ) ) {
+			return false;
+		}
+	}
+
+	uint64_t hash = 14695981039346656037ULL;
+	for ( const char *c = key->path; *c != '\0'; ++c ) {
+		hash ^= ( uint8_t ) *c;
+		hash *= 1099511628211ULL;
+	}
+
+	int length = snprintf( key->cachePath, sizeof( key->cachePath ), "%s/%016llx.toc", cacheLocation, ( unsigned long long ) hash );
+	return ( length > 0 && ( size_t ) length < sizeof( key->cachePath ) );
+}
+
+/**
+ * Loads the given package from its cached table, if there is one and
+ * it's still valid. Otherwise returns NULL, without reporting an error.
+ */
+PLPackage *_plLoadCachedPackage( const char *path ) {
+	if ( cacheLocation[ 0 ] == '\0' ) {
+		return NULL;
+	}
+
+	PackageCacheKey key;
+	if ( !GetPackageCacheKey( path, &key ) || !plLocalFileExists( key.cachePath ) ) {
+		return NULL;
+	}
+
+	PLFile *cacheFile = plMapLocalFile( key.cachePath );
+	if ( cacheFile == NULL && ( cacheFile = plOpenLocalFile( key.cachePath, true ) ) == NULL ) {
+		return NULL;
+	}
+
+	const uint8_t *data = plGetFileData( cacheFile );
+	size_t length = plGetFileSize( cacheFile );
+
+	const PackageCacheHeader *header = ( const PackageCacheHeader * ) data;
+	if ( length < sizeof( PackageCacheHeader ) ||
+	     memcmp( header->identity, "PTOC", 4 ) != 0 || header->version[ 0 ] != PACKAGE_CACHE_VERSION ||
+	     header->packageSize != key.packageSize || header->modTime != key.modTime ||
+	     header->companionSize != key.companionSize || header->companionModTime != key.companionModTime ||
+	     strncmp( header->path, key.path, sizeof( header->path ) ) != 0 ||
+	     header->numIndexes > ( length - sizeof( PackageCacheHeader ) ) / sizeof( PLPackageIndexHeader ) ||
+	     header->namesLength != length - sizeof( PackageCacheHeader ) - sizeof( PLPackageIndexHeader ) * header->numIndexes ) {
+		plCloseFile( cacheFile );
+		return NULL;
+	}
+
+	/* the table is used straight from the mapping, only the names need keeping */
+	char *names = pl_malloc( header->namesLength );
+	if ( names == NULL ) {
+		plCloseFile( cacheFile );
+		return NULL;
+	}
+
+	const PLPackageIndexHeader *indices = ( const PLPackageIndexHeader * ) ( data + sizeof( PackageCacheHeader ) );
+	memcpy( names, &indices[ header->numIndexes ], header->namesLength );
+
+	PLPackage *package = _plCreatePackageFromTable( path, indices, header->numIndexes, names, header->namesLength, key.packageSize );
+	if ( package == NULL ) {
+		pl_free( names );
+	} else {
+		package->internal.caseInsensitive = ( header->flags & PLPACKAGE_FLAG_CASE_INSENSITIVE );
+	}
+
+	plCloseFile( cacheFile );
+
+	return package;
+}
+
+/**
+ * Stores the table for the given package, if the cache is enabled. Only
+ * packages read by the generic loader can be cached, as there's no way
+ * to restore anything else.
+ */
+void _plCachePackage( const PLPackage *package ) {
+	if ( cacheLocation[ 0 ] == '\0' || package->internal.LoadFile != _plLoadGenericPackageFile ) {
+		return;
+	}
+
+	PackageCacheHeader header = {
+		.identity = { 'P', 'T', 'O', 'C' },
+		.version = { PACKAGE_CACHE_VERSION, 0 },
+		.flags = package->internal.caseInsensitive ? PLPACKAGE_FLAG_CASE_INSENSITIVE : 0,
+		.numIndexes = package->table_size,
+	};
+
+	/* the header is packed, so its members can't be written through pointers */
+	PackageCacheKey key;
+	if ( !GetPackageCacheKey( package->path, &key ) ) {
+		return;
+	}
+
+	header.packageSize = key.packageSize;
+	header.modTime = key.modTime;
+	header.companionSize = key.companionSize;
+	header.companionModTime = key.companionModTime;
+
+	snprintf( header.path, sizeof( header.path ), "%s", key.path );
+
+	/* packages without any names still have the empty one */
+	const char *names = ( package->namePool.names != NULL ) ? package->namePool.names : "";
+	header.namesLength = ( package->namePool.names != NULL ) ? ( uint32_t ) package->namePool.length : 1;
+
+	size_t length = sizeof( PackageCacheHeader ) + sizeof( PLPackageIndexHeader ) * header.numIndexes + header.namesLength;
+	uint8_t *buffer = pl_calloc( 1, length );
+	if ( buffer == NULL ) {
+		return;
+	}
+
+	memcpy( buffer, &header, sizeof( PackageCacheHeader ) );
+
+	PLPackageIndexHeader *indices = ( PLPackageIndexHeader * ) ( buffer + sizeof( PackageCacheHeader ) );
+	for ( unsigned int i = 0; i < header.numIndexes; ++i ) {
+		const PLPackageIndex *index = &package->table[ i ];
+		indices[ i ].offset = index->offset;
+		indices[ i ].fileSize = index->fileSize;
+		indices[ i ].compressedSize = index->compressedSize;
+		indices[ i ].contentHash = index->contentHash;
+		indices[ i ].nameOffset = index->nameOffset;
+		indices[ i ].nameLength = index->nameLength;
+		indices[ i ].nameHash = index->nameHash;
+		indices[ i ].compressionType = ( uint8_t ) index->compressionType;
+	}
+
+	memcpy( &indices[ header.numIndexes ], names, header.namesLength );
+
+	/* written out in full before it replaces anything, so a reader never sees half a table */
+	char tempPath[ PL_SYSTEM_MAX_PATH + 4 ];
+	snprintf( tempPath, sizeof( tempPath ), "%s.tmp", key.cachePath );
+	if ( plWriteFile( tempPath, buffer, length ) ) {
+#if defined( _WIN32 )
+		remove( key.cachePath );
+#endif
+		if ( rename( tempPath, key.cachePath ) != 0 ) {
+			remove( tempPath );
+		}
+	}
+
+	pl_free( buffer );
+}
@@ -0,0 +1,121 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+
+#include "package_private.h"
+
+/* Codecs used to decompress package files, which plugins can add to */
+
+static bool DecompressZlib( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength ) {
+	return _plInflate( Read, source, dest, destLength, true );
+}
+
+static bool DecompressDeflate( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength ) {
+	return _plInflate( Read, source, dest, destLength, false );
+}
+
+static PLDecompressFunction codecs[ PL_MAX_COMPRESSION_FORMATS ] = {
+	[ PL_COMPRESSION_ZLIB ] = DecompressZlib,
+	[ PL_COMPRESSION_DEFLATE ] = DecompressDeflate,
+};
+
+/**
+ * Registers the function used to decompress files of the given type,
+ * replacing any existing one.
+ * @param type Compression type, anything from PL_COMPRESSION_USER on is free for plugins.
+ * @param DecompressFunction Function used to decompress it.
+ * @return True on success.
+ */
+bool plRegisterCompressionCodec( PLCompressionType type, PLDecompressFunction DecompressFunction ) {
+	if ( type == PL_COMPRESSION_NONE || type >= PL_MAX_COMPRESSION_FORMATS ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM1 );
+		return false;
+	}
+
+	codecs[ type ] = DecompressFunction;
+	return true;
+}
+
+typedef struct PackageFileSource {
+	PLFile *filePtr;
+	size_t offset;
+	size_t remaining;
+} PackageFileSource;
+
+static size_t ReadPackageFileSource( void *source, void *dest, size_t length ) {
+	PackageFileSource *fileSource = source;
+	if ( length > fileSource->remaining ) {
+		length = fileSource->remaining;
+	}
+
+	if ( length == 0 ) {
+		return 0;
+	}
+
+	size_t numRead = plReadFileAt( fileSource->filePtr, dest, 1, length, fileSource->offset );
+	fileSource->offset += numRead;
+	fileSource->remaining -= numRead;
+
+	return numRead;
+}
+
+/**
+ * Loads and decompresses the given file, used by the generic loader
+ * for anything that isn't simply stored. The compressed data is read
+ * in as the codec needs it, and decompressed straight into the buffer
+ * that's handed back.
+ */
+uint8_t *_plLoadCompressedPackageFile( PLFile *fh, const PLPackageIndex *pi ) {
+	PLDecompressFunction Decompress = NULL;
+	if ( pi->compressionType < PL_MAX_COMPRESSION_FORMATS ) {
+		Decompress = codecs[ pi->compressionType ];
+	}
+
+	if ( Decompress == NULL ) {
+		ReportError( PL_RESULT_UNSUPPORTED, "unsupported compression type for package file, %d", pi->compressionType );
+		return NULL;
+	}
+
+	uint8_t *dataPtr = pl_malloc( pi->fileSize );
+	if ( dataPtr == NULL ) {
+		return NULL;
+	}
+
+	PackageFileSource source = {
+		.filePtr = fh,
+		.offset = pi->offset,
+		.remaining = pi->compressedSize,
+	};
+
+	if ( !Decompress( ReadPackageFileSource, &source, dataPtr, pi->fileSize ) ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to decompress package file" );
+		pl_free( dataPtr );
+		return NULL;
+	}
+
+	return dataPtr;
+}
@@ -112,12 +112,13 @@ PLPackage *plLoadWADPackage( const char *path ) {
 	/* yay, we're finally done - now to setup the package object */
 
 	PLPackage *package = plCreatePackageHandle( path, numLumps, NULL );
+	/* lump names are matched regardless of case by the engine */
+	package->internal.caseInsensitive = true;
 	for( unsigned int i = 0; i < package->table_size; ++i ) {
 		PLPackageIndex *index = &package->table[ i ];
 		index->offset = indices[ i ].offset;
 		index->fileSize = indices[ i ].size;
-		strncpy( index->fileName, indices[ i ].name, sizeof( indices[ i ].name ) );
-		index->fileName[ 8 ] = '\0';
+		plSetPackageFileName( package, i, indices[ i ].name, sizeof( indices[ i ].name ) );
 	}
 
 	pl_free( indices );
@@ -116,8 +116,7 @@ PLPackage* plLoadMADPackage( const char* path ) {
 			goto FAILED;
 		}
 
-		strncpy( package->table[ i ].fileName, index.file, sizeof( package->table[ i ].fileName ) );
-		package->table[ i ].fileName[ sizeof( index.file ) - 1 ] = '\0';
+		plSetPackageFileName( package, i, index.file, sizeof( index.file ) - 1 );
 		package->table[ i ].fileSize = index.length;
 		package->table[ i ].offset = index.offset;
 	}
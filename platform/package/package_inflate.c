@@ -0,0 +1,487 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+
+#include "package_private.h"
+
+/* Bundled inflate (RFC 1951) with the optional zlib (RFC 1950) wrapper.
+ * Compressed data is pulled in through the given read function as it's
+ * needed, and the output is written straight into the destination,
+ * which also serves as the window for back-references. */
+
+#define INFLATE_BUFFER_SIZE     65536
+#define INFLATE_FAST_BITS       10
+#define INFLATE_MAX_BITS        15
+
+typedef struct InflateHuffman {
+	uint16_t fast[ 1 << INFLATE_FAST_BITS ];    /* ( length << 9 ) | symbol, 0 if the code is any longer */
+	uint16_t count[ INFLATE_MAX_BITS + 1 ];     /* number of codes of each length */
+	uint16_t symbol[ 288 ];                     /* symbols ordered by their code */
+} InflateHuffman;
+
+typedef struct InflateState {
+	PLCompressionReadFunction Read;
+	void *source;
+
+	uint8_t buffer[ INFLATE_BUFFER_SIZE ];
+	size_t bufferPos;
+	size_t bufferLength;
+
+	uint32_t bitBuffer;
+	unsigned int numBits;
+
+	uint8_t *dest;
+	size_t destPos;
+	size_t destLength;
+
+	InflateHuffman lengths;
+	InflateHuffman distances;
+} InflateState;
+
+static const uint16_t lengthBase[ 29 ] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[ 29 ] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distanceBase[ 30 ] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distanceExtra[ 30 ] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/**
+ * Tops up the bit buffer to at least the given number of bits,
+ * returns false if the input ran out first.
+ */
+static bool InflateNeedBits( InflateState *state, unsigned int numBits ) {
+	while ( state->numBits < numBits ) {
+		if ( state->bufferPos == state->bufferLength ) {
+			state->bufferPos = 0;
+			state->bufferLength = state->Read( state->source, state->buffer, INFLATE_BUFFER_SIZE );
+			if ( state->bufferLength == 0 ) {
+				return false;
+			}
+		}
+
+		state->bitBuffer |= ( uint32_t ) state->buffer[ state->bufferPos++ ] << state->numBits;
+		state->numBits += 8;
+	}
+
+	return true;
+}
+
+static bool InflateGetBits( InflateState *state, unsigned int numBits, uint32_t *out ) {
+	if ( !InflateNeedBits( state, numBits ) ) {
+		return false;
+	}
+
+	*out = state->bitBuffer & ( ( 1u << numBits ) - 1 );
+	state->bitBuffer >>= numBits;
+	state->numBits -= numBits;
+	return true;
+}
+
+static uint32_t InflateReverseBits( uint32_t code, unsigned int numBits ) {
+	uint32_t out = 0;
+	for ( unsigned int i = 0; i < numBits; ++i, code >>= 1 ) {
+		out = ( out << 1 ) | ( code & 1 );
+	}
+
+	return out;
+}
+
+static bool InflateBuildHuffman( InflateHuffman *huffman, const uint8_t *lengths, unsigned int numSymbols ) {
+	memset( huffman->count, 0, sizeof( huffman->count ) );
+	memset( huffman->fast, 0, sizeof( huffman->fast ) );
+
+	for ( unsigned int i = 0; i < numSymbols; ++i ) {
+		huffman->count[ lengths[ i ] ]++;
+	}
+	huffman->count[ 0 ] = 0;
+
+	/* incomplete sets are fine, but not over-subscribed ones */
+	int left = 1;
+	for ( unsigned int length = 1; length <= INFLATE_MAX_BITS; ++length ) {
+		left = ( left << 1 ) - huffman->count[ length ];
+		if ( left < 0 ) {
+			return false;
+		}
+	}
+
+	uint16_t offsets[ INFLATE_MAX_BITS + 1 ];
+	offsets[ 1 ] = 0;
+	for ( unsigned int length = 1; length < INFLATE_MAX_BITS; ++length ) {
+		offsets[ length + 1 ] = offsets[ length ] + huffman->count[ length ];
+	}
+
+	for ( unsigned int i = 0; i < numSymbols; ++i ) {
+		if ( lengths[ i ] != 0 ) {
+			huffman->symbol[ offsets[ lengths[ i ] ]++ ] = ( uint16_t ) i;
+		}
+	}
+
+	/* codes are stored most-significant bit first, so reverse them to index the fast table */
+	uint32_t code = 0;
+	unsigned int index = 0;
+	for ( unsigned int length = 1; length <= INFLATE_FAST_BITS; ++length ) {
+		for ( unsigned int i = 0; i < huffman->count[ length ]; ++i, ++code ) {
+			uint16_t entry = ( uint16_t ) ( ( length << 9 ) | huffman->symbol[ index + i ] );
+			for ( uint32_t j = InflateReverseBits( code, length ); j < ( 1u << INFLATE_FAST_BITS ); j += ( 1u << length ) ) {
+				huffman->fast[ j ] = entry;
+			}
+		}
+
+		index += huffman->count[ length ];
+		code <<= 1;
+	}
+
+	return true;
+}
+
+/**
+ * Returns the next symbol, or -1 on failure.
+ */
+static int InflateDecodeSymbol( InflateState *state, const InflateHuffman *huffman ) {
+	/* this may well come up short near the end of the input, which is fine */
+	InflateNeedBits( state, INFLATE_MAX_BITS );
+
+	uint16_t entry = huffman->fast[ state->bitBuffer & ( ( 1u << INFLATE_FAST_BITS ) - 1 ) ];
+	if ( entry != 0 ) {
+		unsigned int length = entry >> 9;
+		if ( length > state->numBits ) {
+			return -1;
+		}
+
+		state->bitBuffer >>= length;
+		state->numBits -= length;
+		return entry & 511;
+	}
+
+	/* otherwise it's a longer code, so walk it a bit at a time */
+	int code = 0, first = 0, index = 0;
+	for ( unsigned int length = 1; length <= INFLATE_MAX_BITS && state->numBits > 0; ++length ) {
+		code |= ( int ) ( state->bitBuffer & 1 );
+		state->bitBuffer >>= 1;
+		state->numBits--;
+
+		int count = huffman->count[ length ];
+		if ( code - count < first ) {
+			return huffman->symbol[ index + ( code - first ) ];
+		}
+
+		index += count;
+		first = ( first + count ) << 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+static bool InflateCodes( InflateState *state ) {
+	for ( ;; ) {
+		int symbol = InflateDecodeSymbol( state, &state->lengths );
+		if ( symbol < 0 ) {
+			return false;
+		} else if ( symbol < 256 ) {
+			if ( state->destPos == state->destLength ) {
+				return false;
+			}
+
+			state->dest[ state->destPos++ ] = ( uint8_t ) symbol;
+			continue;
+		} else if ( symbol == 256 ) {
+			return true;
+		}
+
+		symbol -= 257;
+		if ( symbol >= 29 ) {
+			return false;
+		}
+
+		uint32_t extra;
+		if ( !InflateGetBits( state, lengthExtra[ symbol ], &extra ) ) {
+			return false;
+		}
+		size_t length = lengthBase[ symbol ] + extra;
+
+		symbol = InflateDecodeSymbol( state, &state->distances );
+		if ( symbol < 0 || symbol >= 30 || !InflateGetBits( state, distanceExtra[ symbol ], &extra ) ) {
+			return false;
+		}
+		size_t distance = distanceBase[ symbol ] + extra;
+
+		if ( distance > state->destPos || length > state->destLength - state->destPos ) {
+			return false;
+		}
+
+		/* may overlap with itself, so this has to go forwards a byte at a time */
+		uint8_t *out = &state->dest[ state->destPos ];
+		const uint8_t *in = out - distance;
+		for ( size_t i = 0; i < length; ++i ) {
+			out[ i ] = in[ i ];
+		}
+		state->destPos += length;
+	}
+}
+
+static bool InflateStored( InflateState *state ) {
+	/* skip to the next byte boundary */
+	state->bitBuffer >>= ( state->numBits & 7 );
+	state->numBits -= ( state->numBits & 7 );
+
+	uint32_t length, check;
+	if ( !InflateGetBits( state, 16, &length ) || !InflateGetBits( state, 16, &check ) || length != ( ~check & 0xffff ) ) {
+		return false;
+	}
+
+	if ( length > state->destLength - state->destPos ) {
+		return false;
+	}
+
+	/* anything left in the bit buffer comes first, then what's been buffered */
+	while ( length > 0 && state->numBits >= 8 ) {
+		state->dest[ state->destPos++ ] = ( uint8_t ) state->bitBuffer;
+		state->bitBuffer >>= 8;
+		state->numBits -= 8;
+		length--;
+	}
+
+	size_t numBuffered = state->bufferLength - state->bufferPos;
+	if ( numBuffered > length ) {
+		numBuffered = length;
+	}
+	memcpy( &state->dest[ state->destPos ], &state->buffer[ state->bufferPos ], numBuffered );
+	state->bufferPos += numBuffered;
+	state->destPos += numBuffered;
+	length -= numBuffered;
+
+	/* and the rest can be read straight into place */
+	while ( length > 0 ) {
+		size_t numRead = state->Read( state->source, &state->dest[ state->destPos ], length );
+		if ( numRead == 0 ) {
+			return false;
+		}
+
+		state->destPos += numRead;
+		length -= ( uint32_t ) numRead;
+	}
+
+	return true;
+}
+
+static bool InflateFixed( InflateState *state ) {
+	uint8_t lengths[ 288 ];
+	memset( &lengths[ 0 ], 8, 144 );
+	memset( &lengths[ 144 ], 9, 112 );
+	memset( &lengths[ 256 ], 7, 24 );
+	memset( &lengths[ 280 ], 8, 8 );
+	InflateBuildHuffman( &state->lengths, lengths, 288 );
+
+	memset( lengths, 5, 30 );
+	InflateBuildHuffman( &state->distances, lengths, 30 );
+
+	return InflateCodes( state );
+}
+
+static bool InflateDynamic( InflateState *state ) {
+	static const uint8_t order[ 19 ] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	uint32_t numLengths, numDistances, numCodes;
+	if ( !InflateGetBits( state, 5, &numLengths ) || !InflateGetBits( state, 5, &numDistances ) || !InflateGetBits( state, 4, &numCodes ) ) {
+		return false;
+	}
+
+	numLengths += 257;
+	numDistances += 1;
+	numCodes += 4;
+	if ( numLengths > 286 || numDistances > 30 ) {
+		return false;
+	}
+
+	/* the code lengths are themselves huffman coded */
+	uint8_t lengths[ 286 + 30 ] = { 0 };
+	for ( unsigned int i = 0; i < numCodes; ++i ) {
+		uint32_t length;
+		if ( !InflateGetBits( state, 3, &length ) ) {
+			return false;
+		}
+		lengths[ order[ i ] ] = ( uint8_t ) length;
+	}
+
+	if ( !InflateBuildHuffman( &state->lengths, lengths, 19 ) ) {
+		return false;
+	}
+
+	for ( unsigned int index = 0; index < numLengths + numDistances; ) {
+		int symbol = InflateDecodeSymbol( state, &state->lengths );
+		if ( symbol < 0 ) {
+			return false;
+		} else if ( symbol < 16 ) {
+			lengths[ index++ ] = ( uint8_t ) symbol;
+			continue;
+		}
+
+		uint8_t value = 0;
+		uint32_t repeat;
+		if ( symbol == 16 ) {
+			if ( index == 0 || !InflateGetBits( state, 2, &repeat ) ) {
+				return false;
+			}
+			value = lengths[ index - 1 ];
+			repeat += 3;
+		} else if ( symbol == 17 ) {
+			if ( !InflateGetBits( state, 3, &repeat ) ) {
+				return false;
+			}
+			repeat += 3;
+		} else {
+			if ( !InflateGetBits( state, 7, &repeat ) ) {
+				return false;
+			}
+			repeat += 11;
+		}
+
+		if ( index + repeat > numLengths + numDistances ) {
+			return false;
+		}
+
+		while ( repeat-- > 0 ) {
+			lengths[ index++ ] = value;
+		}
+	}
+
+	/* no end of block code, no way of finishing */
+	if ( lengths[ 256 ] == 0 ) {
+		return false;
+	}
+
+	if ( !InflateBuildHuffman( &state->lengths, lengths, numLengths ) ||
+	     !InflateBuildHuffman( &state->distances, &lengths[ numLengths ], numDistances ) ) {
+		return false;
+	}
+
+	return InflateCodes( state );
+}
+
+static uint32_t InflateAdler32( const uint8_t *data, size_t length ) {
+	uint32_t a = 1, b = 0;
+	while ( length > 0 ) {
+		/* largest run that can't overflow before taking the modulo */
+		size_t runLength = ( length > 5552 ) ? 5552 : length;
+		length -= runLength;
+		while ( runLength-- > 0 ) {
+			a += *data++;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return ( b << 16 ) | a;
+}
+
+/**
+ * Decompresses a deflate stream, optionally wrapped in a zlib header and
+ * checksum, into the given buffer, which must be exactly the size of the
+ * decompressed data.
+ * @param Read Function used to pull in the compressed data.
+ * @param source Passed through to the read function.
+ * @param dest Buffer to decompress into.
+ * @param destLength Size of the decompressed data.
+ * @param isZlibStream Whether or not the stream has the zlib wrapper.
+ * @return True on success.
+ */
+bool _plInflate( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength, bool isZlibStream ) {
+	InflateState *state = pl_malloc( sizeof( InflateState ) );
+	if ( state == NULL ) {
+		return false;
+	}
+
+	state->Read = Read;
+	state->source = source;
+	state->bufferPos = state->bufferLength = 0;
+	state->bitBuffer = 0;
+	state->numBits = 0;
+	state->dest = dest;
+	state->destPos = 0;
+	state->destLength = destLength;
+
+	bool result = true;
+	if ( isZlibStream ) {
+		uint32_t method, flags;
+		if ( !InflateGetBits( state, 8, &method ) || !InflateGetBits( state, 8, &flags ) ||
+		     ( method & 15 ) != 8 || ( method >> 4 ) > 7 || ( ( method << 8 ) | flags ) % 31 != 0 ||
+		     ( flags & 32 ) ) {
+			ReportError( PL_RESULT_FILETYPE, "invalid zlib header" );
+			result = false;
+		}
+	}
+
+	uint32_t isFinal = 0;
+	while ( result && !isFinal ) {
+		uint32_t type;
+		if ( !InflateGetBits( state, 1, &isFinal ) || !InflateGetBits( state, 2, &type ) ) {
+			result = false;
+		} else if ( type == 0 ) {
+			result = InflateStored( state );
+		} else if ( type == 1 ) {
+			result = InflateFixed( state );
+		} else if ( type == 2 ) {
+			result = InflateDynamic( state );
+		} else {
+			result = false;
+		}
+	}
+
+	if ( result && state->destPos != state->destLength ) {
+		result = false;
+	}
+
+	/* the checksum follows on the next byte boundary, most-significant byte first */
+	if ( result && isZlibStream ) {
+		state->bitBuffer >>= ( state->numBits & 7 );
+		state->numBits -= ( state->numBits & 7 );
+
+		uint32_t checksum = 0;
+		for ( unsigned int i = 0; i < 4; ++i ) {
+			uint32_t byte;
+			if ( !InflateGetBits( state, 8, &byte ) ) {
+				result = false;
+				break;
+			}
+			checksum = ( checksum << 8 ) | byte;
+		}
+
+		if ( result && checksum != InflateAdler32( dest, destLength ) ) {
+			ReportError( PL_RESULT_FILEREAD, "zlib checksum mismatch" );
+			result = false;
+		}
+	}
+
+	pl_free( state );
+
+	return result;
+}
@@ -0,0 +1,403 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+
+#include "package_private.h"
+#include "filesystem_private.h"
+
+/* native baked package format, see PLPackageHeader */
+
+/* implemented by the bundled stb libraries */
+unsigned char *stbi_zlib_compress( unsigned char *data, int data_len, int *out_len, int quality );
+
+/**
+ * Creates a package from a table in our own format, as used by both baked
+ * packages and cached tables. The name pool is taken over by the package
+ * on success.
+ * @param path Path to the package the table belongs to.
+ * @param indices The table, in the order it should appear in the package.
+ * @param numIndexes Number of entries in the table.
+ * @param names Name pool the table refers to.
+ * @param namesLength Size of the name pool, including the terminator.
+ * @param packageSize Size of the package, for validating the table.
+ * @return The new package, or NULL if the table was invalid.
+ */
+PLPackage *_plCreatePackageFromTable( const char *path, const PLPackageIndexHeader *indices, unsigned int numIndexes, char *names, size_t namesLength, size_t packageSize ) {
+	if( namesLength == 0 || names[ namesLength - 1 ] != '\0' ) {
+		ReportError( PL_RESULT_INVALID_PARM1, "invalid name pool" );
+		return NULL;
+	}
+
+	PLPackage *package = plCreatePackageHandle( path, numIndexes, NULL );
+	package->internal.isSorted = true;
+	for( unsigned int i = 0; i < package->table_size; ++i ) {
+		const PLPackageIndexHeader *in = &indices[ i ];
+		if( in->nameOffset >= namesLength || in->nameLength >= namesLength - in->nameOffset ||
+			names[ in->nameOffset + in->nameLength ] != '\0' ||
+			in->offset > packageSize || in->compressedSize > packageSize - in->offset ||
+			in->compressionType >= PL_MAX_COMPRESSION_FORMATS ) {
+			ReportError( PL_RESULT_INVALID_PARM1, "invalid table entry for index %d", i );
+			plDestroyPackage( package );
+			return NULL;
+		}
+
+		/* only binary search the table if it's in order */
+		if( i > 0 && in->nameHash < indices[ i - 1 ].nameHash ) {
+			package->internal.isSorted = false;
+		}
+
+		PLPackageIndex *index = &package->table[ i ];
+		index->offset = in->offset;
+		index->fileSize = in->fileSize;
+		index->compressedSize = in->compressedSize;
+		index->compressionType = in->compressionType;
+		index->contentHash = in->contentHash;
+		index->nameOffset = in->nameOffset;
+		index->nameLength = in->nameLength;
+		index->nameHash = in->nameHash;
+	}
+
+	package->namePool.names = names;
+	package->namePool.length = package->namePool.maxLength = namesLength;
+
+	return package;
+}
+
+PLPackage *plLoadPACKPackage( const char *path ) {
+	FunctionStart();
+
+	/* this is handed over as the package's handle, so map it where we can */
+	PLFile *filePtr = plMapFile( path );
+	if( filePtr == NULL && ( filePtr = plOpenFile( path, false ) ) == NULL ) {
+		return NULL;
+	}
+
+	PLPackageHeader header;
+	if( plReadFileAt( filePtr, &header, sizeof( header ), 1, 0 ) != 1 ) {
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	if( !(
+		header.identity[ 0 ] == 'P' &&
+		header.identity[ 1 ] == 'A' &&
+		header.identity[ 2 ] == 'C' &&
+		header.identity[ 3 ] == 'K' ) ) {
+		ReportError( PL_RESULT_FILETYPE, "invalid pack header" );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	if( header.version[ 0 ] != PLPACKAGE_VERSION_MAJOR ) {
+		ReportError( PL_RESULT_FILEVERSION, "unsupported pack version, %d.%d", header.version[ 0 ], header.version[ 1 ] );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	size_t fileSize = plGetFileSize( filePtr );
+	if( header.tocOffset > fileSize || header.numIndexes > ( fileSize - header.tocOffset ) / sizeof( PLPackageIndexHeader ) ||
+		header.namesOffset > fileSize || header.namesLength == 0 || header.namesLength > fileSize - header.namesOffset ) {
+		ReportError( PL_RESULT_INVALID_PARM1, "invalid table offset" );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	/* the table and names are each read in one go, and the table
+	 * is then converted over to the package's own index */
+
+	PLPackageIndexHeader *indices = pl_malloc( sizeof( PLPackageIndexHeader ) * header.numIndexes + 1 );
+	char *names = pl_malloc( header.namesLength );
+	if( indices == NULL || names == NULL ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "failed to allocate pack table" );
+		pl_free( names );
+		pl_free( indices );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	if( plReadFileAt( filePtr, indices, sizeof( PLPackageIndexHeader ), header.numIndexes, header.tocOffset ) != header.numIndexes ||
+		plReadFileAt( filePtr, names, header.namesLength, 1, header.namesOffset ) != 1 ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to read pack table" );
+		pl_free( names );
+		pl_free( indices );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	/* each entry's offset and compressed size are checked against the
+	 * package below, but stored files are read by their file size, and
+	 * compressed ones have that much allocated for them up front */
+	for( unsigned int i = 0; i < header.numIndexes; ++i ) {
+		if( ( indices[ i ].compressionType == PL_COMPRESSION_NONE && indices[ i ].fileSize != indices[ i ].compressedSize ) ||
+			( indices[ i ].compressionType == PL_COMPRESSION_ZLIB && indices[ i ].fileSize / PLPACKAGE_MAX_ZLIB_RATIO > indices[ i ].compressedSize ) ) {
+			ReportError( PL_RESULT_INVALID_PARM1, "invalid size for stored index %d", i );
+			pl_free( names );
+			pl_free( indices );
+			plCloseFile( filePtr );
+			return NULL;
+		}
+	}
+
+	PLPackage *package = _plCreatePackageFromTable( path, indices, header.numIndexes, names, header.namesLength, fileSize );
+	pl_free( indices );
+	if( package == NULL ) {
+		pl_free( names );
+		plCloseFile( filePtr );
+		return NULL;
+	}
+
+	package->internal.caseInsensitive = ( header.flags & PLPACKAGE_FLAG_CASE_INSENSITIVE );
+	package->internal.filePtr = filePtr;
+
+	return package;
+}
+
+/**
+ * FNV-1a of the given data, stored with each file so its contents can
+ * be verified or compared without reading them.
+ */
+static uint64_t HashPackFileData( const uint8_t *data, size_t length ) {
+	uint64_t hash = 14695981039346656037ULL;
+	for( size_t i = 0; i < length; ++i ) {
+		hash ^= data[ i ];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+typedef struct PackSortKey {
+	uint32_t nameHash;
+	unsigned int index;
+} PackSortKey;
+
+static int ComparePackSortKeys( const void *a, const void *b ) {
+	const PackSortKey *ka = a, *kb = b;
+	if( ka->nameHash != kb->nameHash ) {
+		return ( ka->nameHash < kb->nameHash ) ? -1 : 1;
+	}
+
+	/* duplicate names stay in order, so the first still wins */
+	return ( ka->index < kb->index ) ? -1 : ( ka->index > kb->index );
+}
+
+typedef struct PackWriter {
+	FILE *fp;
+	size_t offset;                  /* current end of the file */
+	PLPackageIndexHeader *indices;
+	unsigned int *slots;            /* where each file in the source ends up in the table */
+	PLCompressionType compressionType;
+	bool result;
+} PackWriter;
+
+static bool WritePackPadding( PackWriter *writer, size_t alignment ) {
+	static const uint8_t padding[ PLPACKAGE_ALIGNMENT ] = { 0 };
+
+	size_t length = ( alignment - ( writer->offset % alignment ) ) % alignment;
+	if( length > 0 && fwrite( padding, 1, length, writer->fp ) != length ) {
+		return false;
+	}
+
+	writer->offset += length;
+	return true;
+}
+
+static void WritePackFile( PLFile *file, unsigned int index, void *userData ) {
+	PackWriter *writer = userData;
+	if( file == NULL || !writer->result ) {
+		writer->result = false;
+		plCloseFile( file );
+		return;
+	}
+
+	const uint8_t *data = plGetFileData( file );
+	size_t length = plGetFileSize( file );
+
+	PLPackageIndexHeader *out = &writer->indices[ writer->slots[ index ] ];
+	out->fileSize = length;
+	out->compressedSize = length;
+	out->contentHash = HashPackFileData( data, length );
+	out->compressionType = PL_COMPRESSION_NONE;
+
+	uint8_t *compressed = NULL;
+	if( writer->compressionType == PL_COMPRESSION_ZLIB && length > 0 && length <= INT_MAX ) {
+		int compressedLength;
+		compressed = stbi_zlib_compress( ( unsigned char * ) data, ( int ) length, &compressedLength, 8 );
+		/* only worth keeping if it actually saved something */
+		if( compressed != NULL && ( size_t ) compressedLength < length ) {
+			data = compressed;
+			out->compressedSize = ( uint64_t ) compressedLength;
+			out->compressionType = PL_COMPRESSION_ZLIB;
+		}
+	}
+
+	/* larger files get their own pages, so they can be mapped or read directly */
+	if( !WritePackPadding( writer, ( out->compressedSize >= PLPACKAGE_ALIGNMENT ) ? PLPACKAGE_ALIGNMENT : PLPACKAGE_MIN_ALIGNMENT ) ||
+		fwrite( data, 1, out->compressedSize, writer->fp ) != out->compressedSize ) {
+		ReportError( PL_RESULT_FILEWRITE, "failed to write \"%s\"", plGetFilePath( file ) );
+		writer->result = false;
+	} else {
+		out->offset = writer->offset;
+		writer->offset += out->compressedSize;
+	}
+
+	free( compressed );
+	plCloseFile( file );
+}
+
+/**
+ * Writes the given package out in our own baked format, which is
+ * quick to load and lets larger files be read without a copy.
+ * @param package Package to write out.
+ * @param path Local path to write the new package to.
+ * @param compressionType Compression to use for files that benefit from it.
+ * @return True on success.
+ */
+bool plWritePackage( PLPackage *package, const char *path, PLCompressionType compressionType ) {
+	FunctionStart();
+
+	/* the source is still being read from while writing, so compare
+	 * what's on disk rather than trusting the paths to be spelt the same */
+	const char *sourcePath = ( package->internal.filePtr != NULL ) ? plGetFilePath( package->internal.filePtr ) : package->path;
+	if( _plIsSameLocalFile( sourcePath, path ) ) {
+		ReportError( PL_RESULT_INVALID_PARM2, "can't write a package over itself" );
+		return false;
+	}
+
+	if( compressionType != PL_COMPRESSION_NONE && compressionType != PL_COMPRESSION_ZLIB ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM3 );
+		return false;
+	}
+
+	unsigned int numIndexes = package->table_size;
+
+	PackSortKey *keys = pl_malloc( sizeof( PackSortKey ) * numIndexes + 1 );
+	unsigned int *order = pl_malloc( sizeof( unsigned int ) * numIndexes + 1 );
+	PackWriter writer = {
+		.indices = pl_calloc( numIndexes + 1, sizeof( PLPackageIndexHeader ) ),
+		.slots = pl_malloc( sizeof( unsigned int ) * numIndexes + 1 ),
+		.compressionType = compressionType,
+		.result = true,
+	};
+
+	char *names = NULL;
+	if( keys == NULL || order == NULL || writer.indices == NULL || writer.slots == NULL ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "failed to allocate pack table" );
+		writer.result = false;
+		goto CLEANUP;
+	}
+
+	/* the table is ordered by name hash, so lookups can binary search it */
+	for( unsigned int i = 0; i < numIndexes; ++i ) {
+		keys[ i ].nameHash = package->table[ i ].nameHash;
+		keys[ i ].index = i;
+		order[ i ] = i;
+	}
+
+	qsort( keys, numIndexes, sizeof( PackSortKey ), ComparePackSortKeys );
+
+	size_t namesLength = 1;
+	for( unsigned int i = 0; i < numIndexes; ++i ) {
+		writer.slots[ keys[ i ].index ] = i;
+		namesLength += package->table[ keys[ i ].index ].nameLength + 1;
+	}
+
+	if( ( names = pl_malloc( namesLength ) ) == NULL ) {
+		ReportError( PL_RESULT_MEMORY_ALLOCATION, "failed to allocate pack names" );
+		writer.result = false;
+		goto CLEANUP;
+	}
+
+	names[ 0 ] = '\0';
+	size_t nameOffset = 1;
+	for( unsigned int i = 0; i < numIndexes; ++i ) {
+		const PLPackageIndex *index = &package->table[ keys[ i ].index ];
+		memcpy( &names[ nameOffset ], plGetPackageFileName( package, keys[ i ].index ), index->nameLength + 1 );
+
+		writer.indices[ i ].nameOffset = ( uint32_t ) nameOffset;
+		writer.indices[ i ].nameLength = index->nameLength;
+		writer.indices[ i ].nameHash = index->nameHash;
+		nameOffset += index->nameLength + 1;
+	}
+
+	PLPackageHeader header = {
+		.identity = { 'P', 'A', 'C', 'K' },
+		.version = { PLPACKAGE_VERSION_MAJOR, PLPACKAGE_VERSION_MINOR },
+		.flags = package->internal.caseInsensitive ? PLPACKAGE_FLAG_CASE_INSENSITIVE : 0,
+		.numIndexes = numIndexes,
+		.namesLength = ( uint32_t ) namesLength,
+		.tocOffset = sizeof( PLPackageHeader ),
+		.namesOffset = sizeof( PLPackageHeader ) + sizeof( PLPackageIndexHeader ) * numIndexes,
+	};
+
+	writer.fp = fopen( path, "wb" );
+	if( writer.fp == NULL ) {
+		ReportError( PL_RESULT_FILEWRITE, "failed to open %s for write", path );
+		writer.result = false;
+	} else {
+		_plInvalidateFileSystemIndexPath( path );
+		_plPurgeFileCache( NULL, path );
+
+		/* the table is written again once the file offsets are known */
+		if( fwrite( &header, sizeof( header ), 1, writer.fp ) != 1 ||
+			fwrite( writer.indices, sizeof( PLPackageIndexHeader ), numIndexes, writer.fp ) != numIndexes ||
+			fwrite( names, 1, namesLength, writer.fp ) != namesLength ) {
+			ReportError( PL_RESULT_FILEWRITE, "failed to write pack table" );
+			writer.result = false;
+		}
+
+		writer.offset = header.namesOffset + namesLength;
+
+		/* read through the source in order, rather than seeking around for each file */
+		if( writer.result && !plLoadPackageFiles( package, order, numIndexes, WritePackFile, &writer ) ) {
+			writer.result = false;
+		}
+
+		if( writer.result && (
+			fseek( writer.fp, ( long ) header.tocOffset, SEEK_SET ) != 0 ||
+			fwrite( writer.indices, sizeof( PLPackageIndexHeader ), numIndexes, writer.fp ) != numIndexes ) ) {
+			ReportError( PL_RESULT_FILEWRITE, "failed to write pack table" );
+			writer.result = false;
+		}
+
+		_pl_fclose( writer.fp );
+
+		/* don't leave a broken package lying around */
+		if( !writer.result ) {
+			remove( path );
+		}
+	}
+
+	CLEANUP:
+	pl_free( names );
+	pl_free( writer.slots );
+	pl_free( writer.indices );
+	pl_free( order );
+	pl_free( keys );
+
+	return writer.result;
+}
@@ -31,7 +31,9 @@ For more information, please refer to <http://unlicense.org>
 #include <PL/platform_filesystem.h>
 #include <PL/platform_package.h>
 
-#define PLPACKAGE_VERSION_MAJOR     1
+#include <limits.h>
+
+#define PLPACKAGE_VERSION_MAJOR     2
 #define PLPACKAGE_VERSION_MINOR     0
 
 enum {
@@ -58,43 +60,42 @@ enum {
 	PLPACKAGE_LAST_INDEX
 };
 
-typedef struct PLPackageHeader { // (PACKAGE)
-	uint8_t identity[4];    // Descriptor/name of the data type. "PACK"
-	uint8_t version[2];     // Version of this type.
-
-	uint32_t num_indexes;    // Number of data indexes (each _should_ be a fixed size?)
+/* native baked package format, which everything else can be converted into
+ * the header is followed directly by the TOC, and then the name pool */
 
-	// followed by num_indexes + length
-	// then followed by rest of data
-} PLPackageHeader;
+#define PLPACKAGE_ALIGNMENT         4096    /* files at least this big start on a page boundary */
+#define PLPACKAGE_MIN_ALIGNMENT     16      /* and anything else on this */
+#define PLPACKAGE_MAX_ZLIB_RATIO    1032    /* deflate can't expand anything by more than this */
 
-typedef struct PLPackageIndexHeader {
-	uint16_t type;
-	uint32_t length;
+enum {
+	PL_BITFLAG( PLPACKAGE_FLAG_CASE_INSENSITIVE, 0 ),
+};
 
-	// followed by type-specific index information
-} PLPackageIndexHeader;
+PL_PACKED_STRUCT_START( PLPackageHeader )
+	uint8_t identity[ 4 ];  /* "PACK" */
+	uint8_t version[ 2 ];
+	uint16_t flags;
+	uint32_t numIndexes;
+	uint32_t namesLength;   /* the pool always starts with an empty name */
+	uint64_t tocOffset;
+	uint64_t namesOffset;
+PL_PACKED_STRUCT_END( PLPackageHeader )
+
+/* sorted by name hash, so lookups can be done on the table as-is */
+PL_PACKED_STRUCT_START( PLPackageIndexHeader )
+	uint64_t offset;
+	uint64_t fileSize;
+	uint64_t compressedSize;
+	uint64_t contentHash;   /* FNV-1a of the uncompressed contents */
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t nameHash;      /* same case-folded hash used by PLPackageIndex */
+	uint8_t compressionType;
+	uint8_t reserved[ 3 ];
+PL_PACKED_STRUCT_END( PLPackageIndexHeader )
 
 PL_EXTERN_C
 
-PL_INLINE static void WritePackageHeader( FILE* handle, uint32_t num_indexes ) {
-	plAssert( handle );
-	uint8_t identity[4] = { 'P', 'A', 'C', 'K' };
-	fwrite( identity, sizeof( char ), sizeof( identity ), handle );
-	uint8_t version[2] = {
-		PLPACKAGE_VERSION_MAJOR,
-		PLPACKAGE_VERSION_MINOR
-	};
-	fwrite( version, sizeof( uint8_t ), sizeof( version ), handle );
-	fwrite( &num_indexes, sizeof( uint32_t ), 1, handle );
-}
-
-PL_INLINE static void WritePackageIndexHeader( FILE* handle, uint16_t type, uint32_t length ) {
-	plAssert( handle );
-	fwrite( &type, sizeof( uint16_t ), 1, handle );
-	fwrite( &length, sizeof( uint32_t ), 1, handle );
-}
-
 /////////////////////////////////////////////////////////////////
 
 PLPackage *plLoadMADPackage( const char *path );
@@ -106,21 +107,21 @@ PLPackage *plLoadFFPackage( const char *path );
 PLPackage *plLoadWADPackage( const char *path );
 PLPackage *plLoadRIDBPackage( const char *path );
 PLPackage *plLoadAPUKPackage( const char *path );
+PLPackage *plLoadPACKPackage( const char *path );
+
+uint32_t _plHashPackageFileName( const char *name, size_t length );
+PLPackage *_plCreatePackageFromTable( const char *path, const PLPackageIndexHeader *indices, unsigned int numIndexes, char *names, size_t namesLength, size_t packageSize );
+
+PLPackage *_plLoadCachedPackage( const char *path );
+void _plCachePackage( const PLPackage *package );
+uint8_t *_plLoadCompressedPackageFile( PLFile *fh, const PLPackageIndex *pi );
+bool _plInflate( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength, bool isZlibStream );
 
 /**
  * Generic loader for package files, since this is unlikely to change
- * in most cases.
+ * in most cases. Reads are positioned, so this is safe to call on the
+ * same handle from multiple threads.
  */
-PL_INLINE static uint8_t *_plLoadGenericPackageFile( PLFile *fh, PLPackageIndex *pi ) {
-	FunctionStart();
-
-	uint8_t *dataPtr = pl_malloc( pi->fileSize );
-	if( !plFileSeek( fh, (signed)pi->offset, PL_SEEK_SET ) || plReadFile( fh, dataPtr, pi->fileSize, 1 ) != 1 ) {
-		pl_free( dataPtr );
-		return NULL;
-	}
-
-	return dataPtr;
-}
+uint8_t *_plLoadGenericPackageFile( PLFile *fh, PLPackageIndex *pi );
 
 PL_EXTERN_C_END
@@ -82,7 +82,9 @@ PLPackage* plLoadTABPackage( const char* path ) {
 	PLPackage* package = plCreatePackageHandle( path, num_indices, NULL );
 	for ( unsigned int i = 0; i < num_indices; ++i ) {
 		PLPackageIndex* index = &package->table[ i ];
-		snprintf( index->fileName, sizeof( index->fileName ), "%u", i );
+		char fileName[ 16 ];
+		snprintf( fileName, sizeof( fileName ), "%u", i );
+		plSetPackageFileName( package, i, fileName, sizeof( fileName ) );
 		index->fileSize = indices[ i ].end - indices[ i ].start;
 		index->offset = indices[ i ].start;
 	}
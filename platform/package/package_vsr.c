@@ -135,7 +135,7 @@ PLPackage* plLoadVSRPackage( const char* path ) {
 		PLPackageIndex* index = &package->table[ i ];
 		index->offset = directories[ i ].offset;
 		index->fileSize = directories[ i ].length;
-		strncpy( index->fileName, strings[ i ].file_name, sizeof( index->fileName ) );
+		plSetPackageFileName( package, i, strings[ i ].file_name, sizeof( strings[ i ].file_name ) );
 	}
 
 	pl_free( directories );
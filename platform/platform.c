@@ -527,6 +527,9 @@ static PLPluginExportTable exportTable = {
         .ReadInt16 = plReadInt16,
         .ReadInt32 = plReadInt32,
         .ReadInt64 = plReadInt64,
+        .ReadInt16Array = plReadInt16Array,
+        .ReadInt32Array = plReadInt32Array,
+        .ReadFloatArray = plReadFloatArray,
         .ReadString = plReadString,
         .FileSeek = plFileSeek,
         .RewindFile = plRewindFile,
@@ -534,6 +537,14 @@ static PLPluginExportTable exportTable = {
         .RegisterPackageLoader = plRegisterPackageLoader,
         .RegisterModelLoader = plRegisterModelLoader,
         .RegisterImageLoader = plRegisterImageLoader,
+        .RegisterImageProbe = plRegisterImageProbe,
+        .RegisterCompressionCodec = plRegisterCompressionCodec,
+
+        .GetPackagePath = plGetPackagePath,
+        .GetPackageTableSize = plGetPackageTableSize,
+        .GetPackageTableIndex = plGetPackageTableIndex,
+        .GetPackageFileName = plGetPackageFileName,
+        .SetPackageFileName = plSetPackageFileName,
 
         .CreateMesh = plCreateMesh,
         .DestroyMesh = plDestroyMesh,
@@ -38,6 +38,7 @@ For more information, please refer to <http://unlicense.org>
 
 #include "filesystem_private.h"
 #include "platform_private.h"
+#include "thread_private.h"
 
 #if defined( _WIN32 )
 #   include "3rdparty/portable_endian.h"
@@ -47,6 +48,7 @@ For more information, please refer to <http://unlicense.org>
 #   include <security.h>
 #   include <shlobj.h>
 #	include <direct.h>
+#	include <io.h>
 
 #	if defined( _MSC_VER )
 #		if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
@@ -58,6 +60,12 @@ For more information, please refer to <http://unlicense.org>
 #       include "3rdparty/portable_endian.h"
 #   endif
 #   include <pwd.h>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   if defined( __linux__ )
+#       include <sys/sendfile.h>
+#       include <sys/syscall.h>
+#   endif
 #endif
 
 /*	File System	*/
@@ -72,10 +80,32 @@ typedef enum FSMountType {
 	FS_MOUNT_PACKAGE,
 } FSMountType;
 
+#define FS_PACKAGE_NODE_NONE    ( ( unsigned int ) -1 )
+
+/* directory within a mounted package, as implied by the names in its table */
+typedef struct FSPackageNode {
+	size_t nameOffset;          /* into the package's name pool, not terminated */
+	unsigned int nameLength;
+	unsigned int parent;
+	unsigned int firstChild;
+	unsigned int nextSibling;
+	unsigned int firstFile;     /* package table index, chained through FSPackageTree.nextFile */
+} FSPackageNode;
+
+typedef struct FSPackageTree {
+	FSPackageNode* nodes;       /* the first is always the root */
+	unsigned int numNodes;
+	unsigned int maxNodes;
+	unsigned int* nextFile;     /* per table index, next file in the same directory */
+} FSPackageTree;
+
 typedef struct PLFileSystemMount {
 	FSMountType type;
 	union {
-		PLPackage* pkg;                        /* FS_MOUNT_PACKAGE */
+		struct {                         /* FS_MOUNT_PACKAGE */
+			PLPackage* pkg;
+			FSPackageTree tree;
+		};
 		char path[PL_SYSTEM_MAX_PATH];   /* FS_MOUNT_DIR */
 	};
 	struct PLFileSystemMount* next, * prev;
@@ -83,7 +113,605 @@ typedef struct PLFileSystemMount {
 static PLFileSystemMount* fs_mount_root = NULL;
 static PLFileSystemMount* fs_mount_ceiling = NULL;
 
-#define FS_LOCAL_HINT    "local://"
+
+#if !defined( _MSC_VER )
+/**
+ * Works out what the given directory entry is, trusting d_type where the
+ * filesystem fills it in and only falling back to a stat when it doesn't.
+ * The full path is only used on platforms without fstatat.
+ */
+FSEntryType _plGetDirectoryEntryType( DIR* directory, const struct dirent* entry, const char* path ) {
+#	if defined( DT_DIR ) && defined( DT_REG )
+	if ( entry->d_type == DT_REG ) {
+		return FS_ENTRY_FILE;
+	} else if ( entry->d_type == DT_DIR ) {
+		return FS_ENTRY_DIRECTORY;
+	} else if ( entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK ) {
+		return FS_ENTRY_OTHER;
+	}
+#	endif
+
+	/* follows links, same as stat */
+	struct stat st;
+#	if defined( _WIN32 )
+	( void ) directory;
+	if ( stat( path, &st ) != 0 ) {
+		return FS_ENTRY_OTHER;
+	}
+#	else
+	( void ) path;
+	if ( fstatat( dirfd( directory ), entry->d_name, &st, 0 ) != 0 ) {
+		return FS_ENTRY_OTHER;
+	}
+#	endif
+
+	if ( S_ISREG( st.st_mode ) ) {
+		return FS_ENTRY_FILE;
+	} else if ( S_ISDIR( st.st_mode ) ) {
+		return FS_ENTRY_DIRECTORY;
+	}
+
+	return FS_ENTRY_OTHER;
+}
+#endif
+
+/** Package Directory Tree **/
+/* Packages only store a flat list of names, so on mount these are split
+ * into a tree of directories, which scans and path queries can then walk
+ * without having to look at every name in the table. */
+
+static bool _plIsPathSeparator( char c ) {
+	return ( c == '/' || c == '\\' );
+}
+
+static bool _plComparePackageNode( const PLFileSystemMount* mount, const FSPackageNode* node, const char* name, size_t length ) {
+	if ( node->nameLength != length ) {
+		return false;
+	}
+
+	const char* nodeName = mount->pkg->namePool.names + node->nameOffset;
+	if ( mount->pkg->internal.caseInsensitive ) {
+		return ( pl_strncasecmp( nodeName, name, length ) == 0 );
+	}
+
+	return ( strncmp( nodeName, name, length ) == 0 );
+}
+
+static unsigned int _plFindPackageNodeChild( const PLFileSystemMount* mount, unsigned int parent, const char* name, size_t length ) {
+	const FSPackageTree* tree = &mount->tree;
+	for ( unsigned int i = tree->nodes[ parent ].firstChild; i != FS_PACKAGE_NODE_NONE; i = tree->nodes[ i ].nextSibling ) {
+		if ( _plComparePackageNode( mount, &tree->nodes[ i ], name, length ) ) {
+			return i;
+		}
+	}
+
+	return FS_PACKAGE_NODE_NONE;
+}
+
+static unsigned int _plAddPackageNode( PLFileSystemMount* mount, unsigned int parent, size_t nameOffset, unsigned int nameLength ) {
+	FSPackageTree* tree = &mount->tree;
+	if ( tree->numNodes == tree->maxNodes ) {
+		unsigned int maxNodes = ( tree->maxNodes > 0 ) ? tree->maxNodes * 2 : 16;
+		FSPackageNode* nodes = pl_realloc( tree->nodes, maxNodes * sizeof( FSPackageNode ) );
+		if ( nodes == NULL ) {
+			return FS_PACKAGE_NODE_NONE;
+		}
+		tree->nodes = nodes;
+		tree->maxNodes = maxNodes;
+	}
+
+	unsigned int index = tree->numNodes++;
+	FSPackageNode* node = &tree->nodes[ index ];
+	node->nameOffset = nameOffset;
+	node->nameLength = nameLength;
+	node->parent = parent;
+	node->firstChild = FS_PACKAGE_NODE_NONE;
+	node->firstFile = FS_PACKAGE_NODE_NONE;
+	node->nextSibling = FS_PACKAGE_NODE_NONE;
+	if ( parent != FS_PACKAGE_NODE_NONE ) {
+		node->nextSibling = tree->nodes[ parent ].firstChild;
+		tree->nodes[ parent ].firstChild = index;
+	}
+
+	return index;
+}
+
+static void _plClearPackageTree( PLFileSystemMount* mount ) {
+	pl_free( mount->tree.nodes );
+	pl_free( mount->tree.nextFile );
+	memset( &mount->tree, 0, sizeof( FSPackageTree ) );
+}
+
+static bool _plBuildPackageTree( PLFileSystemMount* mount ) {
+	memset( &mount->tree, 0, sizeof( FSPackageTree ) );
+
+	PLPackage* package = mount->pkg;
+	FSPackageTree* tree = &mount->tree;
+	if ( _plAddPackageNode( mount, FS_PACKAGE_NODE_NONE, 0, 0 ) == FS_PACKAGE_NODE_NONE ) {
+		return false;
+	}
+
+	if ( package->table_size > 0 && ( tree->nextFile = pl_malloc( package->table_size * sizeof( unsigned int ) ) ) == NULL ) {
+		_plClearPackageTree( mount );
+		return false;
+	}
+
+	/* runs backwards, so that each directory's files end up in table order */
+	const char* lastName = NULL;
+	size_t lastLength = 0;
+	unsigned int lastNode = 0;
+	for ( unsigned int i = package->table_size; i-- > 0; ) {
+		const char* name = plGetPackageFileName( package, i );
+
+		/* most tables are grouped by directory, so try the previous one first */
+		const char* fileName = name;
+		for ( const char* c = name; *c != '\0'; ++c ) {
+			if ( _plIsPathSeparator( *c ) ) {
+				fileName = c + 1;
+			}
+		}
+		size_t length = ( size_t ) ( fileName - name );
+
+		unsigned int node = 0;
+		if ( lastName != NULL && length == lastLength && strncmp( name, lastName, length ) == 0 ) {
+			node = lastNode;
+		} else {
+			const char* c = name;
+			while ( c < fileName && node != FS_PACKAGE_NODE_NONE ) {
+				while ( c < fileName && _plIsPathSeparator( *c ) ) {
+					c++;
+				}
+				const char* start = c;
+				while ( c < fileName && !_plIsPathSeparator( *c ) ) {
+					c++;
+				}
+				if ( c == start || ( c - start == 1 && *start == '.' ) ) {
+					continue;
+				}
+
+				unsigned int child = _plFindPackageNodeChild( mount, node, start, ( size_t ) ( c - start ) );
+				if ( child == FS_PACKAGE_NODE_NONE ) {
+					child = _plAddPackageNode( mount, node, package->table[ i ].nameOffset + ( size_t ) ( start - name ),
+					                           ( unsigned int ) ( c - start ) );
+				}
+				node = child;
+			}
+
+			if ( node == FS_PACKAGE_NODE_NONE ) {
+				_plClearPackageTree( mount );
+				return false;
+			}
+
+			lastName = name;
+			lastLength = length;
+			lastNode = node;
+		}
+
+		tree->nextFile[ i ] = tree->nodes[ node ].firstFile;
+		tree->nodes[ node ].firstFile = i;
+	}
+
+	return true;
+}
+
+/**
+ * Returns the node for the given directory within the package,
+ * or FS_PACKAGE_NODE_NONE if there's no such directory.
+ */
+static unsigned int _plFindPackageNode( const PLFileSystemMount* mount, const char* path ) {
+	if ( mount->tree.nodes == NULL ) {
+		return FS_PACKAGE_NODE_NONE;
+	}
+
+	unsigned int node = 0;
+	const char* c = path;
+	while ( *c != '\0' && node != FS_PACKAGE_NODE_NONE ) {
+		while ( _plIsPathSeparator( *c ) ) {
+			c++;
+		}
+		const char* start = c;
+		while ( *c != '\0' && !_plIsPathSeparator( *c ) ) {
+			c++;
+		}
+		if ( c == start || ( c - start == 1 && *start == '.' ) ) {
+			continue;
+		}
+
+		node = _plFindPackageNodeChild( mount, node, start, ( size_t ) ( c - start ) );
+	}
+
+	return node;
+}
+
+/** VFS Index **/
+/* Optional index of everything provided by the mounted locations, so
+ * lookups don't need to walk each mount in turn. This is rebuilt on
+ * demand whenever the mounted locations change. Everything in it is
+ * guarded by fs_index.mutex, since files may be opened from the async
+ * workers at the same time as the calling thread. */
+
+/* normalises the given path so it can be used as a key, i.e. "./a\\b//c" becomes "a/b/c" */
+const char* _plNormalizeIndexPath( const char* path, char* out, size_t length ) {
+	while ( path[ 0 ] == '.' && ( path[ 1 ] == '/' || path[ 1 ] == '\\' ) ) {
+		path += 2;
+	}
+
+	size_t i = 0;
+	for ( ; *path != '\0' && i < length - 1; ++path ) {
+		char c = ( *path == '\\' ) ? '/' : *path;
+		if ( c == '/' && ( i == 0 || out[ i - 1 ] == '/' ) ) {
+			continue;
+		}
+		out[ i++ ] = c;
+	}
+
+	if ( i > 0 && out[ i - 1 ] == '/' ) {
+		i--;
+	}
+	out[ i ] = '\0';
+
+	return out;
+}
+
+/* the directory walk relies on dirent and dev/inode pairs */
+#if !defined( _WIN32 )
+#	define FS_INDEX_SUPPORTED
+#endif
+
+#if defined( FS_INDEX_SUPPORTED )
+
+typedef struct FSIndexEntry {
+	char* path;                    /* NULL if the slot is empty */
+	uint32_t hash;
+	PLFileSystemMount* mount;      /* NULL if this is a cached miss */
+	bool isDirectory;
+} FSIndexEntry;
+
+static struct {
+	PLMutex mutex;
+	bool isEnabled;
+	bool isValid;
+	FSIndexEntry* slots;
+	unsigned int numSlots;         /* always a power of two */
+	unsigned int numEntries;
+	unsigned int numMisses;
+} fs_index = { .mutex = PL_MUTEX_INITIALIZER };
+
+/* once this many misses are cached, they're all thrown out */
+#define FS_INDEX_MAX_MISSES 4096
+
+static void _plClearFileSystemIndex( void ) {
+	for ( unsigned int i = 0; i < fs_index.numSlots; ++i ) {
+		pl_free( fs_index.slots[ i ].path );
+	}
+
+	pl_free( fs_index.slots );
+	fs_index.slots = NULL;
+	fs_index.numSlots = fs_index.numEntries = fs_index.numMisses = 0;
+	fs_index.isValid = false;
+}
+
+/**
+ * Flags the index as out of date, so it's rebuilt on the next lookup.
+ * This happens automatically whenever a location is mounted or cleared,
+ * or something under a mounted directory is written via the library, but
+ * should be called if any mounted directory is modified by other means.
+ */
+void plInvalidateFileSystemIndex( void ) {
+	_plLockMutex( &fs_index.mutex );
+	fs_index.isValid = false;
+	_plUnlockMutex( &fs_index.mutex );
+}
+
+/**
+ * Checks whether the given local path lies within one of the mounted
+ * directories, going by where they really are on disk.
+ */
+static bool _plIsPathInMountedDirectory( const char* path ) {
+	/* the path itself may have just been deleted, so go by its parent */
+	char parent[PL_SYSTEM_MAX_PATH];
+	snprintf( parent, sizeof( parent ), "%s", path );
+	char* c = strrchr( parent, '/' );
+	if ( c == NULL ) {
+		strcpy( parent, "." );
+	} else if ( c == parent ) {
+		c[ 1 ] = '\0';
+	} else {
+		*c = '\0';
+	}
+
+	char resolvedPath[PATH_MAX];
+	if ( realpath( parent, resolvedPath ) == NULL ) {
+		/* can't tell, so assume the worst */
+		return true;
+	}
+
+	for ( PLFileSystemMount* location = fs_mount_root; location != NULL; location = location->next ) {
+		char mountPath[PATH_MAX];
+		if ( location->type != FS_MOUNT_DIR || realpath( location->path, mountPath ) == NULL ) {
+			continue;
+		}
+
+		size_t length = strlen( mountPath );
+		if ( strncmp( resolvedPath, mountPath, length ) == 0 &&
+		     ( resolvedPath[ length ] == '\0' || resolvedPath[ length ] == '/' || mountPath[ length - 1 ] == '/' ) ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Called whenever the library creates or removes something on disk. The
+ * index is only thrown out if the path is somewhere it covers.
+ */
+void _plInvalidateFileSystemIndexPath( const char* path ) {
+	_plLockMutex( &fs_index.mutex );
+	if ( fs_index.isValid && _plIsPathInMountedDirectory( path ) ) {
+		fs_index.isValid = false;
+	}
+	_plUnlockMutex( &fs_index.mutex );
+}
+
+/* case-folded, so a package that ignores case can still be matched */
+static uint32_t _plHashIndexPath( const char* path ) {
+	uint32_t hash = 2166136261u;
+	for ( const char* c = path; *c != '\0'; ++c ) {
+		hash ^= ( uint8_t ) tolower( *c );
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool _plCompareIndexEntry( const FSIndexEntry* entry, const char* path ) {
+	if ( entry->mount != NULL && entry->mount->type == FS_MOUNT_PACKAGE && entry->mount->pkg->internal.caseInsensitive ) {
+		return ( pl_strcasecmp( entry->path, path ) == 0 );
+	}
+
+	return ( strcmp( entry->path, path ) == 0 );
+}
+
+/**
+ * Moves all of the entries into a new table of the given size, optionally
+ * dropping any cached misses along the way.
+ */
+static void _plRehashFileSystemIndex( unsigned int numSlots, bool dropMisses ) {
+	FSIndexEntry* oldSlots = fs_index.slots;
+	unsigned int oldNumSlots = fs_index.numSlots;
+
+	fs_index.slots = pl_calloc( numSlots, sizeof( FSIndexEntry ) );
+	fs_index.numSlots = numSlots;
+
+	if ( oldSlots == NULL ) {
+		return;
+	}
+
+	/* entries are moved across in probe order, starting just after an empty
+	 * slot, so those that share a hash keep the order they were inserted in
+	 * (which is the order of mount priority) */
+	unsigned int start = 0;
+	while ( oldSlots[ start ].path != NULL ) {
+		start++;
+	}
+
+	for ( unsigned int n = 1; n <= oldNumSlots; ++n ) {
+		FSIndexEntry* entry = &oldSlots[ ( start + n ) & ( oldNumSlots - 1 ) ];
+		if ( entry->path == NULL ) {
+			continue;
+		}
+
+		if ( dropMisses && entry->mount == NULL ) {
+			pl_free( entry->path );
+			fs_index.numEntries--;
+			continue;
+		}
+
+		unsigned int slot = entry->hash & ( numSlots - 1 );
+		while ( fs_index.slots[ slot ].path != NULL ) {
+			slot = ( slot + 1 ) & ( numSlots - 1 );
+		}
+		fs_index.slots[ slot ] = *entry;
+	}
+
+	if ( dropMisses ) {
+		fs_index.numMisses = 0;
+	}
+
+	pl_free( oldSlots );
+}
+
+/**
+ * Adds the given path to the index. Mounts are indexed in order of priority,
+ * so if the path is already provided by an earlier mount it's left alone.
+ */
+static void _plInsertIndexEntry( const char* path, PLFileSystemMount* mount, bool isDirectory ) {
+	if ( ( fs_index.numEntries + 1 ) * 2 > fs_index.numSlots ) {
+		_plRehashFileSystemIndex( fs_index.numSlots > 0 ? fs_index.numSlots * 2 : 1024, false );
+	}
+
+	uint32_t hash = _plHashIndexPath( path );
+	unsigned int slot = hash & ( fs_index.numSlots - 1 );
+	for ( ; fs_index.slots[ slot ].path != NULL; slot = ( slot + 1 ) & ( fs_index.numSlots - 1 ) ) {
+		if ( fs_index.slots[ slot ].hash == hash && strcmp( fs_index.slots[ slot ].path, path ) == 0 ) {
+			return;
+		}
+	}
+
+	FSIndexEntry* entry = &fs_index.slots[ slot ];
+	entry->path = pl_malloc( strlen( path ) + 1 );
+	strcpy( entry->path, path );
+	entry->hash = hash;
+	entry->mount = mount;
+	entry->isDirectory = isDirectory;
+	fs_index.numEntries++;
+}
+
+/* the chain of directories currently being walked, so links back up
+ * the tree can be spotted rather than followed forever */
+typedef struct FSIndexVisit {
+	dev_t device;
+	ino_t inode;
+	const struct FSIndexVisit* parent;
+} FSIndexVisit;
+
+static void _plIndexLocalDirectory( PLFileSystemMount* mount, const char* path, const char* relativePath, const FSIndexVisit* parent ) {
+	struct stat st;
+	if ( stat( path, &st ) != 0 ) {
+		return;
+	}
+
+	for ( const FSIndexVisit* visit = parent; visit != NULL; visit = visit->parent ) {
+		if ( visit->device == st.st_dev && visit->inode == st.st_ino ) {
+			FSLog( "Skipping %s, it links back to a parent directory\n", path );
+			return;
+		}
+	}
+
+	FSIndexVisit visit = { st.st_dev, st.st_ino, parent };
+
+	DIR* directory = opendir( path );
+	if ( directory == NULL ) {
+		return;
+	}
+
+	struct dirent* entry;
+	while ( ( entry = readdir( directory ) ) ) {
+		if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) {
+			continue;
+		}
+
+		char filePath[PL_SYSTEM_MAX_PATH + 1];
+		char fileRelativePath[PL_SYSTEM_MAX_PATH + 1];
+		int pathLength = snprintf( filePath, sizeof( filePath ), "%s/%s", path, entry->d_name );
+		int relativeLength = ( relativePath[ 0 ] == '\0' )
+		                             ? snprintf( fileRelativePath, sizeof( fileRelativePath ), "%s", entry->d_name )
+		                             : snprintf( fileRelativePath, sizeof( fileRelativePath ), "%s/%s", relativePath, entry->d_name );
+		if ( pathLength < 0 || ( size_t ) pathLength >= sizeof( filePath ) ||
+		     relativeLength < 0 || ( size_t ) relativeLength >= sizeof( fileRelativePath ) ) {
+			continue;
+		}
+
+		FSEntryType type = _plGetDirectoryEntryType( directory, entry, filePath );
+		if ( type == FS_ENTRY_DIRECTORY ) {
+			_plInsertIndexEntry( fileRelativePath, mount, true );
+			_plIndexLocalDirectory( mount, filePath, fileRelativePath, &visit );
+		} else if ( type == FS_ENTRY_FILE ) {
+			_plInsertIndexEntry( fileRelativePath, mount, false );
+		}
+	}
+
+	closedir( directory );
+}
+
+static void _plBuildFileSystemIndex( void ) {
+	_plClearFileSystemIndex();
+	_plRehashFileSystemIndex( 1024, false );
+
+	for ( PLFileSystemMount* location = fs_mount_root; location != NULL; location = location->next ) {
+		if ( location->type == FS_MOUNT_DIR ) {
+			_plIndexLocalDirectory( location, location->path, "", NULL );
+			continue;
+		}
+
+		for ( unsigned int i = 0; i < location->pkg->table_size; ++i ) {
+			char path[PL_SYSTEM_MAX_PATH];
+			_plNormalizeIndexPath( plGetPackageFileName( location->pkg, i ), path, sizeof( path ) );
+			_plInsertIndexEntry( path, location, false );
+
+			/* and each of the directories leading up to it */
+			for ( char* c = strrchr( path, '/' ); c != NULL; c = strrchr( path, '/' ) ) {
+				*c = '\0';
+				_plInsertIndexEntry( path, location, true );
+			}
+		}
+	}
+
+	fs_index.isValid = true;
+}
+
+/**
+ * Looks up the given path in the index. Returns false if the index can't be
+ * used, otherwise mount is set to whatever provides the path, or NULL if
+ * nothing does; misses are cached, so repeated lookups stay cheap.
+ */
+static bool _plLookupFileSystemIndex( const char* path, PLFileSystemMount** mount, bool* isDirectory ) {
+	/* relative paths are left to the OS to resolve */
+	if ( strstr( path, ".." ) != NULL ) {
+		return false;
+	}
+
+	char key[PL_SYSTEM_MAX_PATH];
+	_plNormalizeIndexPath( path, key, sizeof( key ) );
+
+	_plLockMutex( &fs_index.mutex );
+
+	if ( !fs_index.isEnabled ) {
+		_plUnlockMutex( &fs_index.mutex );
+		return false;
+	}
+
+	if ( !fs_index.isValid ) {
+		_plBuildFileSystemIndex();
+	} else if ( fs_index.numMisses >= FS_INDEX_MAX_MISSES ) {
+		_plRehashFileSystemIndex( fs_index.numSlots, true );
+	}
+
+	*mount = NULL;
+	*isDirectory = false;
+
+	uint32_t hash = _plHashIndexPath( key );
+	unsigned int mask = fs_index.numSlots - 1;
+	for ( unsigned int slot = hash & mask; fs_index.slots[ slot ].path != NULL; slot = ( slot + 1 ) & mask ) {
+		const FSIndexEntry* cur = &fs_index.slots[ slot ];
+		if ( cur->hash == hash && _plCompareIndexEntry( cur, key ) ) {
+			*mount = cur->mount;
+			*isDirectory = cur->isDirectory;
+			_plUnlockMutex( &fs_index.mutex );
+			return true;
+		}
+	}
+
+	_plInsertIndexEntry( key, NULL, false );
+	fs_index.numMisses++;
+
+	_plUnlockMutex( &fs_index.mutex );
+	return true;
+}
+
+/**
+ * Enables or disables the VFS index. While enabled, lookups via the VFS
+ * are resolved through a single table of everything that's mounted.
+ */
+void plEnableFileSystemIndex( bool enable ) {
+	_plLockMutex( &fs_index.mutex );
+	if ( !enable ) {
+		_plClearFileSystemIndex();
+	}
+
+	fs_index.isEnabled = enable;
+	_plUnlockMutex( &fs_index.mutex );
+}
+
+#else
+
+void plInvalidateFileSystemIndex( void ) {}
+void _plInvalidateFileSystemIndexPath( const char* path ) { ( void ) path; }
+
+static bool _plLookupFileSystemIndex( const char* path, PLFileSystemMount** mount, bool* isDirectory ) {
+	( void ) path;
+	( void ) mount;
+	( void ) isDirectory;
+	return false;
+}
+
+/* not available here, so lookups always walk the mounts */
+void plEnableFileSystemIndex( bool enable ) { ( void ) enable; }
+
+#endif
+
+/****/
 
 IMPLEMENT_COMMAND( fsLstPkg, "List all the files in a particular package." ) {
 	if ( argc == 1 ) {
@@ -111,7 +739,7 @@ IMPLEMENT_COMMAND( fsLstPkg, "List all the files in a particular package." ) {
 		       " csize:  %d\n"
 		       " ctype:  %d\n"
 		       " offset: %d\n", i,
-		       pkg->table[ i ].fileName,
+		       plGetPackageFileName( pkg, i ),
 		       pkg->table[ i ].fileSize,
 		       pkg->table[ i ].compressedSize,
 		       pkg->table[ i ].compressionType,
@@ -142,6 +770,30 @@ IMPLEMENT_COMMAND( fsListMounted, "Lists all of the mounted directories." ) {
 	Print( "%d locations mounted\n", numLocations );
 }
 
+IMPLEMENT_COMMAND( fsCacheStats, "Lists statistics for the file content cache." ) {
+	plUnused( argv );
+	plUnused( argc );
+
+	PLFileCacheStats stats;
+	plGetFileCacheStats( &stats );
+	if ( stats.maxSize == 0 ) {
+		Print( "File cache is disabled\n" );
+		return;
+	}
+
+	uint64_t numLookups = stats.numHits + stats.numMisses;
+	Print( " entries:   %u\n"
+	       " size:      %.2f/%.2f MiB\n"
+	       " hits:      %llu (%.1f%%)\n"
+	       " misses:    %llu\n"
+	       " evictions: %llu\n",
+	       stats.numEntries,
+	       plBytesToMebibytes( stats.size ), plBytesToMebibytes( stats.maxSize ),
+	       ( unsigned long long ) stats.numHits, ( numLookups > 0 ) ? ( double ) stats.numHits / numLookups * 100.0 : 0.0,
+	       ( unsigned long long ) stats.numMisses,
+	       ( unsigned long long ) stats.numEvictions );
+}
+
 IMPLEMENT_COMMAND( fsUnmount, "Unmount the specified directory." ) {
 	if ( argc == 1 ) {
 		Print( "%s", fsUnmount_var.description );
@@ -184,6 +836,7 @@ static void _plRegisterFSCommands( void ) {
 	PLConsoleCommand fsCommands[] = {
 	        fsLstPkg_var,
 	        fsListMounted_var,
+	        fsCacheStats_var,
 	        fsUnmount_var,
 	        fsMount_var,
 	};
@@ -193,7 +846,11 @@ static void _plRegisterFSCommands( void ) {
 }
 
 void plClearMountedLocation( PLFileSystemMount* location ) {
+	plInvalidateFileSystemIndex();
+
 	if ( location->type == FS_MOUNT_PACKAGE ) {
+		_plPurgeFileCache( location, NULL );
+		_plClearPackageTree( location );
 		plDestroyPackage( location->pkg );
 		location->pkg = NULL;
 	}
@@ -224,6 +881,8 @@ void plClearMountedLocations( void ) {
 }
 
 static void _plInsertMountLocation( PLFileSystemMount* location ) {
+	plInvalidateFileSystemIndex();
+
 	if ( fs_mount_root == NULL ) {
 		fs_mount_root = location;
 	}
@@ -262,6 +921,9 @@ PLFileSystemMount* plMountLocalLocation( const char* path ) {
 			_plInsertMountLocation( location );
 			location->type = FS_MOUNT_PACKAGE;
 			location->pkg = pkg;
+			if ( !_plBuildPackageTree( location ) ) {
+				PrintWarning( "Failed to build directory tree for %s, scans will skip it!\n", path );
+			}
 
 			Print( "Mounted package %s successfully!\n", path );
 
@@ -275,6 +937,21 @@ PLFileSystemMount* plMountLocalLocation( const char* path ) {
 	return NULL;
 }
 
+/**
+ * Returns the mounted location following the given one, or the first
+ * if given NULL.
+ */
+PLFileSystemMount* _plGetNextMountedLocation( PLFileSystemMount* location ) {
+	return ( location != NULL ) ? location->next : fs_mount_root;
+}
+
+/**
+ * Returns the local path of a mounted directory, or NULL if it's a package.
+ */
+const char* _plGetMountedLocationPath( const PLFileSystemMount* location ) {
+	return ( location->type == FS_MOUNT_DIR ) ? location->path : NULL;
+}
+
 /**
  * Mount the given location. On failure returns -1.
  */
@@ -299,6 +976,9 @@ PLFileSystemMount* plMountLocation( const char* path ) {
 			_plInsertMountLocation( location );
 			location->type = FS_MOUNT_PACKAGE;
 			location->pkg = pkg;
+			if ( !_plBuildPackageTree( location ) ) {
+				PrintWarning( "Failed to build directory tree for %s, scans will skip it!\n", path );
+			}
 
 			Print( "Mounted package %s successfully!\n", path );
 
@@ -316,13 +996,19 @@ PLFileSystemMount* plMountLocation( const char* path ) {
 
 PLresult plInitFileSystem( void ) {
 	_plRegisterFSCommands();
+	_plInitFileRequests();
 
 	plClearMountedLocations();
 	return PL_RESULT_SUCCESS;
 }
 
 void plShutdownFileSystem( void ) {
+	/* anything still in flight may be reading from a mount */
+	_plShutdownFileRequests();
+	_plShutdownFileWatches();
+
 	plClearMountedLocations();
+	plEnableFileSystemIndex( false );
 }
 
 // Checks whether a file has been modified or not.
@@ -367,7 +1053,7 @@ time_t plGetLocalFileTimeStamp( const char* path ) {
 time_t plGetFileTimeStamp( PLFile *ptr ) {
 	/* timestamp defaults to -1 for files loaded locally */
 	if( ptr->timeStamp < 0 ) {
-		plGetLocalFileTimeStamp( ptr->path );
+		ptr->timeStamp = plGetLocalFileTimeStamp( ptr->path );
 	}
 
 	return ptr->timeStamp;
@@ -380,6 +1066,7 @@ bool plCreateDirectory( const char* path ) {
 	}
 
 	if ( _pl_mkdir( path ) == 0 ) {
+		_plInvalidateFileSystemIndexPath( path );
 		return true;
 	}
 
@@ -512,123 +1199,546 @@ char* plGetApplicationDataDirectory( const char* app_name, char* out, size_t n )
 	return out;
 }
 
-typedef struct FSScanInstance {
-	char path[PL_SYSTEM_MAX_PATH];
-	struct FSScanInstance* next;
-} FSScanInstance;
+/** Directory Scanning **/
+/* Scans fan each sub-directory out to a set of worker threads, with the
+ * calling thread pitching in and handing results back in batches as they
+ * come in. Mounted packages are scanned via their directory tree. Anything
+ * found under more than one mounted location is only passed back once. */
+
+/* upper limit on threads used for a single recursive scan */
+#define FS_SCAN_MAX_WORKERS 8
+/* number of paths handed back per callback */
+#define FS_SCAN_BATCH_SIZE  256
+
+typedef struct FSScanDirectory {
+	char path[ PL_SYSTEM_MAX_PATH + 1 ];
+	const PLFileSystemMount* mount;
+	/* the directories above this one, oldest first, so links back up the
+	 * tree can be spotted; a copy, as they may be freed before we're read */
+	FSIndexVisit* parents;
+	unsigned int numParents;
+	struct FSScanDirectory* next;
+} FSScanDirectory;
+
+typedef struct FSScanBatch {
+	char* paths[ FS_SCAN_BATCH_SIZE ];
+	unsigned int numPaths;
+	struct FSScanBatch* next;
+} FSScanBatch;
+
+typedef struct FSScan {
+	const char* extension;
+	unsigned int flags;
+
+	PLMutex mutex;
+	PLCondition condition;          /* broadcast when there's new work, new results, or it's all done */
+
+	FSScanDirectory* directories;   /* waiting to be read */
+	unsigned int numBusy;           /* directories currently being read */
+
+	FSScanBatch *batches, *lastBatch;
+
+	/* set of everything passed back so far, only used when scanning several locations */
+	char** delivered;
+	unsigned int numDeliveredSlots;
+	unsigned int numDelivered;
+} FSScan;
+
+static void _plPushScanDirectory( FSScan* scan, const char* path, const PLFileSystemMount* mount, const FSIndexVisit* parent ) {
+	FSScanDirectory* directory = pl_malloc( sizeof( FSScanDirectory ) );
+	if ( directory == NULL ) {
+		return;
+	}
 
-static void _plScanLocalDirectory( const PLFileSystemMount* mount, FSScanInstance** fileList, const char* path,
-								   const char* extension, void (* Function)( const char*, void* ), bool recursive, void *userData ) {
-#if !defined( _MSC_VER )
-	DIR* directory = opendir( path );
-	if ( directory ) {
-		struct dirent* entry;
-		while ( ( entry = readdir( directory ) ) ) {
-			if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) {
-				continue;
-			}
+	snprintf( directory->path, sizeof( directory->path ), "%s", path );
+	directory->mount = mount;
 
-			char filestring[PL_SYSTEM_MAX_PATH + 1];
-			snprintf( filestring, sizeof( filestring ), "%s/%s", path, entry->d_name );
+	directory->numParents = 0;
+	for ( const FSIndexVisit* visit = parent; visit != NULL; visit = visit->parent ) {
+		directory->numParents++;
+	}
 
-			struct stat st;
-			if ( stat( filestring, &st ) == 0 ) {
-				if ( S_ISREG( st.st_mode ) ) {
-					if ( extension == NULL || pl_strcasecmp( plGetFileExtension( entry->d_name ), extension ) == 0 ) {
-						if ( mount == NULL ) {
-							Function( filestring, userData );
-							continue;
-						}
+	directory->parents = NULL;
+	if ( directory->numParents > 0 ) {
+		directory->parents = pl_malloc( sizeof( FSIndexVisit ) * directory->numParents );
+		if ( directory->parents == NULL ) {
+			pl_free( directory );
+			return;
+		}
 
-						size_t pos = strlen( mount->path );
-						if ( pos >= sizeof( filestring ) ) {
-							PrintWarning( "pos >= %d!\n", pos );
-							continue;
-						}
-						const char* filePath = &filestring[ pos ];
+		unsigned int i = directory->numParents;
+		for ( const FSIndexVisit* visit = parent; visit != NULL; visit = visit->parent ) {
+			--i;
+			directory->parents[ i ].device = visit->device;
+			directory->parents[ i ].inode = visit->inode;
+			directory->parents[ i ].parent = ( i > 0 ) ? &directory->parents[ i - 1 ] : NULL;
+		}
+	}
 
-						// Ensure it's not already in the list
-						FSScanInstance* cur = *fileList;
-						while ( cur != NULL ) {
-							if ( strcmp( filePath, cur->path ) == 0 ) {
-								// File was already passed back
-								break;
-							}
+	_plLockMutex( &scan->mutex );
+	directory->next = scan->directories;
+	scan->directories = directory;
+	_plBroadcastCondition( &scan->condition );
+	_plUnlockMutex( &scan->mutex );
+}
 
-							cur = cur->next;
-						}
+static void _plPushScanBatch( FSScan* scan, FSScanBatch* batch ) {
+	batch->next = NULL;
 
-						// Jumped the list early, so abort here
-						if ( cur != NULL ) {
-							continue;
-						}
+	_plLockMutex( &scan->mutex );
+	if ( scan->lastBatch != NULL ) {
+		scan->lastBatch->next = batch;
+	} else {
+		scan->batches = batch;
+	}
+	scan->lastBatch = batch;
+	_plBroadcastCondition( &scan->condition );
+	_plUnlockMutex( &scan->mutex );
+}
 
-						Function( filePath, userData );
+static void _plScanLocalDirectory( FSScan* scan, const FSScanDirectory* scanDirectory ) {
+#if !defined( _MSC_VER )
+	struct stat st;
+	if ( stat( scanDirectory->path, &st ) != 0 ) {
+		return;
+	}
 
-						// Tack it onto the list
-						cur = pl_calloc( 1, sizeof( FSScanInstance ) );
-						strncpy( cur->path, filePath, sizeof( cur->path ) );
-						cur->next = *fileList;
-						*fileList = cur;
-					}
-				} else if ( S_ISDIR( st.st_mode ) && recursive ) {
-					_plScanLocalDirectory( mount, fileList, filestring, extension, Function, recursive, userData );
-				}
-			}
+	const FSIndexVisit* parent = ( scanDirectory->numParents > 0 ) ? &scanDirectory->parents[ scanDirectory->numParents - 1 ] : NULL;
+	for ( const FSIndexVisit* visit = parent; visit != NULL; visit = visit->parent ) {
+		if ( visit->device == st.st_dev && visit->inode == st.st_ino ) {
+			FSLog( "Skipping %s, it links back to a parent directory\n", scanDirectory->path );
+			return;
 		}
+	}
 
-		closedir( directory );
-	} else {
+	FSIndexVisit visit = { st.st_dev, st.st_ino, parent };
+
+	DIR* directory = opendir( scanDirectory->path );
+	if ( directory == NULL ) {
 		ReportError( PL_RESULT_FILEPATH, "opendir failed!" );
+		return;
 	}
+
+	/* skip past the mount and its separator */
+	size_t pos = ( scanDirectory->mount != NULL ) ? strlen( scanDirectory->mount->path ) + 1 : 0;
+
+	FSScanBatch* batch = NULL;
+	struct dirent* entry;
+	while ( ( entry = readdir( directory ) ) ) {
+		if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) {
+			continue;
+		}
+
+		/* anything too long to be opened is skipped rather than truncated */
+		char filestring[PL_SYSTEM_MAX_PATH + 1];
+		int pathLength = snprintf( filestring, sizeof( filestring ), "%s/%s", scanDirectory->path, entry->d_name );
+		if ( pathLength < 0 || ( size_t ) pathLength >= sizeof( filestring ) ) {
+			continue;
+		}
+
+		FSEntryType type = _plGetDirectoryEntryType( directory, entry, filestring );
+		if ( type == FS_ENTRY_DIRECTORY ) {
+			if ( scan->flags & PL_SCAN_RECURSIVE ) {
+				_plPushScanDirectory( scan, filestring, scanDirectory->mount, &visit );
+			}
+			continue;
+		} else if ( type != FS_ENTRY_FILE ) {
+			continue;
+		}
+
+		if ( scan->extension != NULL && pl_strcasecmp( plGetFileExtension( entry->d_name ), scan->extension ) != 0 ) {
+			continue;
+		}
+
+		/* files under a mounted location are passed back relative to it */
+		const char* filePath = &filestring[ pos ];
+		size_t length = strlen( filePath ) + 1;
+		char* copy = pl_malloc( length );
+		if ( copy == NULL ) {
+			continue;
+		}
+		memcpy( copy, filePath, length );
+
+		if ( batch == NULL && ( batch = pl_calloc( 1, sizeof( FSScanBatch ) ) ) == NULL ) {
+			pl_free( copy );
+			continue;
+		}
+		batch->paths[ batch->numPaths++ ] = copy;
+		if ( batch->numPaths == FS_SCAN_BATCH_SIZE ) {
+			_plPushScanBatch( scan, batch );
+			batch = NULL;
+		}
+	}
+
+	if ( batch != NULL ) {
+		_plPushScanBatch( scan, batch );
+	}
+
+	closedir( directory );
 #else
 	// TODO: Win32 implementation
 #endif
 }
 
+static void _plScanPackageNode( FSScan* scan, const PLFileSystemMount* mount, unsigned int node, FSScanBatch** batch ) {
+	const FSPackageTree* tree = &mount->tree;
+	for ( unsigned int i = tree->nodes[ node ].firstFile; i != FS_PACKAGE_NODE_NONE; i = tree->nextFile[ i ] ) {
+		const char* filePath = plGetPackageFileName( mount->pkg, i );
+		if ( scan->extension != NULL && pl_strcasecmp( plGetFileExtension( filePath ), scan->extension ) != 0 ) {
+			continue;
+		}
+
+		size_t length = strlen( filePath ) + 1;
+		char* copy = pl_malloc( length );
+		if ( copy == NULL ) {
+			continue;
+		}
+		memcpy( copy, filePath, length );
+
+		if ( *batch == NULL && ( *batch = pl_calloc( 1, sizeof( FSScanBatch ) ) ) == NULL ) {
+			pl_free( copy );
+			continue;
+		}
+		( *batch )->paths[ ( *batch )->numPaths++ ] = copy;
+		if ( ( *batch )->numPaths == FS_SCAN_BATCH_SIZE ) {
+			_plPushScanBatch( scan, *batch );
+			*batch = NULL;
+		}
+	}
+
+	if ( !( scan->flags & PL_SCAN_RECURSIVE ) ) {
+		return;
+	}
+
+	for ( unsigned int i = tree->nodes[ node ].firstChild; i != FS_PACKAGE_NODE_NONE; i = tree->nodes[ i ].nextSibling ) {
+		_plScanPackageNode( scan, mount, i, batch );
+	}
+}
+
+/**
+ * Walks the mounted package's directory tree. It's all in memory, so
+ * this is done up front on the calling thread rather than farmed out.
+ */
+static void _plScanPackageDirectory( FSScan* scan, const PLFileSystemMount* mount, const char* path ) {
+	unsigned int node = _plFindPackageNode( mount, path );
+	if ( node == FS_PACKAGE_NODE_NONE ) {
+		return;
+	}
+
+	FSScanBatch* batch = NULL;
+	_plScanPackageNode( scan, mount, node, &batch );
+	if ( batch != NULL ) {
+		_plPushScanBatch( scan, batch );
+	}
+}
+
+/**
+ * Reads the next waiting directory, if there is one.
+ * Expects scan->mutex to be held, and will have released and
+ * taken it again in the meantime if it returns true.
+ */
+static bool _plScanNextDirectory( FSScan* scan ) {
+	FSScanDirectory* directory = scan->directories;
+	if ( directory == NULL ) {
+		return false;
+	}
+
+	scan->directories = directory->next;
+	scan->numBusy++;
+	_plUnlockMutex( &scan->mutex );
+
+	_plScanLocalDirectory( scan, directory );
+	pl_free( directory->parents );
+	pl_free( directory );
+
+	_plLockMutex( &scan->mutex );
+	if ( --scan->numBusy == 0 && scan->directories == NULL ) {
+		_plBroadcastCondition( &scan->condition );
+	}
+	return true;
+}
+
+static void _plScanWorker( void* userData ) {
+	FSScan* scan = userData;
+
+	_plLockMutex( &scan->mutex );
+	for ( ;; ) {
+		if ( _plScanNextDirectory( scan ) ) {
+			continue;
+		} else if ( scan->numBusy == 0 ) {
+			break;
+		}
+
+		_plWaitCondition( &scan->condition, &scan->mutex );
+	}
+	_plUnlockMutex( &scan->mutex );
+}
+
+/**
+ * Adds the path to the set of those already passed back.
+ * @return False if it was already there.
+ */
+static bool _plInsertScanPath( FSScan* scan, char* path ) {
+	if ( ( scan->numDelivered + 1 ) * 2 > scan->numDeliveredSlots ) {
+		unsigned int numSlots = ( scan->numDeliveredSlots > 0 ) ? scan->numDeliveredSlots * 2 : 1024;
+		char** slots = pl_calloc( numSlots, sizeof( char* ) );
+		if ( slots == NULL ) {
+			return true;
+		}
+
+		for ( unsigned int i = 0; i < scan->numDeliveredSlots; ++i ) {
+			if ( scan->delivered[ i ] == NULL ) {
+				continue;
+			}
+
+			unsigned int slot = _plHashIndexPath( scan->delivered[ i ] ) & ( numSlots - 1 );
+			while ( slots[ slot ] != NULL ) {
+				slot = ( slot + 1 ) & ( numSlots - 1 );
+			}
+			slots[ slot ] = scan->delivered[ i ];
+		}
+
+		pl_free( scan->delivered );
+		scan->delivered = slots;
+		scan->numDeliveredSlots = numSlots;
+	}
+
+	unsigned int slot = _plHashIndexPath( path ) & ( scan->numDeliveredSlots - 1 );
+	for ( ; scan->delivered[ slot ] != NULL; slot = ( slot + 1 ) & ( scan->numDeliveredSlots - 1 ) ) {
+		if ( strcmp( scan->delivered[ slot ], path ) == 0 ) {
+			return false;
+		}
+	}
+
+	scan->delivered[ slot ] = path;
+	scan->numDelivered++;
+	return true;
+}
+
+/**
+ * Passes the given paths on to the callback, dropping any that have
+ * already been passed back, and then frees them.
+ */
+static void _plDeliverScanPaths( FSScan* scan, char** paths, unsigned int numPaths, bool deduplicate,
+                                 PLScanBatchCallback Callback, void* userData ) {
+	unsigned int numUnique = 0;
+	for ( unsigned int i = 0; i < numPaths; ++i ) {
+		if ( !deduplicate ) {
+			paths[ numUnique++ ] = paths[ i ];
+			continue;
+		}
+
+		/* the set takes a copy, as the originals are freed below */
+		size_t length = strlen( paths[ i ] ) + 1;
+		char* copy = pl_malloc( length );
+		if ( copy == NULL ) {
+			pl_free( paths[ i ] );
+			continue;
+		}
+		memcpy( copy, paths[ i ], length );
+
+		if ( _plInsertScanPath( scan, copy ) ) {
+			paths[ numUnique++ ] = paths[ i ];
+		} else {
+			pl_free( copy );
+			pl_free( paths[ i ] );
+		}
+	}
+
+	if ( numUnique > 0 ) {
+		Callback( ( const char** ) paths, numUnique, userData );
+	}
+
+	for ( unsigned int i = 0; i < numUnique; ++i ) {
+		pl_free( paths[ i ] );
+	}
+}
+
+static int _plCompareScanPaths( const void* a, const void* b ) {
+	return strcmp( *( const char* const* ) a, *( const char* const* ) b );
+}
+
 /**
- * Scans the given directory.
+ * Scans the given directory, across all mounted locations, passing
+ * back whatever's found in batches. The callback is always called from
+ * the calling thread.
  *
  * @param path path to directory.
- * @param extension the extension to scan for (exclude '.').
- * @param Function callback function to deal with the file.
- * @param recursive if true, also scans the contents of each sub-directory.
+ * @param extension the extension to scan for (exclude '.'), or NULL for everything.
+ * @param Callback called with each batch of paths, which are only valid until it returns.
+ * @param flags combination of PLScanFlags.
+ * @param userData passed on to the callback.
  */
-void plScanDirectory( const char* path, const char* extension, void (* Function)( const char*, void* ), bool recursive, void *userData ) {
+void plScanDirectoryBatched( const char* path, const char* extension, PLScanBatchCallback Callback, unsigned int flags, void* userData ) {
+	FSScan scan;
+	memset( &scan, 0, sizeof( FSScan ) );
+	scan.extension = extension;
+	scan.flags = flags;
+	_plInitMutex( &scan.mutex );
+	_plInitCondition( &scan.condition );
+
+	unsigned int numRoots = 0;
 	if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
-		_plScanLocalDirectory( NULL, NULL, path + sizeof( FS_LOCAL_HINT ), extension, Function, recursive, userData );
-		return;
+		_plPushScanDirectory( &scan, path + sizeof( FS_LOCAL_HINT ), NULL, NULL );
+		numRoots++;
+	} else if ( fs_mount_root == NULL ) {
+		// If no mounted locations, assume local scan
+		_plPushScanDirectory( &scan, path, NULL, NULL );
+		numRoots++;
+	} else {
+		for ( PLFileSystemMount* location = fs_mount_root; location != NULL; location = location->next ) {
+			if ( location->type == FS_MOUNT_PACKAGE ) {
+				_plScanPackageDirectory( &scan, location, path );
+				numRoots++;
+			} else if ( location->type == FS_MOUNT_DIR ) {
+				char mounted_path[PL_SYSTEM_MAX_PATH + 1];
+				if ( *path == '\0' ) {
+					snprintf( mounted_path, sizeof( mounted_path ), "%s", location->path );
+				} else {
+					snprintf( mounted_path, sizeof( mounted_path ), "%s/%s", location->path, path );
+				}
+				_plPushScanDirectory( &scan, mounted_path, location, NULL );
+				numRoots++;
+			}
+		}
 	}
 
-	// If no mounted locations, assume local scan
-	if ( fs_mount_root == NULL ) {
-		_plScanLocalDirectory( NULL, NULL, path, extension, Function, recursive, userData );
-		return;
+	/* a flat scan is just a handful of directories, not worth the threads */
+	PLThread workers[ FS_SCAN_MAX_WORKERS ];
+	unsigned int numWorkers = 0;
+	if ( flags & PL_SCAN_RECURSIVE ) {
+		unsigned int maxWorkers = _plGetNumProcessors() - 1;
+		if ( maxWorkers > FS_SCAN_MAX_WORKERS ) {
+			maxWorkers = FS_SCAN_MAX_WORKERS;
+		}
+		for ( ; numWorkers < maxWorkers; ++numWorkers ) {
+			if ( !_plCreateThread( &workers[ numWorkers ], _plScanWorker, &scan ) ) {
+				break;
+			}
+		}
 	}
 
-	FSScanInstance* fileList = NULL;
-	PLFileSystemMount* location = fs_mount_root;
-	while ( location != NULL ) {
-		if ( location->type == FS_MOUNT_PACKAGE ) {
-			// Only works for directories for now
-		} else if ( location->type == FS_MOUNT_DIR ) {
-			char mounted_path[PL_SYSTEM_MAX_PATH + 1];
-			snprintf( mounted_path, sizeof( mounted_path ), "%s/%s", location->path, path );
-			_plScanLocalDirectory( location, &fileList, mounted_path, extension, Function, recursive, userData );
+	bool deduplicate = ( numRoots > 1 );
+	bool isSorted = ( flags & PL_SCAN_SORTED );
+
+	char** sortedPaths = NULL;
+	size_t numSortedPaths = 0;
+	size_t maxSortedPaths = 0;
+
+	/* help out with the scan, and hand back results as they turn up */
+	_plLockMutex( &scan.mutex );
+	for ( ;; ) {
+		FSScanBatch* batch = scan.batches;
+		if ( batch != NULL ) {
+			scan.batches = scan.lastBatch = NULL;
+			_plUnlockMutex( &scan.mutex );
+
+			while ( batch != NULL ) {
+				FSScanBatch* next = batch->next;
+				if ( isSorted ) {
+					/* hold onto everything until the end */
+					if ( numSortedPaths + batch->numPaths > maxSortedPaths ) {
+						size_t newMax = ( maxSortedPaths > 0 ) ? maxSortedPaths * 2 : 1024;
+						while ( newMax < numSortedPaths + batch->numPaths ) {
+							newMax *= 2;
+						}
+						char** newPaths = pl_realloc( sortedPaths, newMax * sizeof( char* ) );
+						if ( newPaths != NULL ) {
+							sortedPaths = newPaths;
+							maxSortedPaths = newMax;
+						}
+					}
+					for ( unsigned int i = 0; i < batch->numPaths; ++i ) {
+						if ( numSortedPaths < maxSortedPaths ) {
+							sortedPaths[ numSortedPaths++ ] = batch->paths[ i ];
+						} else {
+							pl_free( batch->paths[ i ] );
+						}
+					}
+				} else {
+					_plDeliverScanPaths( &scan, batch->paths, batch->numPaths, deduplicate, Callback, userData );
+				}
+				pl_free( batch );
+				batch = next;
+			}
+
+			_plLockMutex( &scan.mutex );
+			continue;
 		}
 
-		location = location->next;
+		if ( _plScanNextDirectory( &scan ) ) {
+			continue;
+		} else if ( scan.numBusy == 0 ) {
+			break;
+		}
+
+		_plWaitCondition( &scan.condition, &scan.mutex );
+	}
+	_plUnlockMutex( &scan.mutex );
+
+	for ( unsigned int i = 0; i < numWorkers; ++i ) {
+		_plJoinThread( workers[ i ] );
+	}
+
+	if ( isSorted && numSortedPaths > 0 ) {
+		qsort( sortedPaths, numSortedPaths, sizeof( char* ), _plCompareScanPaths );
+
+		/* duplicates are now next to each other */
+		size_t numUnique = 0;
+		for ( size_t i = 0; i < numSortedPaths; ++i ) {
+			if ( numUnique > 0 && strcmp( sortedPaths[ numUnique - 1 ], sortedPaths[ i ] ) == 0 ) {
+				pl_free( sortedPaths[ i ] );
+				continue;
+			}
+			sortedPaths[ numUnique++ ] = sortedPaths[ i ];
+		}
+
+		for ( size_t i = 0; i < numUnique; i += FS_SCAN_BATCH_SIZE ) {
+			size_t numPaths = numUnique - i;
+			if ( numPaths > FS_SCAN_BATCH_SIZE ) {
+				numPaths = FS_SCAN_BATCH_SIZE;
+			}
+			_plDeliverScanPaths( &scan, &sortedPaths[ i ], ( unsigned int ) numPaths, false, Callback, userData );
+		}
+	}
+	pl_free( sortedPaths );
+
+	for ( unsigned int i = 0; i < scan.numDeliveredSlots; ++i ) {
+		pl_free( scan.delivered[ i ] );
 	}
+	pl_free( scan.delivered );
+
+	_plDestroyCondition( &scan.condition );
+	_plDestroyMutex( &scan.mutex );
+}
+
+typedef struct FSScanCallback {
+	void ( *Function )( const char*, void* );
+	void* userData;
+} FSScanCallback;
 
-	// Clean up the list
-	FSScanInstance* current = fileList;
-	while ( current != NULL ) {
-		FSScanInstance* prev = current;
-		current = current->next;
-		pl_free( prev );
+static void _plScanDirectoryCallback( const char** paths, unsigned int numPaths, void* userData ) {
+	FSScanCallback* callback = userData;
+	for ( unsigned int i = 0; i < numPaths; ++i ) {
+		callback->Function( paths[ i ], callback->userData );
 	}
 }
 
+/**
+ * Scans the given directory. Everything is passed back in order once the
+ * scan is done, so the order doesn't depend on how the scan was split up
+ * between threads; use plScanDirectoryBatched to get results as they come.
+ *
+ * @param path path to directory.
+ * @param extension the extension to scan for (exclude '.').
+ * @param Function callback function to deal with the file.
+ * @param recursive if true, also scans the contents of each sub-directory.
+ */
+void plScanDirectory( const char* path, const char* extension, void (* Function)( const char*, void* ), bool recursive, void *userData ) {
+	FSScanCallback callback = { Function, userData };
+	plScanDirectoryBatched( path, extension, _plScanDirectoryCallback, PL_SCAN_SORTED | ( recursive ? PL_SCAN_RECURSIVE : 0 ), &callback );
+}
+
 const char* plGetWorkingDirectory( void ) {
 	static char out[PL_SYSTEM_MAX_PATH] = { '\0' };
 	if ( getcwd( out, PL_SYSTEM_MAX_PATH ) == NULL ) {
@@ -650,39 +1760,92 @@ void plSetWorkingDirectory( const char* path ) {
 /////////////////////////////////////////////////////////////////////////////////////
 // FILE I/O
 
-bool plLocalFileExists( const char* path ) {
+/**
+ * Fetches information about the given local file without opening it.
+ * No error is reported if the file doesn't exist, so this is also
+ * suitable for existence checks.
+ * @param path Path to the file.
+ * @param stats Output, may be NULL.
+ * @return False if the file wasn't accessible.
+ */
+bool plStatLocalFile( const char* path, PLFileStat* stats ) {
 	struct stat buffer;
-	return ( bool ) ( stat( path, &buffer ) == 0 );
+	if ( stat( path, &buffer ) != 0 ) {
+		return false;
+	}
+
+	if ( stats != NULL ) {
+		stats->size = stats->compressedSize = ( size_t ) buffer.st_size;
+		stats->compressionType = PL_COMPRESSION_NONE;
+		stats->timeStamp = buffer.st_mtime;
+		stats->mount = NULL;
+	}
+
+	return true;
+}
+
+static bool _plStatMountedFile( PLFileSystemMount* location, const char* path, PLFileStat* stats ) {
+	if ( location->type == FS_MOUNT_DIR ) {
+		/* todo: don't allow path to search outside of mounted path */
+		char buf[PL_SYSTEM_MAX_PATH + 1];
+		snprintf( buf, sizeof( buf ), "%s/%s", location->path, path );
+		if ( !plStatLocalFile( buf, stats ) ) {
+			return false;
+		}
+
+		if ( stats != NULL ) {
+			stats->mount = location;
+		}
+
+		return true;
+	}
+
+	const PLPackageIndex* index = plGetPackageIndex( location->pkg, path );
+	if ( index == NULL ) {
+		return false;
+	}
+
+	if ( stats != NULL ) {
+		stats->size = index->fileSize;
+		stats->compressionType = index->compressionType;
+		stats->compressedSize = ( index->compressionType != PL_COMPRESSION_NONE ) ? index->compressedSize : index->fileSize;
+		stats->timeStamp = ( location->pkg->internal.filePtr != NULL ) ? plGetFileTimeStamp( location->pkg->internal.filePtr ) : 0;
+		stats->mount = location;
+	}
+
+	return true;
 }
 
 /**
- * Checks whether or not the given file is accessible or exists.
- * @param path
+ * Fetches information about the given file via the VFS, without touching
+ * its contents; package files are resolved from the package's table.
+ * @param path Path to the file.
+ * @param stats Output, may be NULL.
  * @return False if the file wasn't accessible.
  */
-bool plFileExists( const char* path ) {
-    if ( fs_mount_root == NULL ) {
-        return plLocalFileExists( path );
-    } else if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
+bool plStatFile( const char* path, PLFileStat* stats ) {
+	if ( fs_mount_root == NULL ) {
+		return plStatLocalFile( path, stats );
+	} else if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
 		path += sizeof( FS_LOCAL_HINT );
-		return plLocalFileExists( path );
+		return plStatLocalFile( path, stats );
+	}
+
+	PLFileSystemMount* mount;
+	bool isDirectory;
+	if ( _plLookupFileSystemIndex( path, &mount, &isDirectory ) ) {
+		if ( mount == NULL || isDirectory ) {
+			return false;
+		}
+
+		/* no need to go any further if we're only checking it exists */
+		return ( stats == NULL ) || _plStatMountedFile( mount, path, stats );
 	}
 
 	PLFileSystemMount* location = fs_mount_root;
 	while ( location != NULL ) {
-		if ( location->type == FS_MOUNT_DIR ) {
-			/* todo: don't allow path to search outside of mounted path */
-			char buf[PL_SYSTEM_MAX_PATH + 1];
-			snprintf( buf, sizeof( buf ), "%s/%s", location->path, path );
-			if ( plLocalFileExists( buf ) ) {
-				return true;
-			}
-		} else {
-			PLFile* fp = plLoadPackageFile( location->pkg, path );
-			if ( fp != NULL ) {
-				plCloseFile( fp );
-				return true;
-			}
+		if ( _plStatMountedFile( location, path, stats ) ) {
+			return true;
 		}
 
 		location = location->next;
@@ -691,6 +1854,19 @@ bool plFileExists( const char* path ) {
 	return false;
 }
 
+bool plLocalFileExists( const char* path ) {
+	return plStatLocalFile( path, NULL );
+}
+
+/**
+ * Checks whether or not the given file is accessible or exists.
+ * @param path
+ * @return False if the file wasn't accessible.
+ */
+bool plFileExists( const char* path ) {
+	return plStatFile( path, NULL );
+}
+
 bool plLocalPathExists( const char* path ) {
 #if defined(_MSC_VER)
 	DWORD fa = GetFileAttributes(path);
@@ -716,6 +1892,12 @@ bool plPathExists( const char* path ) {
 		return plLocalPathExists( path );
 	}
 
+	PLFileSystemMount* mount;
+	bool isDirectory;
+	if ( _plLookupFileSystemIndex( path, &mount, &isDirectory ) ) {
+		return ( mount != NULL && isDirectory );
+	}
+
 	PLFileSystemMount* location = fs_mount_root;
 	while ( location != NULL ) {
 		if ( location->type == FS_MOUNT_DIR ) {
@@ -725,13 +1907,8 @@ bool plPathExists( const char* path ) {
 			if ( plLocalPathExists( buf ) ) {
 				return true;
 			}
-		} else {
-			for ( unsigned int i = 0; i < location->pkg->table_size; ++i ) {
-				char* p = strstr( location->pkg->path, path );
-				if ( p != NULL && p == location->pkg->path ) {
-					return true;
-				}
-			}
+		} else if ( _plFindPackageNode( location, path ) != FS_PACKAGE_NODE_NONE ) {
+			return true;
 		}
 
 		location = location->next;
@@ -752,6 +1929,8 @@ bool plDeleteFile( const char* path ) {
 
 	int result = remove( path );
 	if ( result == 0 ) {
+		_plInvalidateFileSystemIndexPath( path );
+		_plPurgeFileCache( NULL, path );
 		return true;
 	}
 
@@ -773,6 +1952,9 @@ bool plWriteFile( const char* path, const uint8_t* buf, size_t length ) {
 		return false;
 	}
 
+	_plInvalidateFileSystemIndexPath( path );
+	_plPurgeFileCache( NULL, path );
+
 	bool result = true;
 	if ( fwrite( buf, sizeof( char ), length, fp ) != length ) {
 		ReportError( PL_RESULT_FILEWRITE, "failed to write entirety of file" );
@@ -784,39 +1966,130 @@ bool plWriteFile( const char* path, const uint8_t* buf, size_t length ) {
 	return result;
 }
 
-bool plCopyFile( const char* path, const char* dest ) {
-	// read in the original
-	PLFile* original = plOpenFile( path, true );
-	if ( original == NULL ) {
-		ReportError( PL_RESULT_FILEREAD, "failed to open %s", path );
+#if defined( __linux__ )
+/**
+ * Copies as much of the range as the kernel will let us, without it ever
+ * passing through user-space.
+ * @return Number of bytes copied, anything left over is up to the caller.
+ */
+static size_t _plCopyFileRangeKernel( int inFd, size_t offset, size_t length, int outFd ) {
+	size_t total = 0;
+
+#	if defined( __NR_copy_file_range )
+	/* can share extents outright on filesystems that support it */
+	static bool isCopyRangeSupported = true;
+	while ( total < length && isCopyRangeSupported ) {
+		loff_t inOffset = ( loff_t ) ( offset + total );
+		ssize_t numCopied = syscall( __NR_copy_file_range, inFd, &inOffset, outFd, NULL, length - total, 0 );
+		if ( numCopied < 0 && errno == EINTR ) {
+			continue;
+		} else if ( numCopied < 0 ) {
+			/* older kernels don't support it at all, or not across filesystems */
+			if ( errno == ENOSYS || errno == EPERM ) {
+				isCopyRangeSupported = false;
+			}
+			break;
+		} else if ( numCopied == 0 ) {
+			return total;
+		}
+		total += ( size_t ) numCopied;
+	}
+#	endif
+
+	while ( total < length ) {
+		off_t inOffset = ( off_t ) ( offset + total );
+		ssize_t numCopied = sendfile( outFd, inFd, &inOffset, length - total );
+		if ( numCopied < 0 && errno == EINTR ) {
+			continue;
+		} else if ( numCopied <= 0 ) {
+			break;
+		}
+		total += ( size_t ) numCopied;
+	}
+
+	return total;
+}
+#endif
+
+/* size of the buffer used when the copy can't be done by the kernel */
+#define FS_COPY_CHUNK_SIZE  65536
+
+/**
+ * Writes out a range of the given file to dest, keeping the copy
+ * within the kernel where the platform allows it, or writing
+ * straight out of memory for files that are cached or mapped.
+ * @param ptr File to copy from.
+ * @param offset Offset into the file to start from.
+ * @param length Number of bytes to copy.
+ * @param dest Local path to write the range out to.
+ * @return True on success.
+ */
+bool _plWriteFileRange( PLFile* ptr, size_t offset, size_t length, const char* dest ) {
+	/* opening dest for write would truncate the very data we're about to read */
+	if ( ( ptr->fptr != NULL || ptr->isMapped ) && _plIsSameLocalFile( ptr->path, dest ) ) {
+		ReportError( PL_RESULT_FILEPATH, "%s is the file being copied from", dest );
 		return false;
 	}
 
-	// write out the copy
-	FILE* copy = fopen( dest, "wb" );
-	if ( copy == NULL ) {
+	if ( ptr->fptr == NULL ) {
+		if ( offset > ptr->size || length > ptr->size - offset ) {
+			ReportBasicError( PL_RESULT_FILESIZE );
+			return false;
+		}
+
+		return plWriteFile( dest, ptr->data + offset, length );
+	}
+
+	FILE* out = fopen( dest, "wb" );
+	if ( out == NULL ) {
 		ReportError( PL_RESULT_FILEWRITE, "failed to open %s for write", dest );
-		goto BAIL;
+		return false;
 	}
 
-	if ( fwrite( original->data, 1, original->size, copy ) != original->size ) {
-		ReportError( PL_RESULT_FILEWRITE, "failed to write out %d bytes for %s", original->size, path );
-		goto BAIL;
+	_plInvalidateFileSystemIndexPath( dest );
+	_plPurgeFileCache( NULL, dest );
+
+	size_t total = 0;
+#if defined( __linux__ )
+	total = _plCopyFileRangeKernel( fileno( ptr->fptr ), offset, length, fileno( out ) );
+#endif
+
+	/* anything the kernel couldn't do for us */
+	if ( total < length ) {
+		uint8_t* buffer = pl_malloc( FS_COPY_CHUNK_SIZE );
+		while ( buffer != NULL && total < length ) {
+			size_t chunkLength = ( length - total > FS_COPY_CHUNK_SIZE ) ? FS_COPY_CHUNK_SIZE : length - total;
+			size_t numRead = plReadFileAt( ptr, buffer, 1, chunkLength, offset + total );
+			if ( numRead == 0 || fwrite( buffer, 1, numRead, out ) != numRead ) {
+				break;
+			}
+			total += numRead;
+		}
+		pl_free( buffer );
 	}
 
-	_pl_fclose( copy );
+	_pl_fclose( out );
 
-	plCloseFile( original );
-	return true;
+	if ( total != length ) {
+		ReportError( PL_RESULT_FILEWRITE, "failed to write out %lu bytes to %s", ( unsigned long ) length, dest );
+		return false;
+	}
 
-	BAIL:
+	return true;
+}
 
-	if ( copy != NULL ) {
-		_pl_fclose( copy );
+bool plCopyFile( const char* path, const char* dest ) {
+	/* uncached, so local files can be copied by the kernel */
+	PLFile* original = plOpenFile( path, false );
+	if ( original == NULL ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to open %s", path );
+		return false;
 	}
 
+	bool result = _plWriteFileRange( original, 0, original->size, dest );
+
 	plCloseFile( original );
-	return false;
+	return result;
 }
 
 size_t plGetLocalFileSize( const char* path ) {
@@ -850,15 +2123,279 @@ PLFile* plOpenLocalFile( const char* path, bool cache ) {
 		}
 		_pl_fclose( fp );
 	} else {
+		/* we do our own buffering, see _plFillFileBuffer */
+		setvbuf( fp, NULL, _IONBF, 0 );
 		ptr->fptr = fp;
+		ptr->buffer.maxLength = FS_DEFAULT_BUFFER_SIZE;
+	}
+
+	/* timestamp for local files is a special case */
+	ptr->timeStamp = -1;
+
+	return ptr;
+}
+
+/**
+ * Maps the given local file into memory rather than reading it in, so the
+ * contents are paged in on demand straight from the OS file cache. The
+ * returned handle behaves like a cached one for all of the read functions.
+ * The mapping is read-only, so the data must never be written to.
+ * @param path Path to the file you want to map.
+ * @return Returns handle to the file instance, or NULL on fail.
+ */
+PLFile* plMapLocalFile( const char* path ) {
+	/* the size is taken from the handle that's mapped, rather than the path,
+	 * so a file that's replaced in the meantime can't leave us mapping past
+	 * the end of it */
+	size_t size;
+	uint8_t* data;
+#if defined( _WIN32 )
+	HANDLE fileHandle = CreateFile( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( fileHandle == INVALID_HANDLE_VALUE ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to open %s (%s)", path, GetLastError_strerror( GetLastError() ) );
+		return NULL;
+	}
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( fileHandle, &fileSize ) ) {
+		ReportError( PL_RESULT_FILEERR, "failed to get size of %s (%s)", path, GetLastError_strerror( GetLastError() ) );
+		CloseHandle( fileHandle );
+		return NULL;
+	}
+
+	size = ( size_t ) fileSize.QuadPart;
+	if ( size == 0 ) {
+		/* can't map an empty file, so just fall back to a regular cached open */
+		CloseHandle( fileHandle );
+		return plOpenLocalFile( path, true );
+	}
+
+	HANDLE mapHandle = CreateFileMapping( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+	CloseHandle( fileHandle );
+	if ( mapHandle == NULL ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to map %s (%s)", path, GetLastError_strerror( GetLastError() ) );
+		return NULL;
+	}
+
+	/* the view keeps the mapping alive, so the handle can go now */
+	data = MapViewOfFile( mapHandle, FILE_MAP_READ, 0, 0, size );
+	CloseHandle( mapHandle );
+	if ( data == NULL ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to map %s (%s)", path, GetLastError_strerror( GetLastError() ) );
+		return NULL;
+	}
+#else
+	int fd = open( path, O_RDONLY );
+	if ( fd == -1 ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to open %s: %s", path, strerror( errno ) );
+		return NULL;
+	}
+
+	struct stat buf;
+	if ( fstat( fd, &buf ) != 0 ) {
+		ReportError( PL_RESULT_FILEERR, "failed to stat %s: %s", path, strerror( errno ) );
+		close( fd );
+		return NULL;
 	}
 
+	size = ( size_t ) buf.st_size;
+	if ( size == 0 ) {
+		/* can't map an empty file, so just fall back to a regular cached open */
+		close( fd );
+		return plOpenLocalFile( path, true );
+	}
+
+	data = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED ) {
+		ReportError( PL_RESULT_FILEREAD, "failed to map %s: %s", path, strerror( errno ) );
+		return NULL;
+	}
+#endif
+
+	PLFile* ptr = pl_calloc( 1, sizeof( PLFile ) );
+	snprintf( ptr->path, sizeof( ptr->path ), "%s", path );
+	ptr->size = size;
+	ptr->data = data;
+	ptr->pos = ptr->data;
+	ptr->isMapped = true;
+
 	/* timestamp for local files is a special case */
 	ptr->timeStamp = -1;
 
 	return ptr;
 }
 
+static void _plUnmapFileData( PLFile* ptr ) {
+#if defined( _WIN32 )
+	UnmapViewOfFile( ptr->data );
+#else
+	munmap( ptr->data, ptr->size );
+#endif
+	ptr->data = ptr->pos = NULL;
+	ptr->isMapped = false;
+}
+
+static PLFile* _plMapMountedFile( PLFileSystemMount* location, const char* path ) {
+	if ( location->type == FS_MOUNT_DIR ) {
+		/* todo: don't allow path to search outside of mounted path */
+		char buf[PL_SYSTEM_MAX_PATH + 1];
+		snprintf( buf, sizeof( buf ), "%s/%s", location->path, path );
+		return plLocalFileExists( buf ) ? plMapLocalFile( buf ) : NULL;
+	}
+
+	return plLoadPackageFileView( location->pkg, path );
+}
+
+/**
+ * Maps the specified file via the VFS. Files that live within a mounted
+ * package are returned as a view onto the package where possible (see
+ * plLoadPackageFileView), so the handle must be closed before the package
+ * is unmounted.
+ * @param path Path to the file you want to map.
+ * @return Returns handle to the file instance.
+ */
+PLFile* plMapFile( const char* path ) {
+	if ( plIsEmptyString( path ) ) {
+		ReportBasicError( PL_RESULT_FILEPATH );
+		return NULL;
+	}
+
+	if ( fs_mount_root == NULL ) {
+		return plMapLocalFile( path );
+	} else if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
+		path += sizeof( FS_LOCAL_HINT );
+		return plMapLocalFile( path );
+	}
+
+	PLFileSystemMount* mount;
+	bool isDirectory;
+	if ( _plLookupFileSystemIndex( path, &mount, &isDirectory ) ) {
+		if ( mount == NULL || isDirectory ) {
+			ReportError( PL_RESULT_FILEREAD, "failed to find %s", path );
+			return NULL;
+		}
+
+		return _plMapMountedFile( mount, path );
+	}
+
+	PLFileSystemMount* location = fs_mount_root;
+	while ( location != NULL ) {
+		PLFile* fp = _plMapMountedFile( location, path );
+		if ( fp == NULL ) {
+			location = location->next;
+			continue;
+		}
+
+		return fp;
+	}
+
+	ReportError( PL_RESULT_FILEREAD, "failed to find %s", path );
+	return NULL;
+}
+
+bool _plGetLocalFileModTime( const char* path, int64_t* modTime ) {
+	struct stat st;
+	if ( stat( path, &st ) != 0 || !S_ISREG( st.st_mode ) ) {
+		return false;
+	}
+
+	/* to the nanosecond where we can, so rewrites within the same second are still caught */
+#if defined( __linux__ )
+	*modTime = ( int64_t ) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#elif defined( __APPLE__ )
+	*modTime = ( int64_t ) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	*modTime = ( int64_t ) st.st_mtime * 1000000000;
+#endif
+	return true;
+}
+
+#if defined( _WIN32 )
+static bool _plGetLocalFileIdentity( const char* path, BY_HANDLE_FILE_INFORMATION* info ) {
+	HANDLE handle = CreateFile( path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( handle == INVALID_HANDLE_VALUE ) {
+		return false;
+	}
+
+	bool result = GetFileInformationByHandle( handle, info );
+	CloseHandle( handle );
+	return result;
+}
+#endif
+
+/**
+ * Checks whether both paths lead to the same file on disk, regardless of
+ * how they're spelt, or whether either is a link to the other.
+ * @return False if either doesn't exist.
+ */
+bool _plIsSameLocalFile( const char* pathA, const char* pathB ) {
+#if defined( _WIN32 )
+	BY_HANDLE_FILE_INFORMATION infoA, infoB;
+	if ( !_plGetLocalFileIdentity( pathA, &infoA ) || !_plGetLocalFileIdentity( pathB, &infoB ) ) {
+		return false;
+	}
+
+	return ( infoA.dwVolumeSerialNumber == infoB.dwVolumeSerialNumber &&
+	         infoA.nFileIndexHigh == infoB.nFileIndexHigh && infoA.nFileIndexLow == infoB.nFileIndexLow );
+#else
+	struct stat stA, stB;
+	if ( stat( pathA, &stA ) != 0 || stat( pathB, &stB ) != 0 ) {
+		return false;
+	}
+
+	return ( stA.st_dev == stB.st_dev && stA.st_ino == stB.st_ino );
+#endif
+}
+
+/**
+ * Opens the given local file via the content cache, if it's enabled.
+ */
+static PLFile* _plOpenLocalFile( const char* path, bool cache ) {
+	int64_t modTime;
+	if ( !cache || !_plIsFileCacheEnabled() || !_plGetLocalFileModTime( path, &modTime ) ) {
+		return plOpenLocalFile( path, cache );
+	}
+
+	PLFile* file = _plOpenCachedFile( NULL, path, modTime );
+	if ( file != NULL ) {
+		return file;
+	}
+
+	if ( ( file = plOpenLocalFile( path, true ) ) != NULL ) {
+		_plInsertCachedFile( NULL, path, modTime, file );
+	}
+
+	return file;
+}
+
+static PLFile* _plOpenMountedFile( PLFileSystemMount* location, const char* path, bool cache ) {
+	if ( location->type == FS_MOUNT_DIR ) {
+		/* todo: don't allow path to search outside of mounted path */
+		char buf[PL_SYSTEM_MAX_PATH + 1];
+		snprintf( buf, sizeof( buf ), "%s/%s", location->path, path );
+		return _plOpenLocalFile( buf, cache );
+	}
+
+	const PLPackageIndex* index;
+	if ( !cache || !_plIsFileCacheEnabled() || ( index = plGetPackageIndex( location->pkg, path ) ) == NULL ) {
+		return plLoadPackageFile( location->pkg, path );
+	}
+
+	/* packages don't change while mounted, so key on the name as stored */
+	const char* name = plGetPackageFileName( location->pkg, ( unsigned int ) ( index - location->pkg->table ) );
+	PLFile* file = _plOpenCachedFile( location, name, 0 );
+	if ( file != NULL ) {
+		return file;
+	}
+
+	if ( ( file = plLoadPackageFile( location->pkg, path ) ) != NULL ) {
+		_plInsertCachedFile( location, name, 0, file );
+	}
+
+	return file;
+}
+
 /**
  * Opens the specified file via the VFS.
  * @param path Path to the file you want to open.
@@ -872,24 +2409,26 @@ PLFile* plOpenFile( const char* path, bool cache ) {
 	}
 
 	if ( fs_mount_root == NULL ) {
-	    return plOpenLocalFile( path, cache );
+	    return _plOpenLocalFile( path, cache );
 	} else if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
 		path += sizeof( FS_LOCAL_HINT );
-		return plOpenLocalFile( path, cache );
+		return _plOpenLocalFile( path, cache );
 	}
 
-	char buf[PL_SYSTEM_MAX_PATH + 1];
-	PLFileSystemMount* location = fs_mount_root;
-	while ( location != NULL ) {
-		PLFile* fp;
-		if ( location->type == FS_MOUNT_DIR ) {
-			/* todo: don't allow path to search outside of mounted path */
-			snprintf( buf, sizeof( buf ), "%s/%s", location->path, path );
-			fp = plOpenLocalFile( buf, cache );
-		} else {
-			fp = plLoadPackageFile( location->pkg, path );
+	PLFileSystemMount* mount;
+	bool isDirectory;
+	if ( _plLookupFileSystemIndex( path, &mount, &isDirectory ) ) {
+		if ( mount == NULL || isDirectory ) {
+			ReportError( PL_RESULT_FILEREAD, "failed to find %s", path );
+			return NULL;
 		}
 
+		return _plOpenMountedFile( mount, path, cache );
+	}
+
+	PLFileSystemMount* location = fs_mount_root;
+	while ( location != NULL ) {
+		PLFile* fp = _plOpenMountedFile( location, path, cache );
 		if ( fp == NULL ) {
 			location = location->next;
 			continue;
@@ -912,7 +2451,16 @@ void plCloseFile( PLFile* ptr ) {
 		_pl_fclose( ptr->fptr );
 	}
 
-	pl_free( ptr->data );
+	pl_free( ptr->buffer.data );
+
+	if ( ptr->cacheEntry != NULL ) {
+		_plReleaseCachedFile( ptr );
+	} else if ( ptr->isMapped ) {
+		_plUnmapFileData( ptr );
+	} else if ( !ptr->isView ) {
+		pl_free( ptr->data );
+	}
+
 	pl_free( ptr );
 }
 
@@ -935,10 +2483,7 @@ const uint8_t* plGetFileData( const PLFile* ptr ) {
  * @return Number of bytes within file.
  */
 size_t plGetFileSize( const PLFile* ptr ) {
-	if ( ptr->fptr != NULL ) {
-		return plGetLocalFileSize( ptr->path );
-	}
-
+	/* size of uncached files is fetched when they're opened */
 	return ptr->size;
 }
 
@@ -949,12 +2494,86 @@ size_t plGetFileSize( const PLFile* ptr ) {
  */
 size_t plGetFileOffset( const PLFile* ptr ) {
 	if ( ptr->fptr != NULL ) {
-		return ftell( ptr->fptr );
+		return ptr->offset;
 	}
 
 	return ptr->pos - ptr->data;
 }
 
+/**
+ * Sets the size of the read buffer used by an uncached file. Larger
+ * buffers mean fewer calls into the OS when scanning through a file.
+ * @param ptr Pointer to the file handle.
+ * @param size Size of the buffer in bytes.
+ * @return False if the file isn't uncached or the size is invalid.
+ */
+bool plSetFileBufferSize( PLFile* ptr, size_t size ) {
+	if ( ptr->fptr == NULL ) {
+		ReportError( PL_RESULT_INVALID_PARM1, "file is cached, no buffer to resize" );
+		return false;
+	}
+
+	if ( size == 0 ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM2 );
+		return false;
+	}
+
+	/* allocated again on the next read */
+	pl_free( ptr->buffer.data );
+	ptr->buffer.data = NULL;
+	ptr->buffer.maxLength = size;
+	ptr->buffer.length = 0;
+
+	return true;
+}
+
+/**
+ * Ensures the buffer for an uncached file holds the current position,
+ * reading in the next block from the file if it doesn't.
+ * @return Number of bytes available in the buffer from the current position.
+ */
+static size_t _plFillFileBuffer( PLFile* ptr ) {
+	if ( ptr->offset >= ptr->buffer.offset && ptr->offset < ptr->buffer.offset + ptr->buffer.length ) {
+		return ptr->buffer.offset + ptr->buffer.length - ptr->offset;
+	}
+
+	if ( ptr->buffer.data == NULL ) {
+		ptr->buffer.data = pl_malloc( ptr->buffer.maxLength );
+		if ( ptr->buffer.data == NULL ) {
+			return 0;
+		}
+	}
+
+	ptr->buffer.offset = ptr->offset;
+	ptr->buffer.length = plReadFileAt( ptr, ptr->buffer.data, 1, ptr->buffer.maxLength, ptr->offset );
+	return ptr->buffer.length;
+}
+
+static size_t _plReadBufferedFile( PLFile* ptr, uint8_t* dest, size_t length ) {
+	size_t total = 0;
+	while ( total < length ) {
+		size_t available = _plFillFileBuffer( ptr );
+		if ( available == 0 ) {
+			break;
+		}
+
+		/* large reads skip the buffer once whatever it holds is used up */
+		if ( available == ptr->buffer.length && length - total >= ptr->buffer.maxLength ) {
+			size_t numRead = plReadFileAt( ptr, dest + total, 1, length - total, ptr->offset );
+			ptr->offset += numRead;
+			total += numRead;
+			break;
+		}
+
+		size_t numCopy = ( length - total < available ) ? length - total : available;
+		memcpy( dest + total, ptr->buffer.data + ( ptr->offset - ptr->buffer.offset ), numCopy );
+		ptr->offset += numCopy;
+		total += numCopy;
+	}
+
+	return total;
+}
+
 size_t plReadFile( PLFile* ptr, void* dest, size_t size, size_t count ) {
 	/* bail early if size is 0 to avoid division by 0 */
 	if ( size == 0 ) {
@@ -963,7 +2582,7 @@ size_t plReadFile( PLFile* ptr, void* dest, size_t size, size_t count ) {
 	}
 
 	if ( ptr->fptr != NULL ) {
-		return fread( dest, size, count, ptr->fptr );
+		return _plReadBufferedFile( ptr, dest, size * count ) / size;
 	}
 
 	/* ensure that the read is valid */
@@ -979,6 +2598,71 @@ size_t plReadFile( PLFile* ptr, void* dest, size_t size, size_t count ) {
 	return length / size;
 }
 
+/**
+ * Reads from the given offset in the file without touching the current
+ * position, so multiple threads can safely read from the same handle.
+ * @param ptr Pointer to the file handle.
+ * @param dest Destination buffer.
+ * @param size Size of each element.
+ * @param count Number of elements to read.
+ * @param offset Offset into the file to read from.
+ * @return Number of elements read.
+ */
+size_t plReadFileAt( PLFile* ptr, void* dest, size_t size, size_t count, size_t offset ) {
+	/* bail early if size is 0 to avoid division by 0 */
+	if ( size == 0 ) {
+		ReportBasicError( PL_RESULT_FILESIZE );
+		return 0;
+	}
+
+	size_t length = size * count;
+	if ( ptr->fptr != NULL ) {
+		size_t total = 0;
+#if defined( _WIN32 )
+		HANDLE handle = ( HANDLE ) _get_osfhandle( _fileno( ptr->fptr ) );
+
+		/* each read carries its own offset, like pread. The handle isn't
+		 * opened for overlapped I/O, so ReadFile still moves the file
+		 * pointer, but nothing relies on it as the handle tracks its own
+		 * position, and saving and restoring it would race other readers */
+		while ( total < length ) {
+			OVERLAPPED overlapped;
+			memset( &overlapped, 0, sizeof( OVERLAPPED ) );
+			overlapped.Offset = ( DWORD ) ( ( offset + total ) & 0xFFFFFFFF );
+			overlapped.OffsetHigh = ( DWORD ) ( ( uint64_t ) ( offset + total ) >> 32 );
+
+			DWORD numRead;
+			if ( !ReadFile( handle, ( uint8_t* ) dest + total, ( DWORD ) ( length - total ), &numRead, &overlapped ) || numRead == 0 ) {
+				break;
+			}
+			total += numRead;
+		}
+#else
+		int fd = fileno( ptr->fptr );
+		while ( total < length ) {
+			ssize_t numRead = pread( fd, ( uint8_t* ) dest + total, length - total, ( off_t ) ( offset + total ) );
+			if ( numRead < 0 && errno == EINTR ) {
+				continue;
+			} else if ( numRead <= 0 ) {
+				break;
+			}
+			total += ( size_t ) numRead;
+		}
+#endif
+		return total / size;
+	}
+
+	if ( offset >= ptr->size ) {
+		return 0;
+	} else if ( offset + length > ptr->size ) {
+		/* out of bounds, truncate it */
+		length = ptr->size - offset;
+	}
+
+	memcpy( dest, ptr->data + offset, length );
+	return length / size;
+}
+
 char plReadInt8( PLFile* ptr, bool* status ) {
 	if ( plGetFileOffset( ptr ) >= ptr->size ) {
 		if ( status != NULL ) {
@@ -992,7 +2676,14 @@ char plReadInt8( PLFile* ptr, bool* status ) {
 	}
 
 	if ( ptr->fptr != NULL ) {
-		return ( char ) ( fgetc( ptr->fptr ) );
+		if ( _plFillFileBuffer( ptr ) == 0 ) {
+			if ( status != NULL ) {
+				*status = false;
+			}
+			return 0;
+		}
+
+		return ( char ) ptr->buffer.data[ ptr->offset++ - ptr->buffer.offset ];
 	}
 
 	return ( char ) *( ptr->pos++ );
@@ -1041,6 +2732,127 @@ int64_t plReadInt64( PLFile* ptr, bool big_endian, bool* status ) {
 	return ReadSizedInteger( ptr, sizeof( int64_t ), big_endian, status );
 }
 
+/**
+ * Byte swapping for arrays of 16-bit elements, vectorised where possible.
+ */
+static void _plSwapBytes16( uint16_t* data, size_t count ) {
+	size_t i = 0;
+#if defined( PL_SIMD_SSE2 )
+	for ( ; i + 8 <= count; i += 8 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i* ) &data[ i ] );
+		v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+		_mm_storeu_si128( ( __m128i* ) &data[ i ], v );
+	}
+#elif defined( PL_SIMD_NEON )
+	for ( ; i + 8 <= count; i += 8 ) {
+		vst1q_u8( ( uint8_t* ) &data[ i ], vrev16q_u8( vld1q_u8( ( const uint8_t* ) &data[ i ] ) ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		data[ i ] = ( uint16_t ) ( ( data[ i ] << 8 ) | ( data[ i ] >> 8 ) );
+	}
+}
+
+/**
+ * Byte swapping for arrays of 32-bit elements, vectorised where possible.
+ */
+static void _plSwapBytes32( uint32_t* data, size_t count ) {
+	size_t i = 0;
+#if defined( PL_SIMD_SSE2 )
+	for ( ; i + 4 <= count; i += 4 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i* ) &data[ i ] );
+		/* swap each pair of 16-bit words, then the bytes within each word */
+		v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+		_mm_storeu_si128( ( __m128i* ) &data[ i ], v );
+	}
+#elif defined( PL_SIMD_NEON )
+	for ( ; i + 4 <= count; i += 4 ) {
+		vst1q_u8( ( uint8_t* ) &data[ i ], vrev32q_u8( vld1q_u8( ( const uint8_t* ) &data[ i ] ) ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		uint32_t n = data[ i ];
+		data[ i ] = ( n >> 24 ) | ( ( n >> 8 ) & 0xFF00 ) | ( ( n << 8 ) & 0xFF0000 ) | ( n << 24 );
+	}
+}
+
+static bool _plIsHostBigEndian( void ) {
+	const uint16_t n = 1;
+	return ( *( const uint8_t* ) &n == 0 );
+}
+
+static size_t _plReadSwappedArray( PLFile* ptr, void* dest, size_t size, size_t count, bool big_endian ) {
+	size_t numRead = plReadFile( ptr, dest, size, count );
+	if ( big_endian != _plIsHostBigEndian() ) {
+		if ( size == sizeof( uint16_t ) ) {
+			_plSwapBytes16( dest, numRead );
+		} else {
+			_plSwapBytes32( dest, numRead );
+		}
+	}
+
+	return numRead;
+}
+
+/**
+ * Reads an array of 16-bit integers, converting them from the given
+ * byte order to the host's.
+ * @return Number of elements read.
+ */
+size_t plReadInt16Array( PLFile* ptr, int16_t* dest, size_t count, bool big_endian ) {
+	return _plReadSwappedArray( ptr, dest, sizeof( int16_t ), count, big_endian );
+}
+
+size_t plReadInt32Array( PLFile* ptr, int32_t* dest, size_t count, bool big_endian ) {
+	return _plReadSwappedArray( ptr, dest, sizeof( int32_t ), count, big_endian );
+}
+
+size_t plReadFloatArray( PLFile* ptr, float* dest, size_t count, bool big_endian ) {
+	return _plReadSwappedArray( ptr, dest, sizeof( float ), count, big_endian );
+}
+
+static bool _plWriteSwappedArray( FILE* fp, const void* src, size_t size, size_t count, bool big_endian ) {
+	if ( big_endian == _plIsHostBigEndian() ) {
+		return ( fwrite( src, size, count, fp ) == count );
+	}
+
+	/* swap in chunks, so we don't need to touch the source */
+	uint32_t buf[ 1024 ];
+	size_t numElements = sizeof( buf ) / size;
+	for ( size_t i = 0; i < count; i += numElements ) {
+		size_t n = ( count - i < numElements ) ? count - i : numElements;
+		memcpy( buf, ( const uint8_t* ) src + i * size, n * size );
+		if ( size == sizeof( uint16_t ) ) {
+			_plSwapBytes16( ( uint16_t* ) buf, n );
+		} else {
+			_plSwapBytes32( buf, n );
+		}
+
+		if ( fwrite( buf, size, n, fp ) != n ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Writes an array of 16-bit integers in the given byte order.
+ * @return False if the write failed.
+ */
+bool plWriteInt16Array( FILE* fp, const int16_t* src, size_t count, bool big_endian ) {
+	return _plWriteSwappedArray( fp, src, sizeof( int16_t ), count, big_endian );
+}
+
+bool plWriteInt32Array( FILE* fp, const int32_t* src, size_t count, bool big_endian ) {
+	return _plWriteSwappedArray( fp, src, sizeof( int32_t ), count, big_endian );
+}
+
+bool plWriteFloatArray( FILE* fp, const float* src, size_t count, bool big_endian ) {
+	return _plWriteSwappedArray( fp, src, sizeof( float ), count, big_endian );
+}
+
 char* plReadString( PLFile* ptr, char* str, size_t size ) {
 	if ( size == 0 ) {
 		ReportBasicError( PL_RESULT_INVALID_PARM3 );
@@ -1048,7 +2860,36 @@ char* plReadString( PLFile* ptr, char* str, size_t size ) {
 	}
 
 	if ( ptr->fptr != NULL ) {
-		return fgets( str, (int)size, ptr->fptr );
+		/* same behaviour as fgets */
+		size_t length = 0;
+		while ( length < size - 1 ) {
+			size_t available = _plFillFileBuffer( ptr );
+			if ( available == 0 ) {
+				break;
+			}
+
+			const uint8_t* start = ptr->buffer.data + ( ptr->offset - ptr->buffer.offset );
+			size_t numCopy = ( size - 1 - length < available ) ? size - 1 - length : available;
+			const uint8_t* nl = memchr( start, '\n', numCopy );
+			if ( nl != NULL ) {
+				numCopy = ( size_t ) ( nl - start ) + 1;
+			}
+
+			memcpy( str + length, start, numCopy );
+			ptr->offset += numCopy;
+			length += numCopy;
+
+			if ( nl != NULL ) {
+				break;
+			}
+		}
+
+		if ( length == 0 ) {
+			return NULL;
+		}
+
+		str[ length ] = '\0';
+		return str;
 	}
 
 	if ( ptr->pos >= ptr->data + ptr->size ) {
@@ -1075,12 +2916,22 @@ char* plReadString( PLFile* ptr, char* str, size_t size ) {
 
 bool plFileSeek( PLFile* ptr, long int pos, PLFileSeek seek ) {
 	if ( ptr->fptr != NULL ) {
-		int err = fseek( ptr->fptr, pos, seek );
-		if ( err != 0 ) {
-			ReportError( PL_RESULT_FILEREAD, "failed to seek file (%s)", GetLastError_strerror( GetLastError() ) );
+		/* same rules as fseek, so it's fine to seek past the end */
+		long int base;
+		switch ( seek ) {
+			case PL_SEEK_CUR: base = ( long int ) ptr->offset; break;
+			case PL_SEEK_SET: base = 0; break;
+			case PL_SEEK_END: base = ( long int ) ptr->size; break;
+			default:ReportBasicError( PL_RESULT_INVALID_PARM3 );
+				return false;
+		}
+
+		if ( base + pos < 0 ) {
+			ReportBasicError( PL_RESULT_INVALID_PARM2 );
 			return false;
 		}
 
+		ptr->offset = ( size_t ) ( base + pos );
 		return true;
 	}
 
@@ -1119,7 +2970,7 @@ bool plFileSeek( PLFile* ptr, long int pos, PLFileSeek seek ) {
 
 void plRewindFile( PLFile* ptr ) {
 	if ( ptr->fptr != NULL ) {
-		rewind( ptr->fptr );
+		ptr->offset = 0;
 		return;
 	}
 
@@ -0,0 +1,799 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "filesystem_private.h"
+#include "platform_private.h"
+#include "thread_private.h"
+
+#if defined( PL_USE_IO_URING )
+#	include <linux/io_uring.h>
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	include <errno.h>
+#	include <sched.h>
+#	include <time.h>
+#	if !defined( __NR_io_uring_setup ) || !defined( __NR_io_uring_enter )
+#		undef PL_USE_IO_URING
+#	endif
+#endif
+
+/*	Asynchronous File I/O	*/
+
+/* upper limit on threads servicing requests the kernel queue can't take */
+#define FS_ASYNC_MAX_WORKERS    8
+/* number of submission queue entries requested from io_uring */
+#define FS_ASYNC_QUEUE_DEPTH    256
+/* largest single read handed to the kernel, longer ones are resubmitted */
+#define FS_ASYNC_MAX_READ       ( 1U << 30 )
+/* times a submission is retried while the kernel is short on resources */
+#define FS_ASYNC_MAX_SUBMIT_ATTEMPTS    16
+
+typedef enum FSRequestType {
+	FS_REQUEST_OPEN,
+	FS_REQUEST_READ,
+	FS_REQUEST_WRITE
+} FSRequestType;
+
+struct PLFileRequest {
+	FSRequestType type;
+	PLFileRequestStatus status;     /* only changes under fs_async.mutex */
+	PLFileRequestStatus result;     /* set before the callback runs */
+
+	char path[ PL_SYSTEM_MAX_PATH ];
+	bool cache;
+
+	PLFile* file;
+	uint8_t* dest;
+	const uint8_t* src;
+	size_t length;
+	size_t offset;
+	size_t numRead;
+
+	PLFileRequestCallback Callback;
+	void* userData;
+
+	struct PLFileRequest* next;
+#if defined( PL_USE_IO_URING )
+	struct PLFileRequest *ringPrev, *ringNext;  /* while owned by the kernel queue */
+#endif
+};
+
+#if defined( PL_USE_IO_URING )
+typedef struct FSRing {
+	bool isActive;
+	bool hasFailed;         /* setup or the reaper failed, e.g. blocked by seccomp, don't retry */
+	int fd;
+	unsigned int numEntries;
+	unsigned int numInFlight;
+
+	void* sqRing;
+	size_t sqRingSize;
+	void* cqRing;
+	size_t cqRingSize;
+	struct io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned int *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe* cqes;
+
+	PLFileRequest* inFlight;
+
+	PLThread reaper;
+} FSRing;
+#endif
+
+static struct {
+	bool isInitialized;
+	bool isShuttingDown;
+
+	PLMutex mutex;
+	PLCondition workCondition;      /* signalled when a request is queued for the workers */
+	PLCondition doneCondition;      /* broadcast whenever a request completes */
+
+	PLFileRequest *head, *tail;
+	unsigned int numPending;        /* queued or in flight */
+
+	PLThread workers[ FS_ASYNC_MAX_WORKERS ];
+	unsigned int numWorkers;
+
+#if defined( PL_USE_IO_URING )
+	FSRing ring;
+#endif
+} fs_async;
+
+/**
+ * Finishes off the given request, running its callback before
+ * anyone waiting on it is woken.
+ */
+static void _plCompleteFileRequest( PLFileRequest* request, PLFileRequestStatus result ) {
+	request->result = result;
+	if ( request->Callback != NULL ) {
+		request->Callback( request, request->userData );
+	}
+
+	_plLockMutex( &fs_async.mutex );
+	request->status = result;
+	fs_async.numPending--;
+	_plBroadcastCondition( &fs_async.doneCondition );
+	_plUnlockMutex( &fs_async.mutex );
+}
+
+static void _plProcessFileRequest( PLFileRequest* request ) {
+	switch ( request->type ) {
+		case FS_REQUEST_OPEN:
+			request->file = plOpenFile( request->path, request->cache );
+			_plCompleteFileRequest( request, ( request->file != NULL ) ? PL_FILE_REQUEST_COMPLETE : PL_FILE_REQUEST_FAILED );
+			break;
+		case FS_REQUEST_READ:
+			request->numRead += plReadFileAt( request->file, request->dest + request->numRead, 1,
+			                                  request->length - request->numRead, request->offset + request->numRead );
+			_plCompleteFileRequest( request, ( request->numRead > 0 || request->length == 0 ) ? PL_FILE_REQUEST_COMPLETE : PL_FILE_REQUEST_FAILED );
+			break;
+		case FS_REQUEST_WRITE:
+			if ( !plWriteFile( request->path, request->src, request->length ) ) {
+				_plCompleteFileRequest( request, PL_FILE_REQUEST_FAILED );
+				break;
+			}
+			request->numRead = request->length;
+			_plCompleteFileRequest( request, PL_FILE_REQUEST_COMPLETE );
+			break;
+	}
+}
+
+static void _plFileRequestWorker( void* userData ) {
+	( void ) userData;
+
+	_plLockMutex( &fs_async.mutex );
+	for ( ;; ) {
+		while ( fs_async.head == NULL && !fs_async.isShuttingDown ) {
+			_plWaitCondition( &fs_async.workCondition, &fs_async.mutex );
+		}
+
+		PLFileRequest* request = fs_async.head;
+		if ( request == NULL ) {
+			break;
+		}
+
+		fs_async.head = request->next;
+		if ( fs_async.head == NULL ) {
+			fs_async.tail = NULL;
+		}
+		_plUnlockMutex( &fs_async.mutex );
+
+		_plProcessFileRequest( request );
+
+		_plLockMutex( &fs_async.mutex );
+	}
+	_plUnlockMutex( &fs_async.mutex );
+}
+
+/**
+ * Spins up the worker pool if it's not running yet.
+ * Expects fs_async.mutex to be held.
+ */
+static bool _plStartFileRequestWorkers( void ) {
+	if ( fs_async.numWorkers > 0 ) {
+		return true;
+	}
+
+	unsigned int numWorkers = _plGetNumProcessors();
+	if ( numWorkers < 2 ) {
+		numWorkers = 2;
+	} else if ( numWorkers > FS_ASYNC_MAX_WORKERS ) {
+		numWorkers = FS_ASYNC_MAX_WORKERS;
+	}
+
+	for ( unsigned int i = 0; i < numWorkers; ++i ) {
+		if ( !_plCreateThread( &fs_async.workers[ fs_async.numWorkers ], _plFileRequestWorker, NULL ) ) {
+			break;
+		}
+		fs_async.numWorkers++;
+	}
+
+	return ( fs_async.numWorkers > 0 );
+}
+
+/**
+ * Hands the request over to the worker pool.
+ * Expects fs_async.mutex to be held.
+ */
+static bool _plQueueFileRequest( PLFileRequest* request ) {
+	if ( !_plStartFileRequestWorkers() ) {
+		return false;
+	}
+
+	request->next = NULL;
+	if ( fs_async.tail != NULL ) {
+		fs_async.tail->next = request;
+	} else {
+		fs_async.head = request;
+	}
+	fs_async.tail = request;
+
+	_plSignalCondition( &fs_async.workCondition );
+	return true;
+}
+
+#if defined( PL_USE_IO_URING )
+
+static int _plRingEnter( unsigned int toSubmit, unsigned int minComplete, unsigned int flags ) {
+	return ( int ) syscall( __NR_io_uring_enter, fs_async.ring.fd, toSubmit, minComplete, flags, NULL, 0 );
+}
+
+/**
+ * Takes the request off the list of those held by the kernel.
+ * Expects fs_async.mutex to be held.
+ */
+static void _plUnlinkRingRequest( PLFileRequest* request ) {
+	if ( request->ringPrev != NULL ) {
+		request->ringPrev->ringNext = request->ringNext;
+	} else {
+		fs_async.ring.inFlight = request->ringNext;
+	}
+	if ( request->ringNext != NULL ) {
+		request->ringNext->ringPrev = request->ringPrev;
+	}
+	request->ringPrev = request->ringNext = NULL;
+}
+
+/**
+ * Pushes an entry onto the submission queue and tells the kernel about it.
+ * If the kernel won't take it, it's taken back off the queue again.
+ * Expects fs_async.mutex to be held.
+ */
+static bool _plSubmitRingEntry( uint8_t opcode, int fd, void* dest, size_t length, size_t offset, PLFileRequest* request ) {
+	FSRing* ring = &fs_async.ring;
+	if ( ring->hasFailed || ring->numInFlight >= ring->numEntries ) {
+		return false;
+	}
+
+	/* we're the only producer, so no need for an acquire on our own tail */
+	unsigned int tail = *ring->sqTail;
+	unsigned int index = tail & *ring->sqMask;
+
+	struct io_uring_sqe* sqe = &ring->sqes[ index ];
+	memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = ( uint64_t ) ( uintptr_t ) dest;
+	sqe->len = ( uint32_t ) ( ( length > FS_ASYNC_MAX_READ ) ? FS_ASYNC_MAX_READ : length );
+	sqe->off = ( uint64_t ) offset;
+	sqe->user_data = ( uint64_t ) ( uintptr_t ) request;
+
+	ring->sqArray[ index ] = index;
+
+	if ( request != NULL ) {
+		request->ringPrev = NULL;
+		request->ringNext = ring->inFlight;
+		if ( ring->inFlight != NULL ) {
+			ring->inFlight->ringPrev = request;
+		}
+		ring->inFlight = request;
+	}
+
+	__atomic_store_n( ring->sqTail, tail + 1, __ATOMIC_RELEASE );
+
+	int result, error = 0;
+	unsigned int numAttempts = 0;
+	for ( ;; ) {
+		if ( ( result = _plRingEnter( 1, 0, 0 ) ) >= 0 ) {
+			break;
+		}
+
+		error = errno;
+		if ( error == EINTR ) {
+			continue;
+		} else if ( ( error == EAGAIN || error == EBUSY ) && ++numAttempts < FS_ASYNC_MAX_SUBMIT_ATTEMPTS ) {
+			sched_yield();
+			continue;
+		}
+		break;
+	}
+
+	/* entries are only picked up while we're in io_uring_enter, and each is
+	 * either taken or pulled back here, so if the head hasn't moved past it
+	 * the kernel never saw it and it's safe to take back */
+	if ( __atomic_load_n( ring->sqHead, __ATOMIC_ACQUIRE ) == tail ) {
+		__atomic_store_n( ring->sqTail, tail, __ATOMIC_RELEASE );
+		if ( request != NULL ) {
+			_plUnlinkRingRequest( request );
+		}
+
+		FSLog( "io_uring submission failed: %s\n", ( result < 0 ) ? strerror( error ) : "entry wasn't taken" );
+		return false;
+	}
+
+	ring->numInFlight++;
+	return true;
+}
+
+static bool _plSubmitRingRead( PLFileRequest* request ) {
+	return _plSubmitRingEntry( IORING_OP_READ, fileno( request->file->fptr ), request->dest + request->numRead,
+	                           request->length - request->numRead, request->offset + request->numRead, request );
+}
+
+/**
+ * Carries on with a read the kernel has only partly dealt with, handing
+ * it over to the workers if it can't go back on the queue.
+ * Expects fs_async.mutex to be held.
+ */
+static bool _plContinueRingRead( PLFileRequest* request ) {
+	return _plSubmitRingRead( request ) || _plQueueFileRequest( request );
+}
+
+static void _plHandleRingCompletion( PLFileRequest* request, int result ) {
+	_plLockMutex( &fs_async.mutex );
+	fs_async.ring.numInFlight--;
+	_plUnlinkRingRequest( request );
+
+	bool isHandedOff = false, hasFailed = false;
+	if ( result == -EINVAL || result == -EOPNOTSUPP ) {
+		/* kernel predates IORING_OP_READ, let the workers deal with it */
+		isHandedOff = _plQueueFileRequest( request );
+		hasFailed = !isHandedOff;
+	} else if ( result == -EINTR || result == -EAGAIN ) {
+		isHandedOff = _plContinueRingRead( request );
+		hasFailed = !isHandedOff;
+	} else if ( result > 0 ) {
+		request->numRead += ( size_t ) result;
+		/* short read, carry on from where it left off until we hit the end */
+		if ( request->numRead < request->length ) {
+			isHandedOff = _plContinueRingRead( request );
+			hasFailed = !isHandedOff;
+		}
+	}
+	_plUnlockMutex( &fs_async.mutex );
+
+	if ( isHandedOff ) {
+		return;
+	}
+
+	_plCompleteFileRequest( request, ( !hasFailed && ( request->numRead > 0 || request->length == 0 ) ) ? PL_FILE_REQUEST_COMPLETE : PL_FILE_REQUEST_FAILED );
+}
+
+/**
+ * Returns the number of reads the kernel still holds.
+ */
+static unsigned int _plGetNumRingReads( void ) {
+	_plLockMutex( &fs_async.mutex );
+	unsigned int numInFlight = fs_async.ring.numInFlight;
+	_plUnlockMutex( &fs_async.mutex );
+	return numInFlight;
+}
+
+static void _plRingReaper( void* userData ) {
+	( void ) userData;
+
+	FSRing* ring = &fs_async.ring;
+	bool isRunning = true;
+	while ( isRunning ) {
+		if ( !ring->hasFailed && _plRingEnter( 0, 1, IORING_ENTER_GETEVENTS ) < 0 && errno != EINTR ) {
+			PrintError( "io_uring_enter failed: %s\n", strerror( errno ) );
+
+			/* nothing new goes on the queue from here on, and anything that
+			 * can't go back on it when it completes is handed to the workers */
+			_plLockMutex( &fs_async.mutex );
+			ring->hasFailed = true;
+			_plUnlockMutex( &fs_async.mutex );
+		}
+
+		unsigned int head = *ring->cqHead;
+		unsigned int tail = __atomic_load_n( ring->cqTail, __ATOMIC_ACQUIRE );
+		if ( ring->hasFailed && head == tail ) {
+			/* the kernel may still be writing into whatever it's already
+			 * taken, so those have to be seen through before we can go, but
+			 * without being able to block on it that means polling */
+			if ( _plGetNumRingReads() == 0 ) {
+				break;
+			}
+
+			struct timespec delay = { 0, 1000000 };
+			nanosleep( &delay, NULL );
+			continue;
+		}
+
+		while ( head != tail ) {
+			struct io_uring_cqe* cqe = &ring->cqes[ head & *ring->cqMask ];
+			PLFileRequest* request = ( PLFileRequest* ) ( uintptr_t ) cqe->user_data;
+			int result = cqe->res;
+
+			/* hand the slot back before doing anything that might resubmit */
+			__atomic_store_n( ring->cqHead, ++head, __ATOMIC_RELEASE );
+
+			if ( request == NULL ) {
+				/* wake-up sent on shutdown */
+				isRunning = false;
+				continue;
+			}
+
+			_plHandleRingCompletion( request, result );
+		}
+	}
+}
+
+static void _plCloseRing( void ) {
+	FSRing* ring = &fs_async.ring;
+	if ( ring->sqes != NULL ) {
+		munmap( ring->sqes, ring->sqesSize );
+	}
+	if ( ring->cqRing != NULL && ring->cqRing != ring->sqRing ) {
+		munmap( ring->cqRing, ring->cqRingSize );
+	}
+	if ( ring->sqRing != NULL ) {
+		munmap( ring->sqRing, ring->sqRingSize );
+	}
+	if ( ring->fd >= 0 ) {
+		close( ring->fd );
+	}
+
+	bool hasFailed = ring->hasFailed;
+	memset( ring, 0, sizeof( FSRing ) );
+	ring->fd = -1;
+	ring->hasFailed = hasFailed;
+}
+
+/**
+ * Sets up the io_uring queue on first use. If the kernel doesn't support it,
+ * or it's been disabled, everything goes through the worker pool instead.
+ * Expects fs_async.mutex to be held.
+ */
+static bool _plStartRing( void ) {
+	FSRing* ring = &fs_async.ring;
+	if ( ring->hasFailed ) {
+		return false;
+	} else if ( ring->isActive ) {
+		return true;
+	}
+
+	struct io_uring_params params;
+	memset( &params, 0, sizeof( struct io_uring_params ) );
+	ring->fd = ( int ) syscall( __NR_io_uring_setup, FS_ASYNC_QUEUE_DEPTH, &params );
+	if ( ring->fd < 0 ) {
+		FSLog( "io_uring unavailable (%s), using worker threads for async I/O\n", strerror( errno ) );
+		ring->hasFailed = true;
+		return false;
+	}
+
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned int );
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	bool isSingleMap = ( params.features & IORING_FEAT_SINGLE_MMAP );
+	if ( isSingleMap && ring->cqRingSize > ring->sqRingSize ) {
+		ring->sqRingSize = ring->cqRingSize;
+	}
+
+	ring->sqRing = mmap( NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+	if ( ring->sqRing == MAP_FAILED ) {
+		ring->sqRing = NULL;
+		ring->hasFailed = true;
+		_plCloseRing();
+		return false;
+	}
+
+	if ( isSingleMap ) {
+		ring->cqRing = ring->sqRing;
+	} else {
+		ring->cqRing = mmap( NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+		if ( ring->cqRing == MAP_FAILED ) {
+			ring->cqRing = NULL;
+			ring->hasFailed = true;
+			_plCloseRing();
+			return false;
+		}
+	}
+
+	ring->sqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+	ring->sqes = mmap( NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+	if ( ring->sqes == MAP_FAILED ) {
+		ring->sqes = NULL;
+		ring->hasFailed = true;
+		_plCloseRing();
+		return false;
+	}
+
+	uint8_t* sq = ring->sqRing;
+	ring->sqHead = ( unsigned int* ) ( sq + params.sq_off.head );
+	ring->sqTail = ( unsigned int* ) ( sq + params.sq_off.tail );
+	ring->sqMask = ( unsigned int* ) ( sq + params.sq_off.ring_mask );
+	ring->sqArray = ( unsigned int* ) ( sq + params.sq_off.array );
+
+	uint8_t* cq = ring->cqRing;
+	ring->cqHead = ( unsigned int* ) ( cq + params.cq_off.head );
+	ring->cqTail = ( unsigned int* ) ( cq + params.cq_off.tail );
+	ring->cqMask = ( unsigned int* ) ( cq + params.cq_off.ring_mask );
+	ring->cqes = ( struct io_uring_cqe* ) ( cq + params.cq_off.cqes );
+
+	/* the completion queue is at least as deep as the submission queue,
+	 * so capping what's in flight to the latter means it can't overflow */
+	ring->numEntries = params.sq_entries;
+
+	if ( !_plCreateThread( &ring->reaper, _plRingReaper, NULL ) ) {
+		ring->hasFailed = true;
+		_plCloseRing();
+		return false;
+	}
+
+	ring->isActive = true;
+	return true;
+}
+
+static void _plStopRing( void ) {
+	_plLockMutex( &fs_async.mutex );
+	if ( !fs_async.ring.isActive ) {
+		_plUnlockMutex( &fs_async.mutex );
+		return;
+	}
+
+	/* a nop without a request attached tells the reaper to stop,
+	 * unless it's already given up on the queue and returned */
+	bool isQueued = fs_async.ring.hasFailed || _plSubmitRingEntry( IORING_OP_NOP, -1, NULL, 0, 0, NULL );
+	_plUnlockMutex( &fs_async.mutex );
+
+	if ( isQueued ) {
+		_plJoinThread( fs_async.ring.reaper );
+	}
+
+	_plCloseRing();
+}
+
+#endif
+
+void _plInitFileRequests( void ) {
+	if ( fs_async.isInitialized ) {
+		return;
+	}
+
+	memset( &fs_async, 0, sizeof( fs_async ) );
+	_plInitMutex( &fs_async.mutex );
+	_plInitCondition( &fs_async.workCondition );
+	_plInitCondition( &fs_async.doneCondition );
+#if defined( PL_USE_IO_URING )
+	fs_async.ring.fd = -1;
+#endif
+
+	fs_async.isInitialized = true;
+}
+
+/**
+ * Waits on anything still outstanding and then tears down
+ * the worker pool and kernel queue.
+ */
+void _plShutdownFileRequests( void ) {
+	if ( !fs_async.isInitialized ) {
+		return;
+	}
+
+	_plLockMutex( &fs_async.mutex );
+	while ( fs_async.numPending > 0 ) {
+		_plWaitCondition( &fs_async.doneCondition, &fs_async.mutex );
+	}
+	fs_async.isShuttingDown = true;
+	_plBroadcastCondition( &fs_async.workCondition );
+	_plUnlockMutex( &fs_async.mutex );
+
+	for ( unsigned int i = 0; i < fs_async.numWorkers; ++i ) {
+		_plJoinThread( fs_async.workers[ i ] );
+	}
+
+#if defined( PL_USE_IO_URING )
+	_plStopRing();
+#endif
+
+	_plDestroyCondition( &fs_async.doneCondition );
+	_plDestroyCondition( &fs_async.workCondition );
+	_plDestroyMutex( &fs_async.mutex );
+
+	fs_async.isInitialized = false;
+}
+
+static PLFileRequest* _plSubmitFileRequest( PLFileRequest* request ) {
+	if ( !fs_async.isInitialized ) {
+		ReportError( PL_RESULT_FAIL, "filesystem has not been initialized" );
+		pl_free( request );
+		return NULL;
+	}
+
+	request->status = PL_FILE_REQUEST_PENDING;
+
+	_plLockMutex( &fs_async.mutex );
+	fs_async.numPending++;
+
+#if defined( PL_USE_IO_URING )
+	/* uncached local files can go straight to the kernel,
+	 * anything in memory or needing a lookup goes to the workers */
+	if ( request->type == FS_REQUEST_READ && request->file->fptr != NULL && _plStartRing() && _plSubmitRingRead( request ) ) {
+		_plUnlockMutex( &fs_async.mutex );
+		return request;
+	}
+#endif
+
+	if ( !_plQueueFileRequest( request ) ) {
+		fs_async.numPending--;
+		_plUnlockMutex( &fs_async.mutex );
+
+		ReportError( PL_RESULT_SYSERR, "failed to start file request workers" );
+		pl_free( request );
+		return NULL;
+	}
+
+	_plUnlockMutex( &fs_async.mutex );
+	return request;
+}
+
+/**
+ * Opens the given file in the background, resolving it against mounted
+ * locations and packages in the same way as plOpenFile. The file system
+ * index is locked while it's consulted, so it may be rebuilt or invalidated
+ * in the meantime, but mounted locations shouldn't change until it's done.
+ * @param path Path to the file.
+ * @param cache Whether or not the file should be loaded into memory.
+ * @param callback Optional function called once the open has finished.
+ * @param userData Passed on to the callback.
+ * @return Request handle, to be destroyed with plDestroyFileRequest.
+ */
+PLFileRequest* plOpenFileAsync( const char* path, bool cache, PLFileRequestCallback callback, void* userData ) {
+	if ( plIsEmptyString( path ) ) {
+		ReportBasicError( PL_RESULT_FILEPATH );
+		return NULL;
+	}
+
+	PLFileRequest* request = pl_calloc( 1, sizeof( PLFileRequest ) );
+	if ( request == NULL ) {
+		return NULL;
+	}
+
+	request->type = FS_REQUEST_OPEN;
+	snprintf( request->path, sizeof( request->path ), "%s", path );
+	request->cache = cache;
+	request->Callback = callback;
+	request->userData = userData;
+
+	return _plSubmitFileRequest( request );
+}
+
+/**
+ * Reads from the given offset in the file in the background, without
+ * touching the handle's current position. The file and destination
+ * must stay valid until the request has completed.
+ * @param ptr Pointer to the file handle.
+ * @param dest Destination buffer.
+ * @param length Number of bytes to read.
+ * @param offset Offset into the file to read from.
+ * @param callback Optional function called once the read has finished.
+ * @param userData Passed on to the callback.
+ * @return Request handle, to be destroyed with plDestroyFileRequest.
+ */
+PLFileRequest* plReadFileAsync( PLFile* ptr, void* dest, size_t length, size_t offset, PLFileRequestCallback callback, void* userData ) {
+	if ( ptr == NULL ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM1 );
+		return NULL;
+	} else if ( dest == NULL ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM2 );
+		return NULL;
+	}
+
+	PLFileRequest* request = pl_calloc( 1, sizeof( PLFileRequest ) );
+	if ( request == NULL ) {
+		return NULL;
+	}
+
+	request->type = FS_REQUEST_READ;
+	request->file = ptr;
+	request->dest = dest;
+	request->length = length;
+	request->offset = offset;
+	request->Callback = callback;
+	request->userData = userData;
+
+	return _plSubmitFileRequest( request );
+}
+
+/**
+ * Writes out the given data to a local file in the background, replacing
+ * anything that's already there. The data must stay valid until the
+ * request has completed.
+ * @param path Local path to write to.
+ * @param src Data to write.
+ * @param length Number of bytes to write.
+ * @param callback Optional function called once the write has finished.
+ * @param userData Passed on to the callback.
+ * @return Request handle, to be destroyed with plDestroyFileRequest.
+ */
+PLFileRequest* plWriteFileAsync( const char* path, const void* src, size_t length, PLFileRequestCallback callback, void* userData ) {
+	if ( plIsEmptyString( path ) ) {
+		ReportBasicError( PL_RESULT_FILEPATH );
+		return NULL;
+	} else if ( src == NULL && length > 0 ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM2 );
+		return NULL;
+	}
+
+	PLFileRequest* request = pl_calloc( 1, sizeof( PLFileRequest ) );
+	if ( request == NULL ) {
+		return NULL;
+	}
+
+	request->type = FS_REQUEST_WRITE;
+	snprintf( request->path, sizeof( request->path ), "%s", path );
+	request->src = src;
+	request->length = length;
+	request->Callback = callback;
+	request->userData = userData;
+
+	return _plSubmitFileRequest( request );
+}
+
+/**
+ * Returns the current state of the request without blocking. Note that
+ * the request is still pending from within its own callback.
+ */
+PLFileRequestStatus plPollFileRequest( PLFileRequest* request ) {
+	_plLockMutex( &fs_async.mutex );
+	PLFileRequestStatus status = request->status;
+	_plUnlockMutex( &fs_async.mutex );
+	return status;
+}
+
+/**
+ * Blocks until the request has completed, or failed.
+ */
+PLFileRequestStatus plWaitFileRequest( PLFileRequest* request ) {
+	_plLockMutex( &fs_async.mutex );
+	while ( request->status == PL_FILE_REQUEST_PENDING ) {
+		_plWaitCondition( &fs_async.doneCondition, &fs_async.mutex );
+	}
+	PLFileRequestStatus status = request->status;
+	_plUnlockMutex( &fs_async.mutex );
+	return status;
+}
+
+/**
+ * Waits on the request if it's still pending and then frees it. Any
+ * file opened by the request is left open, and is up to the caller to close.
+ */
+void plDestroyFileRequest( PLFileRequest* request ) {
+	if ( request == NULL ) {
+		return;
+	}
+
+	plWaitFileRequest( request );
+	pl_free( request );
+}
+
+/**
+ * Returns the file that was opened, or read from, by the request.
+ */
+PLFile* plGetFileRequestFile( const PLFileRequest* request ) {
+	return request->file;
+}
+
+/**
+ * Returns the number of bytes read, or written, by the request.
+ */
+size_t plGetFileRequestLength( const PLFileRequest* request ) {
+	return request->numRead;
+}
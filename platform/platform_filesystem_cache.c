@@ -0,0 +1,336 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "filesystem_private.h"
+#include "platform_private.h"
+#include "thread_private.h"
+
+/*	File Content Cache	*/
+/* Opt-in cache of the contents of files opened via the VFS with caching
+ * enabled. Buffers are immutable and shared between every handle opened
+ * onto them, and least recently used buffers are dropped once the cache
+ * goes over its budget. Buffers that are dropped while still open are
+ * only freed once the last handle onto them is closed. */
+
+typedef struct FSCacheEntry {
+	/* key */
+	const void* owner;              /* package mount it came from, NULL for local files */
+	char path[ PL_SYSTEM_MAX_PATH ];
+	uint32_t hash;
+	int64_t modTime;
+
+	uint8_t* data;
+	size_t size;
+	time_t timeStamp;               /* as reported by handles onto it */
+
+	unsigned int numReferences;     /* open handles, plus one while it's in the cache */
+
+	struct FSCacheEntry* hashNext;
+	struct FSCacheEntry *lruPrev, *lruNext;
+} FSCacheEntry;
+
+#define FS_CACHE_NUM_BUCKETS    1024
+
+static struct {
+	PLMutex mutex;
+	size_t maxSize;                 /* 0 if disabled */
+	size_t size;
+	unsigned int numEntries;
+	FSCacheEntry* buckets[ FS_CACHE_NUM_BUCKETS ];
+	FSCacheEntry *lruHead, *lruTail;        /* most recently used first */
+	uint64_t numHits, numMisses, numEvictions;
+} fs_cache = { .mutex = PL_MUTEX_INITIALIZER };
+
+static uint32_t _plHashCachePath( const void* owner, const char* path ) {
+	uint32_t hash = 2166136261u ^ ( uint32_t ) ( uintptr_t ) owner;
+	for ( const char* c = path; *c != '\0'; ++c ) {
+		hash ^= ( uint8_t ) *c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void _plUnlinkCacheEntryLRU( FSCacheEntry* entry ) {
+	if ( entry->lruPrev != NULL ) {
+		entry->lruPrev->lruNext = entry->lruNext;
+	} else {
+		fs_cache.lruHead = entry->lruNext;
+	}
+	if ( entry->lruNext != NULL ) {
+		entry->lruNext->lruPrev = entry->lruPrev;
+	} else {
+		fs_cache.lruTail = entry->lruPrev;
+	}
+	entry->lruPrev = entry->lruNext = NULL;
+}
+
+static void _plPushCacheEntryLRU( FSCacheEntry* entry ) {
+	entry->lruPrev = NULL;
+	entry->lruNext = fs_cache.lruHead;
+	if ( fs_cache.lruHead != NULL ) {
+		fs_cache.lruHead->lruPrev = entry;
+	} else {
+		fs_cache.lruTail = entry;
+	}
+	fs_cache.lruHead = entry;
+}
+
+/* expects fs_cache.mutex to be held */
+static void _plReleaseCacheEntryLocked( FSCacheEntry* entry ) {
+	if ( --entry->numReferences > 0 ) {
+		return;
+	}
+
+	pl_free( entry->data );
+	pl_free( entry );
+}
+
+/**
+ * Takes the entry out of the cache, though it lives on
+ * until any handles onto it are closed.
+ * Expects fs_cache.mutex to be held.
+ */
+static void _plRemoveCacheEntry( FSCacheEntry* entry ) {
+	FSCacheEntry** link = &fs_cache.buckets[ entry->hash & ( FS_CACHE_NUM_BUCKETS - 1 ) ];
+	while ( *link != entry ) {
+		link = &( *link )->hashNext;
+	}
+	*link = entry->hashNext;
+
+	_plUnlinkCacheEntryLRU( entry );
+
+	fs_cache.size -= entry->size;
+	fs_cache.numEntries--;
+
+	_plReleaseCacheEntryLocked( entry );
+}
+
+/* expects fs_cache.mutex to be held */
+static void _plTrimFileCache( size_t maxSize ) {
+	while ( fs_cache.size > maxSize && fs_cache.lruTail != NULL ) {
+		_plRemoveCacheEntry( fs_cache.lruTail );
+		fs_cache.numEvictions++;
+	}
+}
+
+static PLFile* _plCreateCachedFileHandle( FSCacheEntry* entry ) {
+	PLFile* file = pl_calloc( 1, sizeof( PLFile ) );
+	if ( file == NULL ) {
+		return NULL;
+	}
+
+	snprintf( file->path, sizeof( file->path ), "%s", entry->path );
+	file->size = entry->size;
+	file->data = entry->data;
+	file->pos = file->data;
+	file->timeStamp = entry->timeStamp;
+	file->isView = true;
+	file->cacheEntry = entry;
+
+	entry->numReferences++;
+	return file;
+}
+
+bool _plIsFileCacheEnabled( void ) {
+	return ( fs_cache.maxSize > 0 );
+}
+
+/**
+ * Returns a new handle onto the cached contents of the given file,
+ * or NULL if it's not in the cache or has since changed.
+ * @param owner Package mount the file belongs to, or NULL if it's a local file.
+ * @param path Resolved path to the file.
+ * @param modTime Modification time, the cached copy must match this.
+ */
+PLFile* _plOpenCachedFile( const void* owner, const char* path, int64_t modTime ) {
+	if ( fs_cache.maxSize == 0 ) {
+		return NULL;
+	}
+
+	uint32_t hash = _plHashCachePath( owner, path );
+
+	_plLockMutex( &fs_cache.mutex );
+	FSCacheEntry* entry = fs_cache.buckets[ hash & ( FS_CACHE_NUM_BUCKETS - 1 ) ];
+	for ( ; entry != NULL; entry = entry->hashNext ) {
+		if ( entry->hash == hash && entry->owner == owner && strcmp( entry->path, path ) == 0 ) {
+			break;
+		}
+	}
+
+	if ( entry != NULL && entry->modTime != modTime ) {
+		/* stale, so it'll be replaced once it's been read back in */
+		_plRemoveCacheEntry( entry );
+		entry = NULL;
+	}
+
+	PLFile* file = NULL;
+	if ( entry != NULL ) {
+		_plUnlinkCacheEntryLRU( entry );
+		_plPushCacheEntryLRU( entry );
+		file = _plCreateCachedFileHandle( entry );
+	}
+
+	if ( file != NULL ) {
+		fs_cache.numHits++;
+	} else {
+		fs_cache.numMisses++;
+	}
+	_plUnlockMutex( &fs_cache.mutex );
+
+	return file;
+}
+
+/**
+ * Hands the contents of a freshly opened, cached, file over to the cache.
+ * The handle then shares the cached copy, same as any later opens.
+ */
+void _plInsertCachedFile( const void* owner, const char* path, int64_t modTime, PLFile* file ) {
+	if ( fs_cache.maxSize == 0 || file->data == NULL || file->isView || file->isMapped || file->cacheEntry != NULL ) {
+		return;
+	}
+
+	/* don't let one file push out everything else */
+	if ( file->size > fs_cache.maxSize / 2 ) {
+		return;
+	}
+
+	FSCacheEntry* entry = pl_calloc( 1, sizeof( FSCacheEntry ) );
+	if ( entry == NULL ) {
+		return;
+	}
+
+	entry->owner = owner;
+	snprintf( entry->path, sizeof( entry->path ), "%s", path );
+	entry->hash = _plHashCachePath( owner, path );
+	entry->modTime = modTime;
+	entry->data = file->data;
+	entry->size = file->size;
+	entry->timeStamp = file->timeStamp;
+	entry->numReferences = 2;   /* the cache, and the handle */
+
+	file->isView = true;
+	file->cacheEntry = entry;
+
+	_plLockMutex( &fs_cache.mutex );
+	/* someone else may have beaten us to it */
+	FSCacheEntry** bucket = &fs_cache.buckets[ entry->hash & ( FS_CACHE_NUM_BUCKETS - 1 ) ];
+	for ( FSCacheEntry* other = *bucket; other != NULL; other = other->hashNext ) {
+		if ( other->hash == entry->hash && other->owner == owner && strcmp( other->path, path ) == 0 ) {
+			_plRemoveCacheEntry( other );
+			break;
+		}
+	}
+
+	entry->hashNext = *bucket;
+	*bucket = entry;
+	_plPushCacheEntryLRU( entry );
+	fs_cache.size += entry->size;
+	fs_cache.numEntries++;
+
+	_plTrimFileCache( fs_cache.maxSize );
+	_plUnlockMutex( &fs_cache.mutex );
+}
+
+/**
+ * Drops the handle's reference to the cached contents.
+ */
+void _plReleaseCachedFile( PLFile* file ) {
+	_plLockMutex( &fs_cache.mutex );
+	_plReleaseCacheEntryLocked( file->cacheEntry );
+	_plUnlockMutex( &fs_cache.mutex );
+
+	file->cacheEntry = NULL;
+	file->data = file->pos = NULL;
+}
+
+/**
+ * Drops anything cached from the given owner, or the given
+ * path if provided, e.g. when a package is unmounted.
+ */
+void _plPurgeFileCache( const void* owner, const char* path ) {
+	_plLockMutex( &fs_cache.mutex );
+	if ( fs_cache.numEntries == 0 ) {
+		_plUnlockMutex( &fs_cache.mutex );
+		return;
+	}
+
+	/* a single file can only be in the one bucket */
+	unsigned int i = 0, numBuckets = FS_CACHE_NUM_BUCKETS;
+	if ( path != NULL ) {
+		i = _plHashCachePath( owner, path ) & ( FS_CACHE_NUM_BUCKETS - 1 );
+		numBuckets = i + 1;
+	}
+
+	for ( ; i < numBuckets; ++i ) {
+		FSCacheEntry* entry = fs_cache.buckets[ i ];
+		while ( entry != NULL ) {
+			FSCacheEntry* next = entry->hashNext;
+			if ( entry->owner == owner && ( path == NULL || strcmp( entry->path, path ) == 0 ) ) {
+				_plRemoveCacheEntry( entry );
+			}
+			entry = next;
+		}
+	}
+	_plUnlockMutex( &fs_cache.mutex );
+}
+
+/**
+ * Enables the file content cache, which shares the contents of files
+ * opened via plOpenFile with caching enabled between handles, rather
+ * than reading them in again each time.
+ * @param maxSize Budget for the cache in bytes, 0 disables and empties it.
+ */
+void plEnableFileCache( size_t maxSize ) {
+	_plLockMutex( &fs_cache.mutex );
+	fs_cache.maxSize = maxSize;
+	_plTrimFileCache( maxSize );
+	_plUnlockMutex( &fs_cache.mutex );
+}
+
+/**
+ * Empties the file content cache. Handles that are still open
+ * onto cached files remain valid.
+ */
+void plFlushFileCache( void ) {
+	_plLockMutex( &fs_cache.mutex );
+	while ( fs_cache.lruTail != NULL ) {
+		_plRemoveCacheEntry( fs_cache.lruTail );
+	}
+	_plUnlockMutex( &fs_cache.mutex );
+}
+
+void plGetFileCacheStats( PLFileCacheStats* stats ) {
+	_plLockMutex( &fs_cache.mutex );
+	stats->numHits = fs_cache.numHits;
+	stats->numMisses = fs_cache.numMisses;
+	stats->numEvictions = fs_cache.numEvictions;
+	stats->numEntries = fs_cache.numEntries;
+	stats->size = fs_cache.size;
+	stats->maxSize = fs_cache.maxSize;
+	_plUnlockMutex( &fs_cache.mutex );
+}
@@ -0,0 +1,552 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#include "filesystem_private.h"
+#include "platform_private.h"
+
+#if defined( __linux__ )
+#	include <sys/inotify.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <errno.h>
+#	define FS_WATCH_INOTIFY
+#endif
+
+/*	File Change Notification	*/
+/* Watches are resolved against the mounted directories at the time they're
+ * created, and changes are queued up by the kernel until plPollFileChanges
+ * is called. Several changes to the same file between polls are collapsed
+ * down into one. Nothing is polled from disk while files are unchanged. */
+
+struct PLFileWatch {
+	char path[ PL_SYSTEM_MAX_PATH ];    /* as passed back to the callback */
+	bool isDirectory;
+	bool isRecursive;
+	bool isRemoved;                     /* unwatched from within a callback */
+	PLFileChangeCallback Callback;
+	void* userData;
+	struct PLFileWatch* next;
+};
+
+#if defined( FS_WATCH_INOTIFY )
+
+#define FS_WATCH_MASK   ( IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR )
+
+typedef struct FSWatchDirectory {
+	int wd;
+	char localPath[ PL_SYSTEM_MAX_PATH ];
+	char path[ PL_SYSTEM_MAX_PATH ];    /* what localPath maps to, relative to the mount */
+	PLFileWatch* watch;
+	struct FSWatchDirectory* next;
+} FSWatchDirectory;
+
+typedef struct FSWatchEvent {
+	PLFileWatch* watch;
+	char* path;
+	unsigned int sequence;
+	PLFileChangeType type;
+} FSWatchEvent;
+
+static struct {
+	int fd;
+	bool isDispatching;
+	bool hasOverflowed;                 /* kernel queue filled up, events were dropped */
+	PLFileWatch* watches;
+	FSWatchDirectory* directories;
+	FSWatchEvent* events;
+	unsigned int numEvents;
+	unsigned int maxEvents;
+} fs_watch = { .fd = -1 };
+
+static void _plJoinWatchPath( char* out, size_t length, const char* base, const char* name ) {
+	if ( *base == '\0' ) {
+		snprintf( out, length, "%s", name );
+	} else if ( base[ strlen( base ) - 1 ] == '/' ) {
+		snprintf( out, length, "%s%s", base, name );
+	} else {
+		snprintf( out, length, "%s/%s", base, name );
+	}
+}
+
+/* splits off the last element of the path, leaving what's left in out */
+static void _plGetWatchParentPath( char* out, size_t length, const char* path ) {
+	const char* c = strrchr( path, '/' );
+	if ( c == NULL ) {
+		*out = '\0';
+	} else if ( c == path ) {
+		snprintf( out, length, "/" );
+	} else {
+		snprintf( out, length, "%.*s", ( int ) ( c - path ), path );
+	}
+}
+
+static bool _plAddWatchDirectory( PLFileWatch* watch, const char* localPath, const char* path, bool recursive ) {
+	int wd = inotify_add_watch( fs_watch.fd, localPath, FS_WATCH_MASK );
+	if ( wd < 0 ) {
+		FSLog( "Failed to watch %s: %s\n", localPath, strerror( errno ) );
+		return false;
+	}
+
+	FSWatchDirectory* directory = pl_calloc( 1, sizeof( FSWatchDirectory ) );
+	if ( directory == NULL ) {
+		return false;
+	}
+
+	directory->wd = wd;
+	snprintf( directory->localPath, sizeof( directory->localPath ), "%s", localPath );
+	snprintf( directory->path, sizeof( directory->path ), "%s", path );
+	directory->watch = watch;
+	directory->next = fs_watch.directories;
+	fs_watch.directories = directory;
+
+	if ( !recursive ) {
+		return true;
+	}
+
+	DIR* dir = opendir( localPath );
+	if ( dir == NULL ) {
+		return true;
+	}
+
+	struct dirent* entry;
+	while ( ( entry = readdir( dir ) ) ) {
+		if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) {
+			continue;
+		}
+
+		char childLocalPath[ PL_SYSTEM_MAX_PATH ];
+		_plJoinWatchPath( childLocalPath, sizeof( childLocalPath ), localPath, entry->d_name );
+		if ( _plGetDirectoryEntryType( dir, entry, childLocalPath ) != FS_ENTRY_DIRECTORY ) {
+			continue;
+		}
+
+		char childPath[ PL_SYSTEM_MAX_PATH ];
+		_plJoinWatchPath( childPath, sizeof( childPath ), path, entry->d_name );
+		_plAddWatchDirectory( watch, childLocalPath, childPath, true );
+	}
+
+	closedir( dir );
+	return true;
+}
+
+/**
+ * Drops every directory belonging to the watch, or watching the given
+ * descriptor if watch is NULL. The kernel side is only removed once
+ * nothing else is using it.
+ */
+static void _plRemoveWatchDirectories( const PLFileWatch* watch, int wd ) {
+	FSWatchDirectory** link = &fs_watch.directories;
+	while ( *link != NULL ) {
+		FSWatchDirectory* directory = *link;
+		if ( ( watch != NULL && directory->watch != watch ) || ( watch == NULL && directory->wd != wd ) ) {
+			link = &directory->next;
+			continue;
+		}
+
+		*link = directory->next;
+
+		bool isShared = false;
+		for ( FSWatchDirectory* other = fs_watch.directories; other != NULL; other = other->next ) {
+			if ( other->wd == directory->wd ) {
+				isShared = true;
+				break;
+			}
+		}
+		if ( !isShared && watch != NULL ) {
+			inotify_rm_watch( fs_watch.fd, directory->wd );
+		}
+
+		pl_free( directory );
+	}
+}
+
+static void _plFreeFileWatch( PLFileWatch* watch ) {
+	PLFileWatch** link = &fs_watch.watches;
+	while ( *link != NULL && *link != watch ) {
+		link = &( *link )->next;
+	}
+	if ( *link != NULL ) {
+		*link = watch->next;
+	}
+
+	pl_free( watch );
+}
+
+static void _plPushWatchEvent( PLFileWatch* watch, const char* path, PLFileChangeType type ) {
+	if ( fs_watch.numEvents == fs_watch.maxEvents ) {
+		unsigned int maxEvents = ( fs_watch.maxEvents > 0 ) ? fs_watch.maxEvents * 2 : 64;
+		FSWatchEvent* events = pl_realloc( fs_watch.events, maxEvents * sizeof( FSWatchEvent ) );
+		if ( events == NULL ) {
+			return;
+		}
+		fs_watch.events = events;
+		fs_watch.maxEvents = maxEvents;
+	}
+
+	size_t length = strlen( path ) + 1;
+	char* copy = pl_malloc( length );
+	if ( copy == NULL ) {
+		return;
+	}
+	memcpy( copy, path, length );
+
+	FSWatchEvent* event = &fs_watch.events[ fs_watch.numEvents ];
+	event->watch = watch;
+	event->path = copy;
+	event->sequence = fs_watch.numEvents++;
+	event->type = type;
+}
+
+static void _plHandleWatchEvent( const struct inotify_event* event ) {
+	if ( event->mask & IN_Q_OVERFLOW ) {
+		FSLog( "File watch queue overflowed, changes were lost\n" );
+		fs_watch.hasOverflowed = true;
+		return;
+	} else if ( event->mask & IN_IGNORED ) {
+		/* directory was removed, or unmounted, so the kernel has dropped it */
+		_plRemoveWatchDirectories( NULL, event->wd );
+		return;
+	} else if ( event->len == 0 ) {
+		return;
+	}
+
+	for ( FSWatchDirectory* directory = fs_watch.directories; directory != NULL; directory = directory->next ) {
+		if ( directory->wd != event->wd ) {
+			continue;
+		}
+
+		PLFileWatch* watch = directory->watch;
+
+		char path[ PL_SYSTEM_MAX_PATH ];
+		_plJoinWatchPath( path, sizeof( path ), directory->path, event->name );
+
+		if ( event->mask & IN_ISDIR ) {
+			/* keep up with new sub-directories, but don't report them */
+			if ( watch->isRecursive && ( event->mask & ( IN_CREATE | IN_MOVED_TO ) ) ) {
+				char localPath[ PL_SYSTEM_MAX_PATH ];
+				_plJoinWatchPath( localPath, sizeof( localPath ), directory->localPath, event->name );
+				_plAddWatchDirectory( watch, localPath, path, true );
+			}
+			continue;
+		}
+
+		/* watches on a single file are made through its directory */
+		if ( !watch->isDirectory && strcmp( path, watch->path ) != 0 ) {
+			continue;
+		}
+
+		PLFileChangeType type;
+		if ( event->mask & ( IN_CREATE | IN_MOVED_TO ) ) {
+			type = PL_FILE_CHANGE_CREATED;
+		} else if ( event->mask & ( IN_DELETE | IN_MOVED_FROM ) ) {
+			type = PL_FILE_CHANGE_DELETED;
+		} else {
+			type = PL_FILE_CHANGE_MODIFIED;
+		}
+
+		_plPushWatchEvent( watch, path, type );
+	}
+}
+
+static int _plCompareWatchEvents( const void* a, const void* b ) {
+	const FSWatchEvent* eventA = a;
+	const FSWatchEvent* eventB = b;
+	if ( eventA->watch != eventB->watch ) {
+		return ( ( uintptr_t ) eventA->watch < ( uintptr_t ) eventB->watch ) ? -1 : 1;
+	}
+
+	int result = strcmp( eventA->path, eventB->path );
+	if ( result != 0 ) {
+		return result;
+	}
+
+	return ( eventA->sequence < eventB->sequence ) ? -1 : 1;
+}
+
+/**
+ * Reduces a run of changes to the same file down to what the
+ * caller actually needs to know about it.
+ * @return False if it all cancels out, e.g. a temporary file.
+ */
+static bool _plCoalesceWatchEvents( const FSWatchEvent* first, const FSWatchEvent* last, PLFileChangeType* type ) {
+	if ( first->type == PL_FILE_CHANGE_CREATED ) {
+		if ( last->type == PL_FILE_CHANGE_DELETED ) {
+			return false;
+		}
+		*type = PL_FILE_CHANGE_CREATED;
+	} else if ( last->type == PL_FILE_CHANGE_DELETED ) {
+		*type = PL_FILE_CHANGE_DELETED;
+	} else {
+		/* includes files that were deleted and then written back out */
+		*type = PL_FILE_CHANGE_MODIFIED;
+	}
+
+	return true;
+}
+
+#endif
+
+/**
+ * Starts watching the given file or directory for changes. The path is
+ * resolved against each mounted directory, and changes are passed back
+ * relative to the mount.
+ * @param path Path to the file or directory.
+ * @param recursive If watching a directory, whether to include sub-directories.
+ * @param callback Called from plPollFileChanges for each change.
+ * @param userData Passed on to the callback.
+ * @return Handle to the watch, or NULL on failure.
+ */
+PLFileWatch* plWatchPath( const char* path, bool recursive, PLFileChangeCallback callback, void* userData ) {
+#if defined( FS_WATCH_INOTIFY )
+	if ( plIsEmptyString( path ) ) {
+		ReportBasicError( PL_RESULT_FILEPATH );
+		return NULL;
+	} else if ( callback == NULL ) {
+		ReportBasicError( PL_RESULT_INVALID_PARM3 );
+		return NULL;
+	}
+
+	if ( fs_watch.fd < 0 && ( fs_watch.fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) ) < 0 ) {
+		ReportError( PL_RESULT_SYSERR, "failed to initialize inotify: %s", strerror( errno ) );
+		return NULL;
+	}
+
+	PLFileWatch* watch = pl_calloc( 1, sizeof( PLFileWatch ) );
+	if ( watch == NULL ) {
+		return NULL;
+	}
+
+	watch->isRecursive = recursive;
+	watch->Callback = callback;
+	watch->userData = userData;
+
+	bool isLocal = ( _plGetNextMountedLocation( NULL ) == NULL );
+	if ( strncmp( FS_LOCAL_HINT, path, sizeof( FS_LOCAL_HINT ) ) == 0 ) {
+		path += sizeof( FS_LOCAL_HINT );
+		isLocal = true;
+	}
+
+	if ( isLocal ) {
+		/* local paths are passed back as given, just without a trailing separator */
+		snprintf( watch->path, sizeof( watch->path ), "%s", path );
+		size_t length = strlen( watch->path );
+		while ( length > 1 && watch->path[ length - 1 ] == '/' ) {
+			watch->path[ --length ] = '\0';
+		}
+		watch->isDirectory = plLocalPathExists( watch->path );
+	} else {
+		_plNormalizeIndexPath( path, watch->path, sizeof( watch->path ) );
+		watch->isDirectory = plPathExists( watch->path );
+	}
+
+	/* files are watched via their directory, so that they're still
+	 * picked up if they're replaced, or don't exist yet */
+	char parentPath[ PL_SYSTEM_MAX_PATH ];
+	_plGetWatchParentPath( parentPath, sizeof( parentPath ), watch->path );
+	const char* watchedPath = watch->isDirectory ? watch->path : parentPath;
+	bool isRecursive = watch->isDirectory && recursive;
+
+	bool isWatching = false;
+	if ( isLocal ) {
+		isWatching = _plAddWatchDirectory( watch, ( *watchedPath != '\0' ) ? watchedPath : ".", watchedPath, isRecursive );
+	} else {
+		for ( PLFileSystemMount* location = _plGetNextMountedLocation( NULL ); location != NULL; location = _plGetNextMountedLocation( location ) ) {
+			const char* mountPath = _plGetMountedLocationPath( location );
+			if ( mountPath == NULL ) {
+				/* packages don't change under us */
+				continue;
+			}
+
+			char localPath[ PL_SYSTEM_MAX_PATH ];
+			_plJoinWatchPath( localPath, sizeof( localPath ), mountPath, watchedPath );
+			if ( plLocalPathExists( localPath ) ) {
+				isWatching |= _plAddWatchDirectory( watch, localPath, watchedPath, isRecursive );
+			}
+		}
+	}
+
+	if ( !isWatching ) {
+		_plRemoveWatchDirectories( watch, -1 );
+		pl_free( watch );
+		ReportError( PL_RESULT_FILEPATH, "failed to find anything to watch for %s", path );
+		return NULL;
+	}
+
+	watch->next = fs_watch.watches;
+	fs_watch.watches = watch;
+
+	return watch;
+#else
+	( void ) path;
+	( void ) recursive;
+	( void ) callback;
+	( void ) userData;
+	ReportError( PL_RESULT_UNSUPPORTED, "file watches are not supported on this platform" );
+	return NULL;
+#endif
+}
+
+/**
+ * Stops watching for changes. This is safe to call from a change callback.
+ */
+void plUnwatchPath( PLFileWatch* watch ) {
+#if defined( FS_WATCH_INOTIFY )
+	if ( watch == NULL ) {
+		return;
+	}
+
+	_plRemoveWatchDirectories( watch, -1 );
+
+	if ( fs_watch.isDispatching ) {
+		/* there may still be events queued up for it */
+		watch->isRemoved = true;
+		return;
+	}
+
+	_plFreeFileWatch( watch );
+#else
+	( void ) watch;
+#endif
+}
+
+/**
+ * Picks up any changes since the last call, and passes them back to the
+ * relevant callbacks. Cheap to call every frame, as nothing is checked
+ * on disk unless the kernel has something for us. If the kernel had to drop
+ * changes, each watch is instead passed PL_FILE_CHANGE_RESCAN for its path.
+ * @return Number of changes that were passed back.
+ */
+unsigned int plPollFileChanges( void ) {
+#if defined( FS_WATCH_INOTIFY )
+	if ( fs_watch.fd < 0 ) {
+		return 0;
+	}
+
+	char buffer[ 4096 ] __attribute__( ( aligned( __alignof__( struct inotify_event ) ) ) );
+	for ( ;; ) {
+		ssize_t length = read( fs_watch.fd, buffer, sizeof( buffer ) );
+		if ( length < 0 && errno == EINTR ) {
+			continue;
+		} else if ( length <= 0 ) {
+			break;
+		}
+
+		for ( char* c = buffer; c < buffer + length; ) {
+			const struct inotify_event* event = ( const struct inotify_event* ) c;
+			_plHandleWatchEvent( event );
+			c += sizeof( struct inotify_event ) + event->len;
+		}
+	}
+
+	if ( fs_watch.numEvents == 0 && !fs_watch.hasOverflowed ) {
+		return 0;
+	}
+
+	unsigned int numChanges = 0;
+	bool isIndexStale = false;
+
+	fs_watch.isDispatching = true;
+
+	if ( fs_watch.hasOverflowed ) {
+		/* what did make it through is incomplete, so rather than pass it
+		 * on, have every watch take another look at what it's watching */
+		for ( unsigned int i = 0; i < fs_watch.numEvents; ++i ) {
+			pl_free( fs_watch.events[ i ].path );
+		}
+		fs_watch.numEvents = 0;
+		fs_watch.hasOverflowed = false;
+
+		for ( PLFileWatch* watch = fs_watch.watches; watch != NULL; watch = watch->next ) {
+			if ( !watch->isRemoved ) {
+				watch->Callback( watch->path, PL_FILE_CHANGE_RESCAN, watch->userData );
+				numChanges++;
+			}
+		}
+		isIndexStale = true;
+	}
+
+	/* group each file's events together, in the order they happened */
+	qsort( fs_watch.events, fs_watch.numEvents, sizeof( FSWatchEvent ), _plCompareWatchEvents );
+
+	for ( unsigned int i = 0; i < fs_watch.numEvents; ) {
+		unsigned int last = i;
+		while ( last + 1 < fs_watch.numEvents && fs_watch.events[ last + 1 ].watch == fs_watch.events[ i ].watch &&
+		        strcmp( fs_watch.events[ last + 1 ].path, fs_watch.events[ i ].path ) == 0 ) {
+			last++;
+		}
+
+		PLFileWatch* watch = fs_watch.events[ i ].watch;
+		PLFileChangeType type;
+		if ( !watch->isRemoved && _plCoalesceWatchEvents( &fs_watch.events[ i ], &fs_watch.events[ last ], &type ) ) {
+			isIndexStale |= ( type != PL_FILE_CHANGE_MODIFIED );
+			watch->Callback( fs_watch.events[ i ].path, type, watch->userData );
+			numChanges++;
+		}
+
+		for ( ; i <= last; ++i ) {
+			pl_free( fs_watch.events[ i ].path );
+		}
+	}
+	fs_watch.isDispatching = false;
+	fs_watch.numEvents = 0;
+
+	/* now it's safe to let go of anything unwatched in the meantime */
+	PLFileWatch* watch = fs_watch.watches;
+	while ( watch != NULL ) {
+		PLFileWatch* next = watch->next;
+		if ( watch->isRemoved ) {
+			_plFreeFileWatch( watch );
+		}
+		watch = next;
+	}
+
+	if ( isIndexStale ) {
+		plInvalidateFileSystemIndex();
+	}
+
+	return numChanges;
+#else
+	return 0;
+#endif
+}
+
+void _plShutdownFileWatches( void ) {
+#if defined( FS_WATCH_INOTIFY )
+	while ( fs_watch.watches != NULL ) {
+		plUnwatchPath( fs_watch.watches );
+	}
+
+	pl_free( fs_watch.events );
+	fs_watch.events = NULL;
+	fs_watch.numEvents = fs_watch.maxEvents = 0;
+
+	if ( fs_watch.fd >= 0 ) {
+		close( fs_watch.fd );
+		fs_watch.fd = -1;
+	}
+#endif
+}
@@ -99,6 +99,17 @@ void plShutdownConsole(void);
 void _plInitPackageSubSystem(void);
 void _plInitModelSubSystem(void);
 
+/* * * * * * * * * * * * * * * * * * * */
+/* SIMD                                */
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#   define PL_SIMD_SSE2
+#   include <emmintrin.h>
+#elif defined( __ARM_NEON )
+#   define PL_SIMD_NEON
+#   include <arm_neon.h>
+#endif
+
 /* * * * * * * * * * * * * * * * * * * */
 
 #ifdef _WIN32
@@ -0,0 +1,147 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org>
+*/
+
+#pragma once
+
+#include <PL/platform.h>
+
+/* Minimal threading primitives shared by the internal worker pools.
+ * These are deliberately kept private; nothing here is exported. */
+
+#if defined( _WIN32 )
+#	include <windows.h>
+
+typedef SRWLOCK PLMutex;
+typedef CONDITION_VARIABLE PLCondition;
+typedef HANDLE PLThread;
+
+#	define PL_MUTEX_INITIALIZER SRWLOCK_INIT
+
+static inline void _plInitMutex( PLMutex* mutex ) { InitializeSRWLock( mutex ); }
+static inline void _plDestroyMutex( PLMutex* mutex ) { ( void ) mutex; }
+static inline void _plLockMutex( PLMutex* mutex ) { AcquireSRWLockExclusive( mutex ); }
+static inline void _plUnlockMutex( PLMutex* mutex ) { ReleaseSRWLockExclusive( mutex ); }
+
+static inline void _plInitCondition( PLCondition* condition ) { InitializeConditionVariable( condition ); }
+static inline void _plDestroyCondition( PLCondition* condition ) { ( void ) condition; }
+static inline void _plWaitCondition( PLCondition* condition, PLMutex* mutex ) { SleepConditionVariableSRW( condition, mutex, INFINITE, 0 ); }
+static inline void _plSignalCondition( PLCondition* condition ) { WakeConditionVariable( condition ); }
+static inline void _plBroadcastCondition( PLCondition* condition ) { WakeAllConditionVariable( condition ); }
+
+typedef struct PLThreadStart {
+	void ( *Function )( void* );
+	void* userData;
+} PLThreadStart;
+
+static inline DWORD WINAPI _plThreadEntry( LPVOID parameter ) {
+	PLThreadStart start = *( PLThreadStart* ) parameter;
+	pl_free( parameter );
+	start.Function( start.userData );
+	return 0;
+}
+
+static inline bool _plCreateThread( PLThread* thread, void ( *Function )( void* ), void* userData ) {
+	PLThreadStart* start = pl_malloc( sizeof( PLThreadStart ) );
+	if ( start == NULL ) {
+		return false;
+	}
+	start->Function = Function;
+	start->userData = userData;
+	*thread = CreateThread( NULL, 0, _plThreadEntry, start, 0, NULL );
+	if ( *thread == NULL ) {
+		pl_free( start );
+		return false;
+	}
+	return true;
+}
+
+static inline void _plJoinThread( PLThread thread ) {
+	WaitForSingleObject( thread, INFINITE );
+	CloseHandle( thread );
+}
+
+static inline unsigned int _plGetNumProcessors( void ) {
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return ( unsigned int ) info.dwNumberOfProcessors;
+}
+#else
+#	include <pthread.h>
+#	include <unistd.h>
+
+typedef pthread_mutex_t PLMutex;
+typedef pthread_cond_t PLCondition;
+typedef pthread_t PLThread;
+
+#	define PL_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+static inline void _plInitMutex( PLMutex* mutex ) { pthread_mutex_init( mutex, NULL ); }
+static inline void _plDestroyMutex( PLMutex* mutex ) { pthread_mutex_destroy( mutex ); }
+static inline void _plLockMutex( PLMutex* mutex ) { pthread_mutex_lock( mutex ); }
+static inline void _plUnlockMutex( PLMutex* mutex ) { pthread_mutex_unlock( mutex ); }
+
+static inline void _plInitCondition( PLCondition* condition ) { pthread_cond_init( condition, NULL ); }
+static inline void _plDestroyCondition( PLCondition* condition ) { pthread_cond_destroy( condition ); }
+static inline void _plWaitCondition( PLCondition* condition, PLMutex* mutex ) { pthread_cond_wait( condition, mutex ); }
+static inline void _plSignalCondition( PLCondition* condition ) { pthread_cond_signal( condition ); }
+static inline void _plBroadcastCondition( PLCondition* condition ) { pthread_cond_broadcast( condition ); }
+
+typedef struct PLThreadStart {
+	void ( *Function )( void* );
+	void* userData;
+} PLThreadStart;
+
+static inline void* _plThreadEntry( void* parameter ) {
+	PLThreadStart start = *( PLThreadStart* ) parameter;
+	pl_free( parameter );
+	start.Function( start.userData );
+	return NULL;
+}
+
+static inline bool _plCreateThread( PLThread* thread, void ( *Function )( void* ), void* userData ) {
+	PLThreadStart* start = pl_malloc( sizeof( PLThreadStart ) );
+	if ( start == NULL ) {
+		return false;
+	}
+	start->Function = Function;
+	start->userData = userData;
+	if ( pthread_create( thread, NULL, _plThreadEntry, start ) != 0 ) {
+		pl_free( start );
+		return false;
+	}
+	return true;
+}
+
+static inline void _plJoinThread( PLThread thread ) {
+	pthread_join( thread, NULL );
+}
+
+static inline unsigned int _plGetNumProcessors( void ) {
+	long num = sysconf( _SC_NPROCESSORS_ONLN );
+	return ( num > 0 ) ? ( unsigned int ) num : 1;
+}
+#endif
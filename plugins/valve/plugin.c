@@ -15,9 +15,11 @@ PL_EXPORT const PLPluginDescription *PLQueryPlugin( unsigned int interfaceVersio
 }
 
 PLImage *VTF_LoadImage( const char *path );
+bool VTF_ProbeImage( const char *path, PLImageInfo *info );
 
 PL_EXPORT void PLInitializePlugin( const PLPluginExportTable *functionTable ) {
 	gInterface = functionTable;
 
 	gInterface->RegisterImageLoader( "vtf", VTF_LoadImage );
+	gInterface->RegisterImageProbe( "vtf", VTF_ProbeImage );
 }
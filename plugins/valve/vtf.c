@@ -350,3 +350,47 @@ PLImage *VTF_LoadImage( const char *path ) {
 
 	return out;
 }
+
+bool VTF_ProbeImage( const char *path, PLImageInfo *info ) {
+	PLFile *file = gInterface->OpenFile( path, false );
+	if ( file == NULL ) {
+		return false;
+	}
+
+	VTFHeader header;
+	bool result = VTF_ValidateFile( file, &header );
+
+	gInterface->CloseFile( file );
+
+	if ( !result ) {
+		return false;
+	}
+
+	info->width = header.width;
+	info->height = header.height;
+	/* only the largest level is loaded for now, see VTF_LoadImage */
+	info->levels = 1;
+
+	PLImage image;
+	switch ( header.highresimageformat ) {
+		/* not handled by ConvertVTFFormat yet */
+		case VTF_FORMAT_I8:
+		case VTF_FORMAT_IA88:
+		case VTF_FORMAT_P8:
+		case VTF_FORMAT_RGB565:
+		case VTF_FORMAT_UV88:
+		case VTF_FORMAT_UVLX8888:
+		case VTF_FORMAT_UVWQ8888:
+			image.format = PL_IMAGEFORMAT_UNKNOWN;
+			image.colour_format = PL_COLOURFORMAT_RGB;
+			break;
+		default:
+			ConvertVTFFormat( &image, header.highresimageformat );
+			break;
+	}
+
+	info->format = image.format;
+	info->colour_format = image.colour_format;
+
+	return true;
+}
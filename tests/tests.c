@@ -27,6 +27,14 @@ For more information, please refer to <http://unlicense.org>
 
 #include <PL/platform.h>
 #include <PL/platform_console.h>
+#include <PL/platform_image.h>
+
+#if defined( _WIN32 )
+#	include <direct.h>
+#	define rmdir _rmdir
+#else
+#	include <unistd.h>
+#endif
 
 enum {
 	TEST_RETURN_SUCCESS,
@@ -37,6 +45,10 @@ enum {
 #define FUNC_TEST( NAME )   uint8_t test_##NAME( void ) { printf( " Starting " #NAME );
 #define FUNC_TEST_END()     return TEST_RETURN_SUCCESS; }
 
+/* the library has no means of removing directories, so
+ * tests clean up whatever they create through this */
+#define REMOVE_TEST_DIRECTORY( PATH ) rmdir( PATH )
+
 /*============================================================
  * CONSOLE
  ===========================================================*/
@@ -95,9 +107,1191 @@ FUNC_TEST( GetConsoleCommand )
     }
 FUNC_TEST_END()
 
+/*============================================================
+ * FILESYSTEM
+ ===========================================================*/
+
+#include <PL/platform_filesystem.h>
+
+#define TEST_FILE_PATH  "pl_test_file.bin"
+
+FUNC_TEST( MapLocalFile )
+    const uint8_t buf[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    if ( !plWriteFile( TEST_FILE_PATH, buf, sizeof( buf ) ) ) {
+	    printf( "Failed to write \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFile *file = plMapLocalFile( TEST_FILE_PATH );
+    if ( file == NULL ) {
+	    printf( "Failed to map \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    bool status;
+    int32_t v = plReadInt32( file, true, &status );
+    if ( !status || v != 0x01020304 || plGetFileOffset( file ) != 4 ) {
+	    printf( "Unexpected value read from mapped file!\n" );
+	    plCloseFile( file );
+	    return TEST_RETURN_FAILURE;
+    }
+    plFileSeek( file, 7, PL_SEEK_SET );
+    if ( plReadInt8( file, &status ) != 0x08 || !plIsEndOfFile( file ) ) {
+	    printf( "Failed to seek within mapped file!\n" );
+	    plCloseFile( file );
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    plDeleteFile( TEST_FILE_PATH );
+FUNC_TEST_END()
+
+FUNC_TEST( ReadBufferedFile )
+    const char buf[] = "first line\nsecond line\n0123456789abcdef";
+    if ( !plWriteFile( TEST_FILE_PATH, ( const uint8_t * ) buf, sizeof( buf ) - 1 ) ) {
+	    printf( "Failed to write \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFile *file = plOpenLocalFile( TEST_FILE_PATH, false );
+    if ( file == NULL ) {
+	    printf( "Failed to open \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    /* keep the buffer tiny, so reads have to span several refills */
+    plSetFileBufferSize( file, 4 );
+    char line[ 32 ];
+    bool result = plReadString( file, line, sizeof( line ) ) != NULL && strcmp( line, "first line\n" ) == 0 &&
+                  plReadString( file, line, sizeof( line ) ) != NULL && strcmp( line, "second line\n" ) == 0 &&
+                  plGetFileOffset( file ) == 23;
+    bool status;
+    result = result && plReadInt8( file, &status ) == '0' && status;
+    result = result && plFileSeek( file, -6, PL_SEEK_END ) && plReadInt8( file, &status ) == 'a';
+    char tail[ 8 ];
+    result = result && plReadFile( file, tail, 1, sizeof( tail ) ) == 5 && memcmp( tail, "bcdef", 5 ) == 0 &&
+             plIsEndOfFile( file ) && plReadString( file, line, sizeof( line ) ) == NULL;
+    plRewindFile( file );
+    result = result && plReadFile( file, line, 1, 10 ) == 10 && memcmp( line, "first line", 10 ) == 0;
+    plCloseFile( file );
+    plDeleteFile( TEST_FILE_PATH );
+    if ( !result ) {
+	    printf( "Unexpected result from buffered reads!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( ReadEndianArrays )
+    /* odd counts, so both the vector and scalar tails get exercised */
+    const uint8_t buf[] = {
+            0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+            0x3F, 0x80, 0x00, 0x00 };
+    if ( !plWriteFile( TEST_FILE_PATH, buf, sizeof( buf ) ) ) {
+	    printf( "Failed to write \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFile *file = plOpenLocalFile( TEST_FILE_PATH, false );
+    if ( file == NULL ) {
+	    printf( "Failed to open \"" TEST_FILE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    int16_t s[ 9 ];
+    int32_t l[ 4 ];
+    float f;
+    bool result = plReadInt16Array( file, s, 9, true ) == 9 && s[ 0 ] == 0x0102 && s[ 8 ] == 0x1112;
+    plRewindFile( file );
+    result = result && plReadInt16Array( file, s, 9, false ) == 9 && s[ 0 ] == 0x0201 && s[ 8 ] == 0x1211;
+    plRewindFile( file );
+    result = result && plReadInt32Array( file, l, 4, true ) == 4 && l[ 0 ] == 0x01020304 && l[ 3 ] == 0x0D0E0F10;
+    result = result && plFileSeek( file, -4, PL_SEEK_END ) && plReadFloatArray( file, &f, 1, true ) == 1 && f == 1.0f;
+    /* short reads report how many whole elements made it */
+    plRewindFile( file );
+    result = result && plFileSeek( file, 16, PL_SEEK_SET ) && plReadInt32Array( file, l, 4, true ) == 1;
+    plCloseFile( file );
+    plDeleteFile( TEST_FILE_PATH );
+    if ( !result ) {
+	    printf( "Unexpected result from array reads!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+/*============================================================
+ * PACKAGE
+ ===========================================================*/
+
+#include <PL/platform_package.h>
+
+#define TEST_PACKAGE_PATH   "pl_test_package.wad"
+
+/* writes out a small wad with two lumps, "LUMPA" and "LUMPB" */
+static bool WriteTestPackage( void ) {
+	const uint8_t buf[] = {
+	        'P', 'W', 'A', 'D',
+	        0x02, 0x00, 0x00, 0x00, /* num lumps */
+	        0x14, 0x00, 0x00, 0x00, /* table offset */
+	        'a', 'b', 'c', 'd',     /* LUMPA */
+	        'e', 'f', 'g', 'h',     /* LUMPB */
+	        0x0C, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 'L', 'U', 'M', 'P', 'A', 0, 0, 0,
+	        0x10, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 'L', 'U', 'M', 'P', 'B', 0, 0, 0,
+	};
+	return plWriteFile( TEST_PACKAGE_PATH, buf, sizeof( buf ) );
+}
+
+FUNC_TEST( LoadPackageFile )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    plRegisterStandardPackageLoaders();
+    PLPackage *package = plLoadPackage( TEST_PACKAGE_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    /* load them out of order, to ensure each read is positioned,
+     * and wad lumps should be matched regardless of case */
+    const char *names[] = { "LUMPB", "lumpa", "LumpB" };
+    const char *expected[] = { "efgh", "abcd", "efgh" };
+    for ( unsigned int i = 0; i < 3; ++i ) {
+	    PLFile *file = plLoadPackageFile( package, names[ i ] );
+	    if ( file == NULL || plGetFileSize( file ) != 4 || memcmp( plGetFileData( file ), expected[ i ], 4 ) != 0 ) {
+		    printf( "Unexpected contents for %s!\n", names[ i ] );
+		    plCloseFile( file );
+		    plDestroyPackage( package );
+		    return TEST_RETURN_FAILURE;
+	    }
+	    plCloseFile( file );
+    }
+    if ( plGetPackageTableIndex( package, "LUMPB" ) != 1 || plGetPackageTableIndex( package, "LUMPC" ) != ( unsigned int ) -1 ) {
+	    printf( "Unexpected index returned for lump!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    plDeleteFile( TEST_PACKAGE_PATH );
+FUNC_TEST_END()
+
+FUNC_TEST( LoadPackageFileView )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_PACKAGE_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFile *file = plLoadPackageFileView( package, "LUMPB" );
+    if ( file == NULL || plGetFileSize( file ) != 4 || memcmp( plGetFileData( file ), "efgh", 4 ) != 0 ) {
+	    printf( "Unexpected contents for LUMPB view!\n" );
+	    plCloseFile( file );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    bool status;
+    if ( plReadInt8( file, &status ) != 'e' || !plFileSeek( file, 0, PL_SEEK_END ) || !plIsEndOfFile( file ) ) {
+	    printf( "Failed to read from LUMPB view!\n" );
+	    plCloseFile( file );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    plDestroyPackage( package );
+    plDeleteFile( TEST_PACKAGE_PATH );
+FUNC_TEST_END()
+
+typedef struct PackageFileResults {
+	unsigned int numFiles;
+	char contents[ 8 ];
+} PackageFileResults;
+
+static void PackageFileCallback( PLFile *file, unsigned int index, void *userData ) {
+	PackageFileResults *results = userData;
+	if ( file != NULL && plGetFileSize( file ) == 4 && results->numFiles < 2 ) {
+		memcpy( &results->contents[ results->numFiles * 4 ], plGetFileData( file ), 4 );
+	}
+	results->numFiles++;
+	plCloseFile( file );
+}
+
+FUNC_TEST( LoadPackageFiles )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_PACKAGE_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    /* should come back in the order they're stored */
+    unsigned int indices[] = { plGetPackageTableIndex( package, "LUMPB" ), plGetPackageTableIndex( package, "LUMPA" ) };
+    PackageFileResults results = { 0 };
+    if ( !plLoadPackageFiles( package, indices, 2, PackageFileCallback, &results ) ||
+         results.numFiles != 2 || memcmp( results.contents, "abcdefgh", 8 ) != 0 ) {
+	    printf( "Unexpected results from plLoadPackageFiles!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    plDeleteFile( TEST_PACKAGE_PATH );
+FUNC_TEST_END()
+
+#define TEST_PACK_SOURCE_PATH   "pl_test_pack.wad"
+#define TEST_PACK_PATH  "pl_test_pack.pack"
+#define TEST_PACK_LUMP_SIZE 8192
+#define TEST_PACK_CORRUPT_PATH  "pl_test_corrupt.pack"
+
+/* PACK header and table entry sizes, see PLPackageHeader */
+#define TEST_PACK_HEADER_SIZE   32
+#define TEST_PACK_INDEX_SIZE    48
+
+/**
+ * Writes out a copy of the baked package with one table field replaced,
+ * and checks whether it still loads.
+ */
+static bool LoadPatchedPack( const uint8_t *data, size_t size, size_t fieldOffset, uint64_t value ) {
+	uint8_t *copy = pl_malloc( size );
+	memcpy( copy, data, size );
+	memcpy( &copy[ fieldOffset ], &value, sizeof( uint64_t ) );
+	bool result = plWriteFile( TEST_PACK_CORRUPT_PATH, copy, size );
+	pl_free( copy );
+
+	PLPackage *package = result ? plLoadPackage( TEST_PACK_CORRUPT_PATH ) : NULL;
+	plDestroyPackage( package );
+	plDeleteFile( TEST_PACK_CORRUPT_PATH );
+	return ( package != NULL );
+}
+
+FUNC_TEST( WritePackage )
+    /* a tiny lump, one that compresses well and one that doesn't at all */
+    size_t tableOffset = 12 + 4 + TEST_PACK_LUMP_SIZE * 2;
+    uint8_t *buf = pl_calloc( 1, tableOffset + 48 );
+    memcpy( buf, "PWAD", 4 );
+    buf[ 4 ] = 3;
+    memcpy( &buf[ 8 ], &( uint32_t ){ ( uint32_t ) tableOffset }, 4 );
+    memcpy( &buf[ 12 ], "abcd", 4 );
+    memset( &buf[ 16 ], 'z', TEST_PACK_LUMP_SIZE );
+    uint32_t seed = 1;
+    for ( unsigned int i = 0; i < TEST_PACK_LUMP_SIZE; ++i ) {
+	    seed = seed * 1103515245 + 12345;
+	    buf[ 16 + TEST_PACK_LUMP_SIZE + i ] = ( uint8_t ) ( seed >> 16 );
+    }
+    uint32_t table[] = { 12, 4, 0, 0, 16, TEST_PACK_LUMP_SIZE, 0, 0, 16 + TEST_PACK_LUMP_SIZE, TEST_PACK_LUMP_SIZE, 0, 0 };
+    memcpy( &buf[ tableOffset ], table, sizeof( table ) );
+    memcpy( &buf[ tableOffset + 8 ], "LUMPA", 5 );
+    memcpy( &buf[ tableOffset + 24 ], "LUMPC", 5 );
+    memcpy( &buf[ tableOffset + 40 ], "LUMPD", 5 );
+    bool status = plWriteFile( TEST_PACK_SOURCE_PATH, buf, tableOffset + 48 );
+    pl_free( buf );
+    if ( !status ) {
+	    printf( "Failed to write \"" TEST_PACK_SOURCE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_PACK_SOURCE_PATH );
+    if ( package == NULL || !plWritePackage( package, TEST_PACK_PATH, PL_COMPRESSION_ZLIB ) ) {
+	    printf( "Failed to bake \"" TEST_PACK_SOURCE_PATH "\"!\nERR: %s\n", plGetError() );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    package = plLoadPackage( TEST_PACK_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_PACK_PATH "\"!\nERR: %s\n", plGetError() );
+	    return TEST_RETURN_FAILURE;
+    }
+    const PLPackageIndex *index = plGetPackageIndex( package, "lumpc" );
+    if ( index == NULL || index->compressionType != PL_COMPRESSION_ZLIB || index->contentHash == 0 ) {
+	    printf( "Unexpected table entry for LUMPC!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    index = plGetPackageIndex( package, "LUMPD" );
+    if ( index == NULL || index->compressionType != PL_COMPRESSION_NONE || index->offset % 4096 != 0 ) {
+	    printf( "Unexpected table entry for LUMPD!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFile *file = plLoadPackageFile( package, "LUMPC" );
+    if ( file == NULL || plGetFileSize( file ) != TEST_PACK_LUMP_SIZE || plGetFileData( file )[ TEST_PACK_LUMP_SIZE - 1 ] != 'z' ) {
+	    printf( "Unexpected contents for LUMPC!\n" );
+	    plCloseFile( file );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    file = plLoadPackageFileView( package, "LUMPA" );
+    if ( file == NULL || plGetFileSize( file ) != 4 || memcmp( plGetFileData( file ), "abcd", 4 ) != 0 ) {
+	    printf( "Unexpected contents for LUMPA!\n" );
+	    plCloseFile( file );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    /* the same file spelt differently still mustn't be written over */
+    if ( plWritePackage( package, "./" TEST_PACK_PATH, PL_COMPRESSION_NONE ) ) {
+	    printf( "Package was written over itself!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    /* entries running past the end, stored ones whose sizes disagree, or
+     * compressed ones claiming to be far larger than they could be, are rejected */
+    file = plOpenLocalFile( TEST_PACK_PATH, true );
+    if ( file == NULL ) {
+	    printf( "Failed to open \"" TEST_PACK_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    const uint8_t *packData = plGetFileData( file );
+    size_t packSize = plGetFileSize( file );
+    size_t storedEntry = TEST_PACK_HEADER_SIZE;
+    while ( packData[ storedEntry + 44 ] != PL_COMPRESSION_NONE ) {
+	    storedEntry += TEST_PACK_INDEX_SIZE;
+    }
+    size_t zlibEntry = TEST_PACK_HEADER_SIZE;
+    while ( packData[ zlibEntry + 44 ] != PL_COMPRESSION_ZLIB ) {
+	    zlibEntry += TEST_PACK_INDEX_SIZE;
+    }
+    uint64_t storedSize;
+    memcpy( &storedSize, &packData[ storedEntry + 8 ], sizeof( uint64_t ) );
+    bool result = LoadPatchedPack( packData, packSize, storedEntry + 16, storedSize ) &&
+                  !LoadPatchedPack( packData, packSize, storedEntry, packSize - 1 ) &&
+                  !LoadPatchedPack( packData, packSize, storedEntry + 16, storedSize - 1 ) &&
+                  !LoadPatchedPack( packData, packSize, zlibEntry + 8, UINT64_MAX / 2 );
+    plCloseFile( file );
+    plDeleteFile( TEST_PACK_PATH );
+    plDeleteFile( TEST_PACK_SOURCE_PATH );
+    if ( !result ) {
+	    printf( "Unexpected result from corrupt package!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+/* the same text, deflated with dynamic and fixed Huffman codes */
+static const char inflateText[] = "Sphinx of black quartz, judge my vow! Pack my box with five dozen liquor jugs. How vexingly quick daft zebras jump; the five boxing wizards jump quickly. Sphinx of black quartz, judge my vow!";
+static const char inflateStoredText[] = "Stored, not deflated.";
+static const uint8_t inflateDynamic[] = {
+	0x78, 0xDA, 0x8D, 0x8E, 0xC9, 0x0D, 0xC2, 0x30, 0x14, 0x44, 0x5B, 0x19, 0xEE, 0x28, 0x0D, 0xD0,
+	0x00, 0x47, 0xA4, 0x54, 0x60, 0xE3, 0x15, 0x1C, 0x3B, 0x71, 0xBC, 0x57, 0x9F, 0x8F, 0xDC, 0x00,
+	0xC7, 0xD1, 0xCC, 0x7B, 0x9A, 0x75, 0x37, 0xD6, 0x37, 0x04, 0x05, 0xEE, 0xD8, 0xFB, 0x8B, 0x23,
+	0xB3, 0x98, 0xC6, 0x1D, 0x9F, 0x2C, 0xB4, 0xC4, 0xD6, 0x51, 0x42, 0xBD, 0xE1, 0xF5, 0xAB, 0x28,
+	0xF0, 0xD0, 0x50, 0x6D, 0x32, 0x50, 0xB6, 0x48, 0x88, 0x30, 0xA4, 0x87, 0xB3, 0x47, 0x0E, 0x91,
+	0x00, 0x7D, 0x2E, 0x78, 0x86, 0x8A, 0x22, 0x9B, 0xF5, 0xDA, 0x75, 0x72, 0x59, 0xC2, 0x04, 0x53,
+	0x09, 0x43, 0xF2, 0xC8, 0x4E, 0x1A, 0x6D, 0xFB, 0x03, 0xC9, 0xC8, 0x29, 0x20, 0x1D, 0x2D, 0xC9,
+	0x38, 0x58, 0x14, 0xB3, 0x9D, 0x90, 0xEB, 0x0B, 0xD6, 0x7F, 0x9E, 0x5D, 0xE8, 0x50, 0x45, 0x3A,
+};
+
+static const uint8_t inflateFixed[] = {
+	0x0B, 0x2E, 0xC8, 0xC8, 0xCC, 0xAB, 0x50, 0xC8, 0x4F, 0x53, 0x48, 0xCA, 0x49, 0x4C, 0xCE, 0x56,
+	0x28, 0x2C, 0x4D, 0x2C, 0x2A, 0xA9, 0xD2, 0x51, 0xC8, 0x2A, 0x4D, 0x49, 0x4F, 0x55, 0xC8, 0xAD,
+	0x54, 0x28, 0xCB, 0x2F, 0x57, 0x54, 0x08, 0x00, 0x49, 0x01, 0x39, 0x49, 0xF9, 0x15, 0x0A, 0xE5,
+	0x99, 0x25, 0x19, 0x0A, 0x69, 0x99, 0x65, 0xA9, 0x0A, 0x29, 0xF9, 0x55, 0xA9, 0x79, 0x0A, 0x39,
+	0x99, 0x85, 0xA5, 0xF9, 0x45, 0x40, 0x0D, 0xE9, 0xC5, 0x7A, 0x0A, 0x1E, 0xF9, 0xE5, 0x0A, 0x65,
+	0xA9, 0x15, 0x99, 0x79, 0xE9, 0x39, 0x95, 0x40, 0xB3, 0x32, 0x81, 0xDA, 0x52, 0x12, 0xD3, 0x4A,
+	0x14, 0xAA, 0x52, 0x93, 0x8A, 0x12, 0x8B, 0x81, 0x8A, 0x72, 0x0B, 0xAC, 0x15, 0x4A, 0x32, 0x52,
+	0x21, 0x06, 0x00, 0x8D, 0x03, 0xAA, 0x04, 0x9A, 0x58, 0x95, 0x58, 0x94, 0x02, 0x91, 0x85, 0x68,
+	0xCA, 0xA9, 0xD4, 0x53, 0x08, 0x26, 0xC6, 0x65, 0x00,
+};
+
+static const uint8_t inflateStored[] = {
+	0x78, 0x01, 0x01, 0x15, 0x00, 0xEA, 0xFF, 0x53, 0x74, 0x6F, 0x72, 0x65, 0x64, 0x2C, 0x20, 0x6E,
+	0x6F, 0x74, 0x20, 0x64, 0x65, 0x66, 0x6C, 0x61, 0x74, 0x65, 0x64, 0x2E, 0x54, 0x5C, 0x07, 0x96,
+};
+
+typedef struct TestPackEntry {
+	const uint8_t *data;
+	size_t length;
+	size_t fileSize;
+	PLCompressionType compressionType;
+} TestPackEntry;
+
+/* writes out a baked package holding the given entries, each named after its index */
+static bool WriteTestPack( const char *path, const TestPackEntry *entries, unsigned int numEntries ) {
+	size_t namesOffset = TEST_PACK_HEADER_SIZE + TEST_PACK_INDEX_SIZE * numEntries;
+	size_t namesLength = 1 + numEntries * 2;
+	size_t size = namesOffset + namesLength;
+	for ( unsigned int i = 0; i < numEntries; ++i ) {
+		size += entries[ i ].length;
+	}
+
+	uint8_t *buf = pl_calloc( 1, size );
+	memcpy( buf, "PACK", 4 );
+	buf[ 4 ] = 2; /* version */
+	memcpy( &buf[ 8 ], &( uint32_t ){ numEntries }, 4 );
+	memcpy( &buf[ 12 ], &( uint32_t ){ ( uint32_t ) namesLength }, 4 );
+	memcpy( &buf[ 16 ], &( uint64_t ){ TEST_PACK_HEADER_SIZE }, 8 );
+	memcpy( &buf[ 24 ], &( uint64_t ){ namesOffset }, 8 );
+
+	size_t offset = namesOffset + namesLength;
+	for ( unsigned int i = 0; i < numEntries; ++i ) {
+		uint8_t *index = &buf[ TEST_PACK_HEADER_SIZE + TEST_PACK_INDEX_SIZE * i ];
+		memcpy( &index[ 0 ], &( uint64_t ){ offset }, 8 );
+		memcpy( &index[ 8 ], &( uint64_t ){ entries[ i ].fileSize }, 8 );
+		memcpy( &index[ 16 ], &( uint64_t ){ entries[ i ].length }, 8 );
+		memcpy( &index[ 32 ], &( uint32_t ){ 1 + i * 2 }, 4 );
+		/* lookups go by the case-folded FNV-1a hash of the name */
+		char name = ( char ) ( '0' + i );
+		memcpy( &index[ 36 ], &( uint32_t ){ 1 }, 4 );
+		memcpy( &index[ 40 ], &( uint32_t ){ ( 2166136261u ^ ( uint8_t ) name ) * 16777619u }, 4 );
+		index[ 44 ] = ( uint8_t ) entries[ i ].compressionType;
+
+		buf[ namesOffset + 1 + i * 2 ] = name;
+		memcpy( &buf[ offset ], entries[ i ].data, entries[ i ].length );
+		offset += entries[ i ].length;
+	}
+
+	bool result = plWriteFile( path, buf, size );
+	pl_free( buf );
+	return result;
+}
+
+static bool testCodecCalled = false;
+
+/* stand-in for a plugin's codec, which just inverts each byte */
+static bool DecompressInverted( PLCompressionReadFunction Read, void *source, uint8_t *dest, size_t destLength ) {
+	testCodecCalled = true;
+	if ( Read( source, dest, destLength ) != destLength ) {
+		return false;
+	}
+	for ( size_t i = 0; i < destLength; ++i ) {
+		dest[ i ] = ( uint8_t ) ~dest[ i ];
+	}
+	return true;
+}
+
+static bool CompareTestPackFile( PLPackage *package, unsigned int index, const char *expected ) {
+	PLFile *file = plLoadPackageFileByIndex( package, index );
+	bool result = file != NULL && plGetFileSize( file ) == strlen( expected ) &&
+	              memcmp( plGetFileData( file ), expected, strlen( expected ) ) == 0;
+	plCloseFile( file );
+	return result;
+}
+
+FUNC_TEST( InflatePackageFile )
+    uint8_t corrupt[ sizeof( inflateDynamic ) ];
+    memcpy( corrupt, inflateDynamic, sizeof( corrupt ) );
+    corrupt[ sizeof( corrupt ) - 1 ] ^= 0xFF; /* adler32 */
+    const char customText[] = "Decompressed by a plugin.";
+    uint8_t custom[ sizeof( customText ) - 1 ];
+    for ( unsigned int i = 0; i < sizeof( custom ); ++i ) {
+	    custom[ i ] = ( uint8_t ) ~customText[ i ];
+    }
+    const TestPackEntry entries[] = {
+            { inflateDynamic, sizeof( inflateDynamic ), sizeof( inflateText ) - 1, PL_COMPRESSION_ZLIB },
+            { inflateStored, sizeof( inflateStored ), sizeof( inflateStoredText ) - 1, PL_COMPRESSION_ZLIB },
+            { inflateFixed, sizeof( inflateFixed ), sizeof( inflateText ) - 1, PL_COMPRESSION_DEFLATE },
+            { corrupt, sizeof( corrupt ), sizeof( inflateText ) - 1, PL_COMPRESSION_ZLIB },
+            { custom, sizeof( custom ), sizeof( custom ), PL_COMPRESSION_USER },
+    };
+    if ( !WriteTestPack( TEST_PACK_PATH, entries, plArrayElements( entries ) ) ) {
+	    printf( "Failed to write \"" TEST_PACK_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_PACK_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_PACK_PATH "\"!\nERR: %s\n", plGetError() );
+	    plDeleteFile( TEST_PACK_PATH );
+	    return TEST_RETURN_FAILURE;
+    }
+    bool result = CompareTestPackFile( package, 0, inflateText ) &&
+                  CompareTestPackFile( package, 1, inflateStoredText ) &&
+                  CompareTestPackFile( package, 2, inflateText );
+    /* a bad checksum means the whole file is thrown out */
+    PLFile *file = plLoadPackageFileByIndex( package, 3 );
+    result = result && file == NULL;
+    plCloseFile( file );
+    /* nothing's registered for it yet, then it should go through our codec */
+    result = result && plLoadPackageFileByIndex( package, 4 ) == NULL && !testCodecCalled &&
+             plRegisterCompressionCodec( PL_COMPRESSION_USER, DecompressInverted ) &&
+             CompareTestPackFile( package, 4, customText ) && testCodecCalled;
+    plRegisterCompressionCodec( PL_COMPRESSION_USER, NULL );
+    plDestroyPackage( package );
+    plDeleteFile( TEST_PACK_PATH );
+    if ( !result ) {
+	    printf( "Unexpected result from compressed package files!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+#define TEST_COPY_PATH  "pl_test_copy.wad"
+#define TEST_EXTRACT_PATH   "pl_test_extract.bin"
+
+FUNC_TEST( ExtractPackageFile )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    if ( !plCopyFile( TEST_PACKAGE_PATH, TEST_COPY_PATH ) || plGetLocalFileSize( TEST_COPY_PATH ) != 52 ) {
+	    printf( "Failed to copy \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_COPY_PATH );
+    if ( package == NULL ) {
+	    printf( "Failed to load \"" TEST_COPY_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    int index = plGetPackageTableIndex( package, "LUMPB" );
+    /* neither should be able to write over what it's reading from */
+    if ( index < 0 || plCopyFile( TEST_COPY_PATH, "./" TEST_COPY_PATH ) ||
+         plExtractPackageFile( package, ( unsigned int ) index, TEST_COPY_PATH ) ||
+         plGetLocalFileSize( TEST_COPY_PATH ) != 52 ) {
+	    printf( "Copied \"" TEST_COPY_PATH "\" over itself!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    if ( !plExtractPackageFile( package, ( unsigned int ) index, TEST_EXTRACT_PATH ) ) {
+	    printf( "Failed to extract LUMPB!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    PLFile *file = plOpenLocalFile( TEST_EXTRACT_PATH, true );
+    if ( file == NULL || plGetFileSize( file ) != 4 || memcmp( plGetFileData( file ), "efgh", 4 ) != 0 ) {
+	    printf( "Unexpected contents for extracted LUMPB!\n" );
+	    plCloseFile( file );
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    plDeleteFile( TEST_EXTRACT_PATH );
+    plDeleteFile( TEST_COPY_PATH );
+    plDeleteFile( TEST_PACKAGE_PATH );
+FUNC_TEST_END()
+
+#define TEST_INDEX_CACHE_PATH   "pl_test_toc"
+
+static void DeleteFileCallback( const char *path, void *userData ) {
+	plUnused( userData );
+	plDeleteFile( path );
+}
+
+FUNC_TEST( PackageIndexCache )
+    if ( !WriteTestPackage() || !plEnablePackageIndexCache( TEST_INDEX_CACHE_PATH ) ) {
+	    printf( "Failed to set up package index cache!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLPackage *package = plLoadPackage( TEST_PACKAGE_PATH );
+    plDestroyPackage( package );
+    /* without any loaders, the cached table is the only way it can be loaded */
+    plClearPackageLoaders();
+    package = plLoadPackage( TEST_PACKAGE_PATH );
+    PLFile *file = ( package != NULL ) ? plLoadPackageFile( package, "lumpb" ) : NULL;
+    if ( file == NULL || plGetFileSize( file ) != 4 || memcmp( plGetFileData( file ), "efgh", 4 ) != 0 ) {
+	    printf( "Unexpected contents for cached LUMPB!\n" );
+	    plCloseFile( file );
+	    plDestroyPackage( package );
+	    plRegisterStandardPackageLoaders();
+	    return TEST_RETURN_FAILURE;
+    }
+    plCloseFile( file );
+    plDestroyPackage( package );
+    /* the same package, spelt differently, shares the cached table */
+    package = plLoadPackage( "./" TEST_PACKAGE_PATH );
+    if ( package == NULL ) {
+	    printf( "Cached table wasn't found for \"./" TEST_PACKAGE_PATH "\"!\n" );
+	    plRegisterStandardPackageLoaders();
+	    return TEST_RETURN_FAILURE;
+    }
+    plDestroyPackage( package );
+    /* and once it's changed, the cached table should no longer be used */
+    const uint8_t data[] = { 'P', 'W', 'A', 'D' };
+    plWriteFile( TEST_PACKAGE_PATH, data, sizeof( data ) );
+    package = plLoadPackage( TEST_PACKAGE_PATH );
+    plRegisterStandardPackageLoaders();
+    plEnablePackageIndexCache( NULL );
+    plScanDirectory( TEST_INDEX_CACHE_PATH, "toc", DeleteFileCallback, false, NULL );
+    REMOVE_TEST_DIRECTORY( TEST_INDEX_CACHE_PATH );
+    plDeleteFile( TEST_PACKAGE_PATH );
+    if ( package != NULL ) {
+	    printf( "Unexpected use of stale cached table!\n" );
+	    plDestroyPackage( package );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( StatFile )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFileStat stats;
+    if ( !plStatFile( TEST_PACKAGE_PATH, &stats ) || stats.size != 52 || stats.mount != NULL ) {
+	    printf( "Unexpected stats for \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFileSystemMount *mount = plMountLocation( TEST_PACKAGE_PATH );
+    if ( mount == NULL ) {
+	    printf( "Failed to mount \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    bool result = plStatFile( "LUMPA", &stats ) && stats.size == 4 && stats.mount == mount &&
+                  !plFileExists( "LUMPC" );
+    plClearMountedLocation( mount );
+    if ( !result ) {
+	    printf( "Unexpected stats for mounted package!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    plDeleteFile( TEST_PACKAGE_PATH );
+FUNC_TEST_END()
+
+static void AsyncRequestCallback( PLFileRequest *request, void *userData ) {
+	*( size_t * ) userData = plGetFileRequestLength( request );
+}
+
+FUNC_TEST( ReadFileAsync )
+    if ( !WriteTestPackage() ) {
+	    printf( "Failed to write \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    /* plain reads against an uncached local file */
+    PLFile *file = plOpenLocalFile( TEST_PACKAGE_PATH, false );
+    if ( file == NULL ) {
+	    printf( "Failed to open \"" TEST_PACKAGE_PATH "\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    char data[ 4 ][ 8 ];
+    size_t lengths[ 4 ] = { 0, 0, 0, 0 };
+    PLFileRequest *requests[ 4 ];
+    for ( unsigned int i = 0; i < 4; ++i ) {
+	    requests[ i ] = plReadFileAsync( file, data[ i ], 8, 12 + i * 8, AsyncRequestCallback, &lengths[ i ] );
+    }
+    bool result = true;
+    for ( unsigned int i = 0; i < 4; ++i ) {
+	    result = result && requests[ i ] != NULL && plWaitFileRequest( requests[ i ] ) == PL_FILE_REQUEST_COMPLETE &&
+	             plPollFileRequest( requests[ i ] ) == PL_FILE_REQUEST_COMPLETE && lengths[ i ] == 8;
+	    plDestroyFileRequest( requests[ i ] );
+    }
+    result = result && memcmp( data[ 0 ], "abcdefgh", 8 ) == 0 && data[ 1 ][ 0 ] == 0x0C;
+    /* reading past the end fails rather than hanging */
+    PLFileRequest *request = plReadFileAsync( file, data[ 0 ], 8, 1024, NULL, NULL );
+    result = result && request != NULL && plWaitFileRequest( request ) == PL_FILE_REQUEST_FAILED;
+    plDestroyFileRequest( request );
+    plCloseFile( file );
+    /* and then opening, and reading from, a package member */
+    PLFileSystemMount *mount = plMountLocation( TEST_PACKAGE_PATH );
+    request = plOpenFileAsync( "LUMPB", true, NULL, NULL );
+    result = result && request != NULL && plWaitFileRequest( request ) == PL_FILE_REQUEST_COMPLETE;
+    file = ( request != NULL ) ? plGetFileRequestFile( request ) : NULL;
+    plDestroyFileRequest( request );
+    if ( file != NULL ) {
+	    request = plReadFileAsync( file, data[ 0 ], 4, 0, NULL, NULL );
+	    result = result && plWaitFileRequest( request ) == PL_FILE_REQUEST_COMPLETE &&
+	             plGetFileRequestLength( request ) == 4 && memcmp( data[ 0 ], "efgh", 4 ) == 0;
+	    plDestroyFileRequest( request );
+	    plCloseFile( file );
+    }
+    plClearMountedLocation( mount );
+    plDeleteFile( TEST_PACKAGE_PATH );
+    /* writes hand back the number of bytes written */
+    request = plWriteFileAsync( "pl_test_async.bin", "abcdefgh", 8, AsyncRequestCallback, &lengths[ 0 ] );
+    result = result && request != NULL && plWaitFileRequest( request ) == PL_FILE_REQUEST_COMPLETE && lengths[ 0 ] == 8;
+    plDestroyFileRequest( request );
+    file = plOpenLocalFile( "pl_test_async.bin", true );
+    result = result && file != NULL && plGetFileSize( file ) == 8 && memcmp( plGetFileData( file ), "abcdefgh", 8 ) == 0;
+    plCloseFile( file );
+    plDeleteFile( "pl_test_async.bin" );
+    if ( !result ) {
+	    printf( "Unexpected result from async requests!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+typedef struct ScanResults {
+	char paths[ 8 ][ 64 ];
+	unsigned int numPaths;
+} ScanResults;
+
+static void ScanBatchCallback( const char **paths, unsigned int numPaths, void *userData ) {
+	ScanResults *results = userData;
+	for ( unsigned int i = 0; i < numPaths; ++i, ++results->numPaths ) {
+		if ( results->numPaths < 8 ) {
+			snprintf( results->paths[ results->numPaths ], sizeof( results->paths[ 0 ] ), "%s", paths[ i ] );
+		}
+	}
+}
+
+FUNC_TEST( ScanDirectory )
+    const char *files[] = {
+            "pl_test_scan/a/sub/x.txt",
+            "pl_test_scan/a/sub/y.txt",
+            "pl_test_scan/c/sub/deep/z.txt",
+            "pl_test_scan/c/sub/x.txt",
+            "pl_test_scan/c/sub/w.bin",
+    };
+    const uint8_t buf[] = { 'a', 'b', 'c', 'd' };
+    if ( !plCreatePath( "pl_test_scan/a/sub" ) || !plCreatePath( "pl_test_scan/c/sub/deep" ) ) {
+	    printf( "Failed to create test directories!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    for ( unsigned int i = 0; i < plArrayElements( files ); ++i ) {
+	    if ( !plWriteFile( files[ i ], buf, sizeof( buf ) ) ) {
+		    printf( "Failed to write \"%s\"!\n", files[ i ] );
+		    return TEST_RETURN_FAILURE;
+	    }
+    }
+#if !defined( _WIN32 )
+    /* a link back up the tree shouldn't be followed round and round */
+    symlink( "..", "pl_test_scan/c/sub/deep/loop" );
+#endif
+    ScanResults results;
+    memset( &results, 0, sizeof( ScanResults ) );
+    plScanDirectoryBatched( "pl_test_scan", "txt", ScanBatchCallback, PL_SCAN_RECURSIVE | PL_SCAN_SORTED, &results );
+    bool result = results.numPaths == 4;
+    for ( unsigned int i = 0; result && i < 4; ++i ) {
+	    result = strcmp( results.paths[ i ], files[ i ] ) == 0;
+    }
+    /* both mounts provide sub/x.txt, but it should only turn up once */
+    PLFileSystemMount *mountA = plMountLocalLocation( "pl_test_scan/a" );
+    PLFileSystemMount *mountC = plMountLocalLocation( "pl_test_scan/c" );
+    memset( &results, 0, sizeof( ScanResults ) );
+    plScanDirectoryBatched( "sub", "txt", ScanBatchCallback, PL_SCAN_RECURSIVE, &results );
+    result = result && mountA != NULL && mountC != NULL && results.numPaths == 3;
+    memset( &results, 0, sizeof( ScanResults ) );
+    plScanDirectoryBatched( "sub", NULL, ScanBatchCallback, PL_SCAN_SORTED, &results );
+    result = result && results.numPaths == 3 && strcmp( results.paths[ 0 ], "sub/w.bin" ) == 0;
+    plClearMountedLocations();
+    for ( unsigned int i = 0; i < plArrayElements( files ); ++i ) {
+	    plDeleteFile( files[ i ] );
+    }
+#if !defined( _WIN32 )
+    unlink( "pl_test_scan/c/sub/deep/loop" );
+#endif
+    const char *directories[] = {
+            "pl_test_scan/a/sub",
+            "pl_test_scan/a",
+            "pl_test_scan/c/sub/deep",
+            "pl_test_scan/c/sub",
+            "pl_test_scan/c",
+            "pl_test_scan",
+    };
+    for ( unsigned int i = 0; i < plArrayElements( directories ); ++i ) {
+	    REMOVE_TEST_DIRECTORY( directories[ i ] );
+    }
+    if ( !result ) {
+	    printf( "Unexpected result from directory scan!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( ScanPackage )
+    const uint8_t buf[] = {
+            'P', 'W', 'A', 'D',
+            0x03, 0x00, 0x00, 0x00, /* num lumps */
+            0x18, 0x00, 0x00, 0x00, /* table offset */
+            'a', 'b', 'c', 'd',
+            'e', 'f', 'g', 'h',
+            'i', 'j', 'k', 'l',
+            0x0C, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 'D', '/', 'X', '.', 'B', 'M', 'P', 0,
+            0x10, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 'D', '/', 'E', '/', 'Y', '.', 'T', 0,
+            0x14, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 'Z', '.', 'B', 'M', 'P', 0, 0, 0,
+    };
+    if ( !plWriteFile( "pl_test_tree.wad", buf, sizeof( buf ) ) ) {
+	    printf( "Failed to write \"pl_test_tree.wad\"!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFileSystemMount *mount = plMountLocation( "pl_test_tree.wad" );
+    bool result = mount != NULL && plPathExists( "d" ) && plPathExists( "D/E" ) && !plPathExists( "D/X.BMP" ) &&
+                  !plPathExists( "Q" );
+    ScanResults results;
+    memset( &results, 0, sizeof( ScanResults ) );
+    plScanDirectoryBatched( "", "bmp", ScanBatchCallback, PL_SCAN_RECURSIVE | PL_SCAN_SORTED, &results );
+    result = result && results.numPaths == 2 && strcmp( results.paths[ 0 ], "D/X.BMP" ) == 0 &&
+             strcmp( results.paths[ 1 ], "Z.BMP" ) == 0;
+    memset( &results, 0, sizeof( ScanResults ) );
+    plScanDirectoryBatched( "d", NULL, ScanBatchCallback, 0, &results );
+    result = result && results.numPaths == 1 && strcmp( results.paths[ 0 ], "D/X.BMP" ) == 0;
+    /* and again via the index */
+    plEnableFileSystemIndex( true );
+    result = result && plPathExists( "d/e" ) && !plPathExists( "d/x.bmp" );
+    plEnableFileSystemIndex( false );
+    plClearMountedLocations();
+    plDeleteFile( "pl_test_tree.wad" );
+    if ( !result ) {
+	    printf( "Unexpected result from package scan!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+typedef struct WatchResults {
+	char path[ 64 ];
+	PLFileChangeType type;
+	unsigned int numChanges;
+} WatchResults;
+
+static void WatchCallback( const char *path, PLFileChangeType type, void *userData ) {
+	WatchResults *results = userData;
+	snprintf( results->path, sizeof( results->path ), "%s", path );
+	results->type = type;
+	results->numChanges++;
+}
+
+FUNC_TEST( WatchPath )
+    const uint8_t buf[] = { 'a', 'b', 'c', 'd' };
+    if ( !plCreatePath( "pl_test_watch/sub/deep" ) ) {
+	    printf( "Failed to create test directories!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    PLFileSystemMount *mount = plMountLocalLocation( "pl_test_watch" );
+    WatchResults dirResults, fileResults;
+    memset( &dirResults, 0, sizeof( WatchResults ) );
+    memset( &fileResults, 0, sizeof( WatchResults ) );
+    PLFileWatch *dirWatch = plWatchPath( "sub", true, WatchCallback, &dirResults );
+    PLFileWatch *fileWatch = plWatchPath( "sub/b.txt", false, WatchCallback, &fileResults );
+    bool result = mount != NULL && dirWatch != NULL && fileWatch != NULL && plPollFileChanges() == 0;
+    /* created and then written, should come back as a single change, and the temporary file not at all */
+    result = result && plWriteFile( "pl_test_watch/sub/deep/a.txt", buf, sizeof( buf ) ) &&
+             plWriteFile( "pl_test_watch/sub/tmp.txt", buf, sizeof( buf ) ) && plDeleteFile( "pl_test_watch/sub/tmp.txt" );
+    result = result && plPollFileChanges() == 1 && dirResults.numChanges == 1 &&
+             strcmp( dirResults.path, "sub/deep/a.txt" ) == 0 && dirResults.type == PL_FILE_CHANGE_CREATED;
+    result = result && plWriteFile( "pl_test_watch/sub/deep/a.txt", buf, sizeof( buf ) ) && plPollFileChanges() == 1 &&
+             dirResults.type == PL_FILE_CHANGE_MODIFIED && fileResults.numChanges == 0;
+    result = result && plWriteFile( "pl_test_watch/sub/b.txt", buf, sizeof( buf ) ) && plPollFileChanges() == 2 &&
+             fileResults.numChanges == 1 && strcmp( fileResults.path, "sub/b.txt" ) == 0;
+    plUnwatchPath( dirWatch );
+    result = result && plDeleteFile( "pl_test_watch/sub/b.txt" ) && plPollFileChanges() == 1 &&
+             fileResults.type == PL_FILE_CHANGE_DELETED && dirResults.numChanges == 3;
+    plUnwatchPath( fileWatch );
+    plClearMountedLocation( mount );
+    plDeleteFile( "pl_test_watch/sub/deep/a.txt" );
+    REMOVE_TEST_DIRECTORY( "pl_test_watch/sub/deep" );
+    REMOVE_TEST_DIRECTORY( "pl_test_watch/sub" );
+    REMOVE_TEST_DIRECTORY( "pl_test_watch" );
+    if ( !result ) {
+	    printf( "Unexpected result from file watch!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( FileCache )
+    const uint8_t buf[] = { 'a', 'b', 'c', 'd' };
+    if ( !WriteTestPackage() || !plWriteFile( TEST_FILE_PATH, buf, sizeof( buf ) ) ) {
+	    printf( "Failed to write test files!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    plEnableFileCache( 1024 );
+    /* second open should share the first one's buffer */
+    PLFile *fileA = plOpenFile( TEST_FILE_PATH, true );
+    PLFile *fileB = plOpenFile( TEST_FILE_PATH, true );
+    PLFileCacheStats stats;
+    plGetFileCacheStats( &stats );
+    bool result = fileA != NULL && fileB != NULL && plGetFileData( fileA ) == plGetFileData( fileB ) &&
+                  stats.numHits == 1 && stats.numMisses == 1 && stats.numEntries == 1 && stats.size == sizeof( buf );
+    /* flushing leaves open handles alone */
+    plFlushFileCache();
+    result = result && memcmp( plGetFileData( fileB ), buf, sizeof( buf ) ) == 0;
+    plCloseFile( fileA );
+    plCloseFile( fileB );
+    /* rewriting the file means the cached copy is stale */
+    fileA = plOpenFile( TEST_FILE_PATH, true );
+    plCloseFile( fileA );
+    const uint8_t newBuf[] = { 'e', 'f', 'g', 'h' };
+    result = result && plWriteFile( TEST_FILE_PATH, newBuf, sizeof( newBuf ) );
+    fileA = plOpenFile( TEST_FILE_PATH, true );
+    result = result && fileA != NULL && memcmp( plGetFileData( fileA ), newBuf, sizeof( newBuf ) ) == 0;
+    plCloseFile( fileA );
+    /* package members are cached too, and the budget is respected */
+    PLFileSystemMount *mount = plMountLocation( TEST_PACKAGE_PATH );
+    plEnableFileCache( 8 );
+    fileA = plOpenFile( "LUMPA", true );
+    fileB = plOpenFile( "lumpa", true );
+    result = result && fileA != NULL && fileB != NULL && plGetFileData( fileA ) == plGetFileData( fileB );
+    plCloseFile( fileA );
+    plCloseFile( fileB );
+    fileA = plOpenFile( "LUMPB", true );
+    plCloseFile( fileA );
+    plGetFileCacheStats( &stats );
+    result = result && stats.size <= 8 && stats.numEvictions > 0;
+    plClearMountedLocation( mount );
+    plEnableFileCache( 0 );
+    plGetFileCacheStats( &stats );
+    result = result && stats.numEntries == 0;
+    plDeleteFile( TEST_FILE_PATH );
+    plDeleteFile( TEST_PACKAGE_PATH );
+    if ( !result ) {
+	    printf( "Unexpected result from file cache!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( FileSystemIndex )
+    const uint8_t buf[] = { 'a', 'b', 'c', 'd' };
+    if ( !WriteTestPackage() || !plCreatePath( "pl_test_dir/sub" ) || !plWriteFile( "pl_test_dir/sub/a.txt", buf, sizeof( buf ) ) ||
+         !plCopyFile( TEST_PACKAGE_PATH, "pl_test_dir/" TEST_PACKAGE_PATH ) ) {
+	    printf( "Failed to write test files!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+#if !defined( _WIN32 )
+    /* a link back to the mount must not send indexing round in circles */
+    symlink( ".", "pl_test_dir/sub/loop" );
+#endif
+    plEnableFileSystemIndex( true );
+    /* once the directory is mounted, the package is found within it */
+    PLFileSystemMount *dirMount = plMountLocation( "pl_test_dir" );
+    PLFileSystemMount *packageMount = plMountLocation( TEST_PACKAGE_PATH );
+    bool result = ( dirMount != NULL && packageMount != NULL );
+    if ( result ) {
+	    PLFileStat stats;
+	    result = plStatFile( "sub/a.txt", &stats ) && stats.mount == dirMount &&
+	             plStatFile( "lumpb", &stats ) && stats.mount == packageMount &&
+	             plPathExists( "sub" ) && !plPathExists( "sub/a.txt" ) &&
+	             !plFileExists( "sub/b.txt" ) && !plFileExists( "sub/b.txt" );
+	    /* writing a file should invalidate the cached miss */
+	    result = result && plWriteFile( "pl_test_dir/sub/b.txt", buf, sizeof( buf ) ) && plFileExists( "sub/b.txt" );
+	    PLFile *file = plOpenFile( "./sub//a.txt", true );
+	    result = result && file != NULL && plGetFileSize( file ) == sizeof( buf );
+	    plCloseFile( file );
+    }
+    plClearMountedLocations();
+    plEnableFileSystemIndex( false );
+    plDeleteFile( "pl_test_dir/sub/a.txt" );
+    plDeleteFile( "pl_test_dir/sub/b.txt" );
+    plDeleteFile( "pl_test_dir/" TEST_PACKAGE_PATH );
+    plDeleteFile( TEST_PACKAGE_PATH );
+#if !defined( _WIN32 )
+    unlink( "pl_test_dir/sub/loop" );
+#endif
+    REMOVE_TEST_DIRECTORY( "pl_test_dir/sub" );
+    REMOVE_TEST_DIRECTORY( "pl_test_dir" );
+    if ( !result ) {
+	    printf( "Unexpected result from indexed lookup!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+/*============================================================
+ * IMAGE
+ ===========================================================*/
+
+FUNC_TEST( ConvertPixelFormat )
+    /* enough pixels to cover both the vector loops and their tails */
+    uint8_t pixels[ 37 * 4 ];
+    for ( unsigned int i = 0; i < sizeof( pixels ); ++i ) {
+	    pixels[ i ] = ( uint8_t ) ( i * 7 + 3 );
+    }
+    /* the packed formats are lossless through RGBA8 and back */
+    const PLImageFormat packedFormats[] = { PL_IMAGEFORMAT_RGB565, PL_IMAGEFORMAT_RGB5A1, PL_IMAGEFORMAT_RGBA4 };
+    for ( unsigned int i = 0; i < plArrayElements( packedFormats ); ++i ) {
+	    PLImage *image = plCreateImage( pixels, 37, 1, PL_COLOURFORMAT_RGBA, packedFormats[ i ] );
+	    bool result = image != NULL && plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) &&
+	                  plConvertPixelFormat( image, packedFormats[ i ] ) && memcmp( image->data[ 0 ], pixels, 37 * 2 ) == 0;
+	    plDestroyImage( image );
+	    if ( !result ) {
+		    printf( "Unexpected result from packed format %u!\n", packedFormats[ i ] );
+		    return TEST_RETURN_FAILURE;
+	    }
+    }
+    /* RRRRRGGG GGBBBBBA */
+    const uint8_t rgb5a1[] = { 0xF8, 0x01, 0x07, 0xC0 };
+    PLImage *image = plCreateImage( ( uint8_t * ) rgb5a1, 2, 1, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGB5A1 );
+    bool result = image != NULL && plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) && image->size == 8 &&
+                  memcmp( image->data[ 0 ], "\xFF\x00\x00\xFF\x00\xFF\x00\x00", 8 ) == 0;
+    plDestroyImage( image );
+    /* swapping channels, then through RGB8 (in place) and half float */
+    image = plCreateImage( pixels, 37, 1, PL_COLOURFORMAT_BGRA, PL_IMAGEFORMAT_RGBA8 );
+    result = result && image != NULL && plConvertColourFormat( image, PL_COLOURFORMAT_RGBA ) &&
+             image->data[ 0 ][ 0 ] == pixels[ 2 ] && image->data[ 0 ][ 2 ] == pixels[ 0 ] && image->data[ 0 ][ 144 ] == pixels[ 146 ] &&
+             plConvertPixelFormat( image, PL_IMAGEFORMAT_RGB8 ) && image->colour_format == PL_COLOURFORMAT_RGB &&
+             image->data[ 0 ][ 108 ] == pixels[ 146 ] && image->data[ 0 ][ 110 ] == pixels[ 144 ] &&
+             plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA16F ) && plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) &&
+             image->data[ 0 ][ 3 ] == 255 && image->data[ 0 ][ 144 ] == pixels[ 146 ] && image->data[ 0 ][ 146 ] == pixels[ 144 ] &&
+             !plConvertColourFormat( image, PL_COLOURFORMAT_BGR );
+    plDestroyImage( image );
+    /* already RGBA8, but still has to come out in RGBA order */
+    image = plCreateImage( pixels, 37, 1, PL_COLOURFORMAT_BGRA, PL_IMAGEFORMAT_RGBA8 );
+    result = result && image != NULL && plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) &&
+             image->colour_format == PL_COLOURFORMAT_RGBA && image->data[ 0 ][ 0 ] == pixels[ 2 ] && image->data[ 0 ][ 2 ] == pixels[ 0 ];
+    plDestroyImage( image );
+    if ( !result ) {
+	    printf( "Unexpected result from image conversion!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( CompressImage )
+    /* red and blue endpoints, with the last row picking the midpoints */
+    const uint8_t block[] = { 0x00, 0xF8, 0x1F, 0x00, 0x00, 0x00, 0x00, 0xE0 };
+    PLImage *image = plCreateImage( ( uint8_t * ) block, 4, 4, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA_DXT1 );
+    bool result = image != NULL && plDecompressImage( image ) && image->format == PL_IMAGEFORMAT_RGBA8 &&
+                  memcmp( image->data[ 0 ], "\xFF\x00\x00\xFF", 4 ) == 0 &&
+                  memcmp( &image->data[ 0 ][ 48 ], "\xFF\x00\x00\xFF\xFF\x00\x00\xFF\xAA\x00\x55\xFF\x55\x00\xAA\xFF", 16 ) == 0;
+    plDestroyImage( image );
+    if ( !result ) {
+	    printf( "Unexpected result from block decode!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+    /* a smooth gradient should survive every format and quality closely, the
+     * larger size is there so the work gets split between threads */
+    const PLImageFormat formats[] = { PL_IMAGEFORMAT_RGB_DXT1, PL_IMAGEFORMAT_RGBA_DXT1, PL_IMAGEFORMAT_RGBA_DXT3, PL_IMAGEFORMAT_RGBA_DXT5 };
+    const unsigned int sizes[][ 2 ] = { { 13, 9 }, { 128, 128 } };
+    for ( unsigned int s = 0; s < plArrayElements( sizes ); ++s ) {
+	    unsigned int w = sizes[ s ][ 0 ], h = sizes[ s ][ 1 ];
+	    uint8_t *pixels = pl_malloc( w * h * 4 );
+	    for ( unsigned int y = 0; y < h; ++y ) {
+		    for ( unsigned int x = 0; x < w; ++x ) {
+			    uint8_t *p = &pixels[ ( y * w + x ) * 4 ];
+			    p[ 0 ] = ( uint8_t ) ( x * 2 );
+			    p[ 1 ] = ( uint8_t ) ( y * 2 );
+			    p[ 2 ] = ( uint8_t ) ( 128 + ( ( int ) x - ( int ) y ) / 4 );
+			    p[ 3 ] = ( x < w / 2 ) ? 0 : ( uint8_t ) ( y * 255 / h );
+		    }
+	    }
+	    for ( unsigned int f = 0; f < plArrayElements( formats ); ++f ) {
+		    for ( unsigned int q = PL_IMAGECOMPRESSION_FAST; q <= PL_IMAGECOMPRESSION_HIGH; ++q ) {
+			    image = plCreateImage( pixels, w, h, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+			    result = image != NULL && plCompressImage( image, formats[ f ], q ) &&
+			             image->size == plGetImageSize( formats[ f ], w, h ) && plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 );
+			    for ( unsigned int i = 0; result && i < w * h; ++i ) {
+				    const uint8_t *a = &pixels[ i * 4 ], *b = &image->data[ 0 ][ i * 4 ];
+				    for ( unsigned int c = 0; c < 3; ++c ) {
+					    /* transparent pixels in BC1 lose their colour */
+					    if ( formats[ f ] == PL_IMAGEFORMAT_RGBA_DXT1 && a[ 3 ] < 128 ) {
+						    result = ( b[ 3 ] == 0 );
+						    break;
+					    }
+					    result = result && abs( a[ c ] - b[ c ] ) <= 24;
+				    }
+				    if ( formats[ f ] == PL_IMAGEFORMAT_RGBA_DXT3 || formats[ f ] == PL_IMAGEFORMAT_RGBA_DXT5 ) {
+					    result = result && abs( a[ 3 ] - b[ 3 ] ) <= 12;
+				    }
+			    }
+			    plDestroyImage( image );
+			    if ( !result ) {
+				    printf( "Unexpected result from %ux%u format %u at quality %u!\n", w, h, formats[ f ], q );
+				    pl_free( pixels );
+				    return TEST_RETURN_FAILURE;
+			    }
+		    }
+	    }
+	    pl_free( pixels );
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( GenerateImageMipmaps )
+    /* a flat colour stays flat down the chain under every filter */
+    uint8_t pixels[ 13 * 9 * 4 ];
+    for ( unsigned int i = 0; i < sizeof( pixels ); i += 4 ) {
+	    memcpy( &pixels[ i ], "\x28\x78\xC8\x4D", 4 );
+    }
+    const unsigned int filters[] = { PL_MIPMAPFILTER_BOX, PL_MIPMAPFILTER_KAISER, PL_MIPMAPFILTER_BOX | PL_MIPMAPFILTER_GAMMA, PL_MIPMAPFILTER_KAISER | PL_MIPMAPFILTER_GAMMA };
+    for ( unsigned int i = 0; i < plArrayElements( filters ); ++i ) {
+	    PLImage *image = plCreateImage( pixels, 13, 9, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	    bool result = image != NULL && plGenerateImageMipmaps( image, filters[ i ] ) && image->levels == 4 &&
+	                  memcmp( image->data[ 1 ], pixels, 6 * 4 * 4 ) == 0 && memcmp( image->data[ 3 ], pixels, 4 ) == 0;
+	    plDestroyImage( image );
+	    if ( !result ) {
+		    printf( "Unexpected result from mipmap filter %X!\n", filters[ i ] );
+		    return TEST_RETURN_FAILURE;
+	    }
+    }
+    /* half black and half white, which is brighter when averaged in linear light */
+    const uint8_t checker[] = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 0, 0, 0 };
+    PLImage *image = plCreateImage( ( uint8_t * ) checker, 2, 2, PL_COLOURFORMAT_RGB, PL_IMAGEFORMAT_RGB8 );
+    bool result = image != NULL && plGenerateImageMipmaps( image, PL_MIPMAPFILTER_BOX ) && image->levels == 2 && image->data[ 1 ][ 0 ] == 128 &&
+                  plGenerateImageMipmaps( image, PL_MIPMAPFILTER_BOX | PL_MIPMAPFILTER_GAMMA ) && image->levels == 2 && image->data[ 1 ][ 2 ] == 188;
+    plDestroyImage( image );
+    image = plCreateImage( pixels, 5, 3, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+    result = result && image != NULL && plGenerateImageMipmaps( image, PL_MIPMAPFILTER_KAISER ) && image->levels == 3 &&
+             plConvertPixelFormat( image, PL_IMAGEFORMAT_RGB565 ) && !plGenerateImageMipmaps( image, PL_MIPMAPFILTER_BOX );
+    plDestroyImage( image );
+    if ( !result ) {
+	    printf( "Unexpected result from mipmap generation!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+FUNC_TEST( ResizeImage )
+    /* a flat colour stays flat whichever way it's scaled */
+    uint8_t pixels[ 7 * 5 * 4 ];
+    for ( unsigned int i = 0; i < sizeof( pixels ); i += 4 ) {
+	    memcpy( &pixels[ i ], "\x28\x78\xC8\x4D", 4 );
+    }
+    const PLImageResizeFilter filters[] = { PL_IMAGERESIZE_BOX, PL_IMAGERESIZE_BILINEAR, PL_IMAGERESIZE_LANCZOS3, PL_IMAGERESIZE_MITCHELL };
+    for ( unsigned int i = 0; i < plArrayElements( filters ); ++i ) {
+	    PLImage *image = plCreateImage( pixels, 7, 5, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	    bool result = image != NULL && plResizeImage( image, 3, 2, filters[ i ] ) && image->width == 3 && image->height == 2 &&
+	                  memcmp( image->data[ 0 ], pixels, 3 * 2 * 4 ) == 0 &&
+	                  plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA16F ) && plResizeImage( image, 7, 5, filters[ i ] ) &&
+	                  plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) && memcmp( image->data[ 0 ], pixels, sizeof( pixels ) ) == 0;
+	    plDestroyImage( image );
+	    if ( !result ) {
+		    printf( "Unexpected result from resize filter %u!\n", filters[ i ] );
+		    return TEST_RETURN_FAILURE;
+	    }
+    }
+    /* shrinking with the box filter averages each pair */
+    const uint8_t row[] = { 10, 0, 0, 255, 30, 0, 0, 255, 50, 0, 0, 255, 70, 0, 0, 255 };
+    PLImage *image = plCreateImage( ( uint8_t * ) row, 4, 1, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+    bool result = image != NULL && plResizeImage( image, 2, 1, PL_IMAGERESIZE_BOX ) && image->size == 8 &&
+                  memcmp( image->data[ 0 ], "\x14\x00\x00\xFF\x3C\x00\x00\xFF", 8 ) == 0 &&
+                  plConvertPixelFormat( image, PL_IMAGEFORMAT_RGB8 ) && !plResizeImage( image, 4, 4, PL_IMAGERESIZE_BOX );
+    plDestroyImage( image );
+    if ( !result ) {
+	    printf( "Unexpected result from image resize!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
+#define TEST_IMAGE_PATH "pl_test_image"
+
+FUNC_TEST( GetImageInfo )
+    plRegisterStandardImageLoaders( PL_IMAGE_FILEFORMAT_PNG | PL_IMAGE_FILEFORMAT_BMP | PL_IMAGE_FILEFORMAT_FTX | PL_IMAGE_FILEFORMAT_TIM );
+
+    /* the stb formats, which are probed through callbacks */
+    const char *extensions[] = { "png", "bmp" };
+    PLImage *image = plCreateImage( NULL, 13, 9, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+    for ( unsigned int i = 0; i < plArrayElements( extensions ); ++i ) {
+	    char path[ 64 ];
+	    snprintf( path, sizeof( path ), TEST_IMAGE_PATH ".%s", extensions[ i ] );
+	    PLImageInfo info;
+	    bool result = plWriteImage( image, path ) && plGetImageInfo( path, &info ) && info.width == 13 && info.height == 9 &&
+	                  info.levels == 1 && info.format == PL_IMAGEFORMAT_RGBA8 && info.colour_format == PL_COLOURFORMAT_RGBA;
+	    plDeleteFile( path );
+	    if ( !result ) {
+		    printf( "Unexpected result from %s image info!\n", extensions[ i ] );
+		    plDestroyImage( image );
+		    return TEST_RETURN_FAILURE;
+	    }
+    }
+    plDestroyImage( image );
+
+    /* a 4-bit TIM, whose palette has to be skipped to reach the image header;
+     * the first entry is a transparent red (STP set) */
+    const uint8_t tim[] = {
+            16, 0, 0, 0, 8, 0, 0, 0,
+            44, 0, 0, 0, 0, 0, 0, 0, 16, 0, 1, 0,
+            0x1F, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            20, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0,
+            0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE,
+    };
+    PLImageInfo info;
+    bool result = plWriteFile( TEST_IMAGE_PATH ".tim", tim, sizeof( tim ) ) && plGetImageInfo( TEST_IMAGE_PATH ".tim", &info ) &&
+                  info.width == 8 && info.height == 2 && info.format == PL_IMAGEFORMAT_RGB5A1 && info.colour_format == PL_COLOURFORMAT_RGBA;
+    image = plLoadImage( TEST_IMAGE_PATH ".tim" );
+    result = result && image != NULL && image->width == info.width && image->height == info.height && image->format == info.format &&
+             plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) && memcmp( image->data[ 0 ], "\xFF\x00\x00\x00", 4 ) == 0;
+    plDestroyImage( image );
+    plDeleteFile( TEST_IMAGE_PATH ".tim" );
+
+    /* only the header is needed, so a truncated FTX still probes */
+    const uint8_t ftx[] = { 5, 0, 0, 0, 7, 0, 0, 0, 1, 0, 0, 0 };
+    result = result && plWriteFile( TEST_IMAGE_PATH ".ftx", ftx, sizeof( ftx ) ) && plGetImageInfo( TEST_IMAGE_PATH ".ftx", &info ) &&
+             info.width == 5 && info.height == 7 && info.format == PL_IMAGEFORMAT_RGBA8 && plLoadImage( TEST_IMAGE_PATH ".ftx" ) == NULL &&
+             !plGetImageInfo( TEST_IMAGE_PATH ".png", &info );
+    /* a header that's cut short is the loader's problem, not an unsupported format */
+    result = result && plWriteFile( TEST_IMAGE_PATH ".ftx", ftx, 4 ) && !plGetImageInfo( TEST_IMAGE_PATH ".ftx", &info ) &&
+             plGetFunctionResult() != PL_RESULT_UNSUPPORTED &&
+             plWriteFile( TEST_IMAGE_PATH ".xyz", ftx, sizeof( ftx ) ) && !plGetImageInfo( TEST_IMAGE_PATH ".xyz", &info ) &&
+             plGetFunctionResult() == PL_RESULT_UNSUPPORTED;
+    plDeleteFile( TEST_IMAGE_PATH ".ftx" );
+    plDeleteFile( TEST_IMAGE_PATH ".xyz" );
+
+    plClearImageLoaders();
+    if ( !result ) {
+	    printf( "Unexpected result from image info!\n" );
+	    return TEST_RETURN_FAILURE;
+    }
+FUNC_TEST_END()
+
 int main( int argc, char **argv ) {
 	printf( "Starting tests...\n" );
 
+	plInitialize( argc, argv );
+	plInitializeSubSystems( PL_SUBSYSTEM_IO );
+
 #define CALL_FUNC_TEST( NAME ) \
     { int ret = test_##NAME(); \
 		if ( ret != TEST_RETURN_SUCCESS ) { printf( "Failed on " #NAME "!\n"); \
@@ -107,5 +1301,32 @@ int main( int argc, char **argv ) {
 	CALL_FUNC_TEST( GetConsoleCommands )
 	CALL_FUNC_TEST( GetConsoleCommand )
 
+	CALL_FUNC_TEST( MapLocalFile )
+	CALL_FUNC_TEST( ReadBufferedFile )
+	CALL_FUNC_TEST( ReadEndianArrays )
+
+	CALL_FUNC_TEST( LoadPackageFile )
+	CALL_FUNC_TEST( LoadPackageFileView )
+	CALL_FUNC_TEST( ExtractPackageFile )
+	CALL_FUNC_TEST( LoadPackageFiles )
+	CALL_FUNC_TEST( WritePackage )
+	CALL_FUNC_TEST( InflatePackageFile )
+	CALL_FUNC_TEST( PackageIndexCache )
+	CALL_FUNC_TEST( StatFile )
+	CALL_FUNC_TEST( FileSystemIndex )
+	CALL_FUNC_TEST( ReadFileAsync )
+	CALL_FUNC_TEST( ScanDirectory )
+	CALL_FUNC_TEST( ScanPackage )
+#if defined( __linux__ )
+	CALL_FUNC_TEST( WatchPath )
+#endif
+	CALL_FUNC_TEST( FileCache )
+
+	CALL_FUNC_TEST( ConvertPixelFormat )
+	CALL_FUNC_TEST( CompressImage )
+	CALL_FUNC_TEST( GenerateImageMipmaps )
+	CALL_FUNC_TEST( ResizeImage )
+	CALL_FUNC_TEST( GetImageInfo )
+
     return EXIT_SUCCESS;
 }